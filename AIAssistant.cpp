@@ -1,5 +1,6 @@
 // AIAssistant.cpp
 #include "AIAssistant.h"
+#include "latency_trace.h"
 
 #include <QVBoxLayout>
 #include <QLabel>
@@ -68,8 +69,9 @@ void AIAssistant::sendPrompt(const QString& prompt) {
     QJsonDocument doc(payload);
     QByteArray data = doc.toJson();
 
-    // Send the request
-    networkManager->post(request, data);
+    // Send the request; the reply carries its start time for the trace
+    QNetworkReply* reply = networkManager->post(request, data);
+    reply->setProperty("traceStart", QVariant::fromValue<qulonglong>(SNSUPEAR_TRACE_NOW()));
 }
 
 /**
@@ -77,6 +79,7 @@ void AIAssistant::sendPrompt(const QString& prompt) {
  * @param reply The network reply containing the response.
  */
 void AIAssistant::onNetworkReply(QNetworkReply* reply) {
+    SNSUPEAR_TRACE_RECORD(Network, "AIAssistant request", reply->property("traceStart").toULongLong());
     if (reply->error() != QNetworkReply::NoError) {
         QMessageBox::critical(this, "Error", "Network request failed: " + reply->errorString());
         reply->deleteLater();
@@ -11,16 +11,71 @@
 #include <QShortcut>
 #include <QTimer>
 #include <QStringListModel>
+#include <QHBoxLayout>
+#include <QFile>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QSaveFile>
+#include <QWheelEvent>
+#include <QKeyEvent>
+#include <QDir>
+#include <QDateTime>
+#include <QCoreApplication>
+#include <QPlainTextDocumentLayout>
+#include <QTextBlock>
+#include <algorithm>
+#include <climits>
+#include "latency_trace.h"
+
+namespace {
+
+// Times the layout work QPlainTextEdit does as part of an edit. Line layout
+// that is deferred until a block is drawn shows up under the paint span.
+// relayout() lays out blocks whose visibility a fold changed without
+// QTextDocument::markContentsDirty, which would report them as edited.
+class EditorDocumentLayout : public QPlainTextDocumentLayout {
+public:
+    using QPlainTextDocumentLayout::QPlainTextDocumentLayout;
+
+    void relayout(int from, int length) { documentChanged(from, length, length); }
+
+protected:
+    void documentChanged(int from, int charsRemoved, int charsAdded) override {
+        SNSUPEAR_TRACE_SCOPE(Layout, "QPlainTextDocumentLayout::documentChanged");
+        QPlainTextDocumentLayout::documentChanged(from, charsRemoved, charsAdded);
+    }
+};
+
+QTextDocument* newEditorDocument(QPlainTextEdit* editor) {
+    QTextDocument* document = new QTextDocument(editor);
+    document->setDocumentLayout(new EditorDocumentLayout(document));
+    return document;
+}
+
+} // namespace
 
 EditorUI::EditorUI(QWidget* parent) : QWidget(parent),
     editor(new QPlainTextEdit(this)),
     aiAssistant(new AIAssistant(this)),
-    syntaxHighlighter(new SyntaxHighlighter(editor->document())),
+    syntaxHighlighter(new SyntaxHighlighter(newEditorDocument(editor))),
     codeFormatter(new CodeFormatter(this)),
     chatDock(new QDockWidget("AI Chat", this)),
     completer(new QCompleter(this)),
-    debounceTimer(new QTimer(this))
+    completionModel(new QStringListModel(this)),
+    debounceTimer(new QTimer(this)),
+    tabBar(new QTabBar(this)),
+    largeFileScrollBar(new QScrollBar(Qt::Vertical, this)),
+    indexProgressTimer(new QTimer(this)),
+    latencyHud(new LatencyHud(editor)),
+    traceRecorder(new EditTraceRecorder(editor, this)),
+    sessionJournal(new SessionJournal(this)),
+    minimap(new Minimap(editor, syntaxHighlighter, this)),
+    diagnosticsOverlay(new DiagnosticsOverlay(editor))
 {
+    untitled.document = syntaxHighlighter->document();
+    untitled.highlighter = syntaxHighlighter;
+    untitled.mirror = new DocumentMirror(untitled.document, untitled.document);
+    editor->setDocument(untitled.document);
     setupUI();
     setupConnections();
     setupShortcuts();
@@ -33,9 +88,29 @@ EditorUI::EditorUI(QWidget* parent) : QWidget(parent),
     aiAssistant->setApiKey(apiKey);
 }
 
+EditorUI::~EditorUI() {
+    // Before the editor and the tabs' mirrors, which are children too, go away
+    traceRecorder->stop();
+    sessionJournal->close();
+    for (auto& entry : tabs)
+        diagnosticsOverlay->forget(entry.second.mirror);
+}
+
 void EditorUI::setupUI() {
     QVBoxLayout* layout = new QVBoxLayout(this);
-    layout->addWidget(editor);
+    tabBar->setDocumentMode(true);
+    tabBar->setExpanding(false);
+    tabBar->setUsesScrollButtons(true);
+    tabBar->setTabsClosable(true);
+    tabBar->hide();  // Shown once a file is open
+    layout->addWidget(tabBar);
+
+    QHBoxLayout* editorRow = new QHBoxLayout();
+    editorRow->addWidget(editor);
+    editorRow->addWidget(minimap);
+    editorRow->addWidget(largeFileScrollBar);
+    largeFileScrollBar->hide();
+    layout->addLayout(editorRow);
 
     // Set up the chat dock widget
     chatDock->setAllowedAreas(Qt::BottomDockWidgetArea); 
@@ -46,19 +121,35 @@ void EditorUI::setupUI() {
 
     // Set up QCompleter
     completer->setWidget(editor);
+    completer->setModel(completionModel);
     completer->setCompletionMode(QCompleter::PopupCompletion);
     completer->setCaseSensitivity(Qt::CaseInsensitive);
 }
 
 void EditorUI::setupConnections() {
     connect(aiAssistant, &AIAssistant::responseReceived, this, &EditorUI::onAIResponseReceived);
+    // QSyntaxHighlighter already re-highlights the blocks touched by each
+    // edit, so no full-document rehighlight() here.
     connect(editor, &QPlainTextEdit::textChanged, this, [this]() {
-        syntaxHighlighter->rehighlight();
+        if (keyPressStart != 0) {
+            // Key handling, layout and highlighting of the edit are all done.
+            SNSUPEAR_TRACE_RECORD(Edit, "keyPress", keyPressStart);
+            keyPressStart = 0;
+        }
+        if (largeFileMode)
+            return; // Text changes come from scrolling the window
         onTextChanged(); // Trigger code completion
     });
     connect(this, &EditorUI::customContextMenuRequested, this, &EditorUI::onFormatCode);
     connect(completer, QOverload<const QString &>::of(&QCompleter::activated),
             this, &EditorUI::insertCompletion);
+    connect(largeFileScrollBar, &QScrollBar::valueChanged, this, &EditorUI::onLargeFileScrolled);
+    connect(indexProgressTimer, &QTimer::timeout, this, &EditorUI::refreshLargeFileIndex);
+    connect(tabBar, &QTabBar::currentChanged, this, &EditorUI::onTabChanged);
+    connect(tabBar, &QTabBar::tabCloseRequested, this, &EditorUI::closeTab);
+    connect(editor->document(), &QTextDocument::contentsChange, this, &EditorUI::onContentsChange);
+    editor->viewport()->installEventFilter(this);
+    editor->installEventFilter(this);
 }
 
 void EditorUI::setupShortcuts() {
@@ -68,6 +159,84 @@ void EditorUI::setupShortcuts() {
 
     QShortcut *formatShortcut = new QShortcut(QKeySequence("Ctrl+I"), this);
     connect(formatShortcut, &QShortcut::activated, this, &EditorUI::onFormatCode);
+
+    // Toggle following appends to the open file (tail -F)
+    QShortcut *followShortcut = new QShortcut(QKeySequence("Ctrl+Shift+L"), this);
+    connect(followShortcut, &QShortcut::activated, this, [this]() { setFollowMode(!follower); });
+
+#ifndef SNSUPEAR_TRACE_DISABLED
+    // Keystroke-to-paint latency HUD, and a Chrome trace of recent spans
+    QShortcut *hudShortcut = new QShortcut(QKeySequence("Ctrl+Shift+T"), this);
+    connect(hudShortcut, &QShortcut::activated, this, [this]() { latencyHud->setVisible(!latencyHud->isVisible()); });
+
+    QShortcut *traceShortcut = new QShortcut(QKeySequence("Ctrl+Shift+E"), this);
+    connect(traceShortcut, &QShortcut::activated, this, [this]() {
+        QString name = QString("snsupear-trace-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+        exportLatencyTrace(QDir::temp().filePath(name));
+    });
+#endif
+
+    // Record the session as an edit trace for snsupear_replay
+    QShortcut *recordShortcut = new QShortcut(QKeySequence("Ctrl+Shift+R"), this);
+    connect(recordShortcut, &QShortcut::activated, this, [this]() { setTraceRecording(!traceRecorder->isRecording()); });
+
+    QShortcut *saveShortcut = new QShortcut(QKeySequence::Save, this);
+    connect(saveShortcut, &QShortcut::activated, this, &EditorUI::saveFile);
+
+    // Cycle through the open files
+    QShortcut *nextTabShortcut = new QShortcut(QKeySequence::NextChild, this);
+    connect(nextTabShortcut, &QShortcut::activated, this, [this]() {
+        if (tabBar->count() > 1)
+            tabBar->setCurrentIndex((tabBar->currentIndex() + 1) % tabBar->count());
+    });
+    QShortcut *previousTabShortcut = new QShortcut(QKeySequence::PreviousChild, this);
+    connect(previousTabShortcut, &QShortcut::activated, this, [this]() {
+        if (tabBar->count() > 1)
+            tabBar->setCurrentIndex((tabBar->currentIndex() + tabBar->count() - 1) % tabBar->count());
+    });
+    QShortcut *closeTabShortcut = new QShortcut(QKeySequence::Close, this);
+    connect(closeTabShortcut, &QShortcut::activated, this, [this]() {
+        if (tabBar->currentIndex() >= 0)
+            closeTab(tabBar->currentIndex());
+    });
+
+    // Fold and unfold the region around the cursor
+    QShortcut *foldShortcut = new QShortcut(QKeySequence("Ctrl+Shift+["), this);
+    connect(foldShortcut, &QShortcut::activated, this, [this]() { setFoldAtCursor(true); });
+    QShortcut *unfoldShortcut = new QShortcut(QKeySequence("Ctrl+Shift+]"), this);
+    connect(unfoldShortcut, &QShortcut::activated, this, [this]() { setFoldAtCursor(false); });
+
+    // Show or hide the minimap
+    QShortcut *minimapShortcut = new QShortcut(QKeySequence("Ctrl+Shift+M"), this);
+    connect(minimapShortcut, &QShortcut::activated, this, [this]() {
+        if (!largeFileMode)
+            minimap->setVisible(!minimap->isVisible());
+    });
+}
+
+bool EditorUI::exportLatencyTrace(const QString& path) {
+    if (!LatencyTrace::exportChromeTrace(path.toStdString())) {
+        qWarning() << "Failed to write latency trace to" << path;
+        return false;
+    }
+    qInfo() << "Latency trace written to" << path << "(open in ui.perfetto.dev or chrome://tracing)";
+    return true;
+}
+
+void EditorUI::setTraceRecording(bool enabled) {
+    if (!enabled) {
+        traceRecorder->stop();
+        return;
+    }
+    if (largeFileMode) {
+        qWarning() << "Edit traces are not recorded in large-file mode";
+        return;
+    }
+    QString name = QString("snsupear-session-%1.sntrace").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+    QString path = QDir::temp().filePath(name);
+    if (traceRecorder->start(path, "cpp", currentTab->mirror)) {
+        qInfo() << "Recording edit trace to" << path << "(replay with snsupear_replay)";
+    }
 }
 
 void EditorUI::applyTheme(const QString& themeName) {
@@ -78,7 +247,12 @@ void EditorUI::applyTheme(const QString& themeName) {
         palette.setColor(QPalette::Text, QColor(theme["foreground"].toString()));
         editor->setPalette(palette);
 
-        syntaxHighlighter->setHighlightingRules(theme); 
+        currentTheme = theme;
+        untitled.highlighter->setHighlightingRules(theme);
+        for (auto& entry : tabs) {
+            if (entry.second.highlighter)
+                entry.second.highlighter->setHighlightingRules(theme);
+        }
     } else {
         qWarning() << "Theme not found:" << themeName;
     }
@@ -91,6 +265,11 @@ void EditorUI::onAIResponseReceived(const QString& response) {
 }
 
 void EditorUI::onFormatCode() {
+    if (largeFileMode) {
+        qWarning() << "Formatting is disabled in large-file mode";
+        return;
+    }
+    traceRecorder->recordFormat("cpp");
     QString formattedCode = codeFormatter->formatCode(editor->toPlainText(), "cpp");
     editor->setPlainText(formattedCode);
 }
@@ -104,6 +283,11 @@ void EditorUI::onTextChanged() {
 }
 
 void EditorUI::requestCompletion() {
+    if (largeFileMode)
+        return; // Would send the whole document
+
+    SNSUPEAR_TRACE_SCOPE(Completion, "requestCompletion");
+    traceRecorder->recordCompletion();
     QString prompt = editor->toPlainText();
     QTextCursor tc = editor->textCursor();
     int cursorPosition = tc.position();
@@ -118,7 +302,7 @@ void EditorUI::showCompletionPopup(const QStringList& suggestions) {
     if (suggestions.isEmpty())
         return;
 
-    completer->setModel(new QStringListModel(suggestions, completer));
+    completionModel->setStringList(suggestions);  // One model, reused per completion
     completer->setCompletionPrefix(editor->textUnderCursor());
 
     QRect cr = editor->cursorRect();
@@ -132,3 +316,665 @@ void EditorUI::insertCompletion(const QString& completion) {
     tc.insertText(completion);
     editor->setTextCursor(tc);
 }
+
+void EditorUI::openFile(const QString& path) {
+    QFileInfo info(path);
+    const bool large = info.size() >= ConfigManager::getInstance().getLargeFileThreshold();
+
+    // A tab already open keeps its document unless that is unmodified and
+    // the file changed on disk since. The workspace hands its copy of the
+    // text over to the tab; one it has not loaded yet is loaded in the
+    // background while the tab waits, and onFileLoaded() shows it.
+    auto existing = tabs.find(path);
+    const bool reload = !large
+                        && (existing == tabs.end() || !existing->second.loaded
+                            || (!existing->second.document->isModified()
+                                && info.lastModified() != existing->second.lastModified));
+    std::shared_ptr<WorkspaceDocument> document;
+    Tab& tab = tabs[path];
+    if (reload) {
+        document = workspace.take(path.toStdString());
+        if (!document && !tab.loading) {
+            tab.loading = true;
+            workspace.openAll({path.toStdString()}, [this, path](const std::string&, const std::string& error) {
+                // On a worker: the tab is shown on the UI thread.
+                QMetaObject::invokeMethod(this, [this, path, error = QString::fromStdString(error)]() {
+                    onFileLoaded(path, error);
+                }, Qt::QueuedConnection);
+            });
+        }
+    }
+
+    setFollowMode(false);
+    stashCurrentDocument();
+    currentFilePath = path;
+    showTab(path);
+    showTabDocument(tab);
+    if (large) {
+        if (tab.loaded) {
+            diagnosticsOverlay->forget(tab.mirror);
+            tab.mirror->release();
+        }
+        tab.loaded = false;
+        if (!enterLargeFileMode(path)) {
+            // The tab stays, read-only, without the previous tab's view.
+            leaveLargeFileMode();
+            editor->setReadOnly(true);
+            editor->setPlaceholderText(QString("Cannot open %1").arg(info.fileName()));
+        }
+        return;
+    }
+    leaveLargeFileMode();
+
+    if (document) {
+        tab.lastModified = info.lastModified();
+        loadedSize = static_cast<qint64>(document->original->size());
+        editor->setPlainText(QString::fromStdString(document->buffer.getBuffer()));
+        document.reset();  // The tab's document is the only copy from here on
+
+        // A session that crashed or closed without saving leaves its edits
+        // in the journal, which rebuilds them from its last checkpoint.
+        bool saved = true;
+        if (std::optional<QString> recovered = sessionJournal->recoverable(path)) {
+            QMessageBox::StandardButton answer = QMessageBox::question(
+                this, "Recover unsaved changes",
+                QString("%1 has unsaved changes from an earlier session. Restore them?").arg(info.fileName()));
+            if (answer == QMessageBox::Yes) {
+                editor->setPlainText(*recovered);
+                saved = false;
+            }
+        }
+        editor->document()->setModified(!saved);
+        if (!tab.loaded)
+            tab.mirror->acquire();
+        tab.loaded = true;
+        sessionJournal->open(path, tab.mirror, saved);
+    } else if (tab.loaded) {
+        // Unchanged while hidden: the mirror and the journal left on disk
+        // still match it, so nothing is rebuilt or written.
+        sessionJournal->reattach(path, tab.mirror, !editor->document()->isModified());
+    } else {
+        editor->setReadOnly(true);
+        editor->setPlaceholderText("Loading...");
+        return;
+    }
+    diagnosticsOverlay->open(path, tab.mirror);
+}
+
+// A background load a tab was waiting for finished. The shown tab takes its
+// text now, a hidden one when it is shown; a tab whose file cannot be read
+// is closed.
+void EditorUI::onFileLoaded(const QString& path, const QString& error) {
+    auto tab = tabs.find(path);
+    if (tab == tabs.end() || !tab->second.loading)
+        return;  // Closed meanwhile
+    tab->second.loading = false;
+    if (!error.isEmpty()) {
+        qWarning() << "Failed to open file:" << path << error;
+        if (tab->second.loaded)
+            return;  // Keeps the text it has
+        for (int i = 0; i < tabBar->count(); ++i) {
+            if (tabBar->tabData(i).toString() == path) {
+                closeTab(i);
+                break;
+            }
+        }
+        return;
+    }
+    if (path != currentFilePath)
+        return;
+    if (!workspace.isCached(path.toStdString())) {
+        // Evicted before the tab could take it, which only happens to a file
+        // larger than the whole cache: read it here instead.
+        try {
+            workspace.acquire(path.toStdString());
+        } catch (const std::exception& e) {
+            qWarning() << "Failed to open file:" << path << e.what();
+            return;
+        }
+    }
+    openFile(path);
+}
+
+void EditorUI::openFiles(const QStringList& paths) {
+    if (paths.isEmpty())
+        return;
+    // Load everything in the background; large files are mapped on demand
+    // instead, when their tab is shown.
+    std::vector<std::string> files;
+    qint64 threshold = ConfigManager::getInstance().getLargeFileThreshold();
+    for (const QString& path : paths) {
+        showTab(path);
+        if (QFileInfo(path).size() < threshold)
+            files.push_back(path.toStdString());
+    }
+    workspace.openAll(files);
+    openFile(paths.first());
+}
+
+void EditorUI::showTab(const QString& path) {
+    int index = -1;
+    for (int i = 0; i < tabBar->count() && index < 0; ++i) {
+        if (tabBar->tabData(i).toString() == path)
+            index = i;
+    }
+    QSignalBlocker blocker(tabBar);
+    if (index < 0) {
+        index = tabBar->addTab(QFileInfo(path).fileName());
+        tabBar->setTabData(index, path);
+        tabBar->setTabToolTip(index, path);
+    }
+    tabBar->setCurrentIndex(index);
+    tabBar->show();
+}
+
+void EditorUI::onTabChanged(int index) {
+    QString path = tabBar->tabData(index).toString();
+    if (index >= 0 && path != currentFilePath)
+        openFile(path);
+}
+
+// Unsaved changes are saved or thrown away first, which shows the tab. The
+// shown tab hands over to a neighbour, or to the untitled document.
+void EditorUI::closeTab(int index) {
+    const QString path = tabBar->tabData(index).toString();
+    auto tab = tabs.find(path);
+    if (tab != tabs.end() && tab->second.document->isModified()) {
+        if (path != currentFilePath)
+            openFile(path);
+        if (path != currentFilePath)
+            return;
+        QMessageBox::StandardButton answer = QMessageBox::question(
+            this, "Close file", QString("%1 has unsaved changes. Save them?").arg(QFileInfo(path).fileName()),
+            QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
+        if (answer == QMessageBox::Cancel || (answer == QMessageBox::Save && !saveFile()))
+            return;
+        if (answer == QMessageBox::Discard)
+            sessionJournal->discard();
+    }
+
+    if (path == currentFilePath) {
+        const int next = index + 1 < tabBar->count() ? index + 1 : index - 1;
+        if (next >= 0)
+            openFile(tabBar->tabData(next).toString());
+        if (path == currentFilePath)
+            showUntitled();  // The last tab, or the neighbour failed to open
+    }
+
+    {
+        QSignalBlocker blocker(tabBar);
+        for (int i = 0; i < tabBar->count(); ++i) {
+            if (tabBar->tabData(i).toString() == path) {
+                tabBar->removeTab(i);
+                break;
+            }
+        }
+    }
+    if (tabBar->count() == 0)
+        tabBar->hide();
+    tab = tabs.find(path);
+    if (tab != tabs.end()) {
+        diagnosticsOverlay->forget(tab->second.mirror);
+        QTextDocument* document = tab->second.document;  // Takes its highlighter and mirror along
+        tabs.erase(tab);
+        delete document;
+    }
+    workspace.release(path.toStdString());
+}
+
+// Detaches the shown document's mirror from everything tracking it, and
+// keeps its fold state and view in its tab. The document and its mirror,
+// with any unsaved edits, stay as they are; the journal covers those
+// across a crash.
+void EditorUI::stashCurrentDocument() {
+    setTraceRecording(false);
+    sessionJournal->close();
+    diagnosticsOverlay->close();
+    Tab& tab = *currentTab;
+    tab.cursor = editor->textCursor();
+    tab.scrollValue = editor->verticalScrollBar()->value();
+    std::swap(tab.foldIndex, foldIndex);
+    std::swap(tab.appliedFolds, appliedFolds);
+    std::swap(tab.lastBlockCount, lastBlockCount);
+    std::swap(tab.loadedSize, loadedSize);
+}
+
+// Shows a tab's document, created on first use, as it was stashed.
+void EditorUI::showTabDocument(Tab& tab) {
+    if (!tab.document) {
+        tab.document = newEditorDocument(editor);
+        tab.highlighter = new SyntaxHighlighter(tab.document);
+        tab.mirror = new DocumentMirror(tab.document, tab.document);
+        if (!currentTheme.isEmpty())
+            tab.highlighter->setHighlightingRules(currentTheme);
+    }
+    disconnect(editor->document(), &QTextDocument::contentsChange, this, &EditorUI::onContentsChange);
+    editor->setDocument(tab.document);
+    connect(tab.document, &QTextDocument::contentsChange, this, &EditorUI::onContentsChange);
+    syntaxHighlighter = tab.highlighter;
+    minimap->setHighlighter(tab.highlighter);
+    std::swap(tab.foldIndex, foldIndex);
+    std::swap(tab.appliedFolds, appliedFolds);
+    std::swap(tab.lastBlockCount, lastBlockCount);
+    std::swap(tab.loadedSize, loadedSize);
+    if (!tab.cursor.isNull())
+        editor->setTextCursor(tab.cursor);
+    editor->verticalScrollBar()->setValue(tab.scrollValue);
+    editor->setReadOnly(false);
+    editor->setPlaceholderText(QString());
+    currentTab = &tab;
+}
+
+void EditorUI::showUntitled() {
+    setFollowMode(false);
+    stashCurrentDocument();
+    leaveLargeFileMode();
+    currentFilePath.clear();
+    showTabDocument(untitled);
+}
+
+bool EditorUI::saveFile() {
+    if (largeFileMode || !currentTab->loaded) {  // Not the file's text
+        qWarning() << "Nothing to save";
+        return false;
+    }
+    QByteArray contents = editor->toPlainText().toUtf8();
+    QSaveFile file(currentFilePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(contents) != contents.size() || !file.commit()) {
+        qWarning() << "Failed to save file:" << currentFilePath;
+        return false;
+    }
+    loadedSize = contents.size();
+    currentTab->lastModified = QFileInfo(currentFilePath).lastModified();  // Not a change on disk to reload
+    editor->document()->setModified(false);
+    sessionJournal->markSaved();
+    return true;
+}
+
+bool EditorUI::enterLargeFileMode(const QString& path) {
+    auto view = std::make_unique<LargeFileView>();
+    if (!view->open(path.toStdString())) {
+        qWarning() << "Failed to map file:" << path;
+        return false;
+    }
+
+    setTraceRecording(false);  // The window swaps are not edits
+    sessionJournal->close();
+    diagnosticsOverlay->close();
+    foldIndex.unfoldAll();
+    applyFolds();
+    largeFile = std::move(view);
+    largeFileMode = true;
+    minimap->hide();  // The document only holds the visible window
+    editor->setReadOnly(true);
+    editor->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    largeFileScrollBar->setRange(0, 0);
+    largeFileScrollBar->setValue(0);
+    largeFileScrollBar->show();
+
+    // The scroll range grows as the background index streams in
+    indexProgressTimer->start(200);
+    onLargeFileScrolled(0);
+    return true;
+}
+
+void EditorUI::leaveLargeFileMode() {
+    if (!largeFileMode)
+        return;
+
+    indexProgressTimer->stop();
+    largeFile.reset();
+    largeFileMode = false;
+    largeFileScrollBar->hide();
+    minimap->show();
+    editor->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    editor->setReadOnly(false);
+}
+
+void EditorUI::refreshLargeFileIndex() {
+    if (!largeFile)
+        return;
+
+    int maxFirstLine = static_cast<int>(std::min<size_t>(largeFile->lineCount(), INT_MAX));
+    largeFileScrollBar->setRange(0, std::max(0, maxFirstLine - visibleLineCount()));
+    largeFileScrollBar->setPageStep(visibleLineCount());
+    if (largeFile->isIndexed())
+        indexProgressTimer->stop();
+}
+
+void EditorUI::onLargeFileScrolled(int firstLine) {
+    if (!largeFile)
+        return;
+
+    // Only the visible lines are ever handed to the document, so the
+    // highlighter and layout never see more than one screen of text.
+    QString window;
+    for (std::string_view line : largeFile->lines(static_cast<size_t>(firstLine), visibleLineCount())) {
+        if (!window.isEmpty())
+            window += '\n';
+        window += QString::fromUtf8(line.data(), static_cast<int>(line.size()));
+    }
+    editor->setPlainText(window);
+}
+
+void EditorUI::goToOffset(qint64 offset) {
+    if (!largeFileMode) {
+        QTextCursor tc = editor->textCursor();
+        tc.setPosition(static_cast<int>(std::min<qint64>(offset, editor->document()->characterCount() - 1)));
+        editor->setTextCursor(tc);
+        return;
+    }
+
+    // Offsets beyond the indexed prefix clamp to it until indexing catches up
+    size_t line = largeFile->lineOfOffset(static_cast<size_t>(std::max<qint64>(0, offset)));
+    refreshLargeFileIndex();
+    largeFileScrollBar->setValue(static_cast<int>(line));
+}
+
+int EditorUI::visibleLineCount() const {
+    int lineHeight = std::max(1, editor->fontMetrics().lineSpacing());
+    return editor->viewport()->height() / lineHeight + 1;
+}
+
+bool EditorUI::eventFilter(QObject* watched, QEvent* event) {
+#ifndef SNSUPEAR_TRACE_DISABLED
+    if (watched == editor && event->type() == QEvent::KeyPress) {
+        QKeyEvent* key = static_cast<QKeyEvent*>(event);
+        if (!key->text().isEmpty() || key->key() == Qt::Key_Backspace || key->key() == Qt::Key_Delete) {
+            SNSUPEAR_TRACE_KEYSTROKE_BEGIN();
+            keyPressStart = SNSUPEAR_TRACE_NOW();
+        }
+    }
+    if (watched == editor->viewport() && event->type() == QEvent::Paint && !tracingPaint) {
+        // Paint events do not propagate, so delivering this one ourselves
+        // and swallowing the original lets the span end when painting does.
+        {
+            SNSUPEAR_TRACE_SCOPE(Paint, "viewport paint");
+            tracingPaint = true;
+            QCoreApplication::sendEvent(watched, event);
+            tracingPaint = false;
+        }
+        SNSUPEAR_TRACE_KEYSTROKE_END();
+        return true;
+    }
+#endif
+    if (largeFileMode && watched == editor->viewport()) {
+        if (event->type() == QEvent::Wheel) {
+            QWheelEvent* wheel = static_cast<QWheelEvent*>(event);
+            int steps = wheel->angleDelta().y() / 40;
+            largeFileScrollBar->setValue(largeFileScrollBar->value() - steps);
+            return true;
+        }
+        if (event->type() == QEvent::Resize) {
+            refreshLargeFileIndex();
+            onLargeFileScrolled(largeFileScrollBar->value());
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void EditorUI::setFollowMode(bool enabled) {
+    if (!enabled) {
+        if (follower && !largeFileMode)
+            editor->document()->setUndoRedoEnabled(true);
+        follower.reset();
+        sessionJournal->resume();
+        QMutexLocker locker(&followMutex);
+        followPending.clear();
+        followReset = false;
+        return;
+    }
+    if (!largeFileMode && !currentTab->loaded) {
+        qWarning() << "No file to follow";
+        return;
+    }
+
+    FileFollower::Callbacks callbacks;
+    if (largeFileMode) {
+        // The mapped view re-reads the file itself; only wake the UI
+        callbacks.onGrow = [this](size_t) { queueFollowFlush(); };
+    } else {
+        callbacks.onAppend = [this](std::string&& appended) {
+            {
+                QMutexLocker locker(&followMutex);
+                followPending += appended;
+            }
+            queueFollowFlush();
+        };
+    }
+    callbacks.onReset = [this]() {
+        {
+            QMutexLocker locker(&followMutex);
+            followPending.clear();
+            followReset = true;
+        }
+        queueFollowFlush();
+    };
+
+    size_t startOffset = largeFileMode ? largeFile->size() : static_cast<size_t>(loadedSize);
+    follower = std::make_unique<FileFollower>();
+    if (!follower->start(currentFilePath.toStdString(), startOffset, std::move(callbacks))) {
+        qWarning() << "Failed to follow file:" << currentFilePath;
+        follower.reset();
+        return;
+    }
+    // Appends come from the file, so they are not unsaved edits, and undoing
+    // them would take lines out of the log; the undo history goes too.
+    if (!largeFileMode)
+        editor->document()->setUndoRedoEnabled(false);
+    sessionJournal->suspend();
+}
+
+void EditorUI::queueFollowFlush() {
+    {
+        QMutexLocker locker(&followMutex);
+        if (followFlushQueued)
+            return;
+        followFlushQueued = true;
+    }
+    QMetaObject::invokeMethod(this, &EditorUI::flushFollowedFile, Qt::QueuedConnection);
+}
+
+void EditorUI::flushFollowedFile() {
+    std::string appended;
+    bool reset;
+    {
+        QMutexLocker locker(&followMutex);
+        appended.swap(followPending);
+        reset = followReset;
+        followReset = false;
+        followFlushQueued = false;
+    }
+    if (!follower)
+        return;
+
+    QScrollBar* scrollBar = largeFileMode ? largeFileScrollBar : editor->verticalScrollBar();
+    bool atBottom = scrollBar->value() == scrollBar->maximum();
+
+    if (largeFileMode) {
+        if (reset) {
+            // Truncated or replaced: a file that grew back past its old size
+            // would look merely appended to, so the view is always remapped
+            // and reindexed from the start.
+            const std::string path = largeFile->path();
+            if (!largeFile->open(path)) {
+                qWarning() << "Failed to remap followed file:" << currentFilePath;
+                return;
+            }
+            largeFileScrollBar->setRange(0, 0);
+            indexProgressTimer->start(200);
+            onLargeFileScrolled(0);
+            return;
+        }
+        if (largeFile->extend()) {
+            refreshLargeFileIndex();
+            if (atBottom)
+                largeFileScrollBar->setValue(largeFileScrollBar->maximum());
+            else
+                onLargeFileScrolled(largeFileScrollBar->value());
+        }
+        return;
+    }
+
+    // The document only catches up with its file, so it is no more
+    // modified than before.
+    QTextDocument* document = editor->document();
+    const bool modified = document->isModified();
+    if (reset) {
+        editor->clear();
+        loadedSize = 0;
+    }
+    if (!appended.empty()) {
+        // Inserting at the end only touches the new blocks, so only they
+        // are highlighted and laid out.
+        QTextCursor tc(document);
+        tc.movePosition(QTextCursor::End);
+        tc.insertText(QString::fromStdString(appended));
+        loadedSize += static_cast<qint64>(appended.size());
+    }
+    document->setModified(modified);
+    if (atBottom)
+        scrollBar->setValue(scrollBar->maximum());
+}
+
+void EditorUI::onContentsChange(int position, int charsRemoved, int charsAdded) {
+    Q_UNUSED(charsRemoved);
+    SNSUPEAR_TRACE_SCOPE(Layout, "EditorUI::onContentsChange");
+    QTextDocument* document = editor->document();
+    QTextBlock first = document->findBlock(position);
+    QTextBlock last = document->findBlock(position + charsAdded);
+    if (!first.isValid())
+        first = document->lastBlock();
+    if (!last.isValid())
+        last = document->lastBlock();
+
+    // Blocks [first, last] now hold what oldCount blocks held before.
+    int newCount = last.blockNumber() - first.blockNumber() + 1;
+    int oldCount = newCount - (document->blockCount() - lastBlockCount);
+    lastBlockCount = document->blockCount();
+    if (oldCount < 1 || static_cast<size_t>(first.blockNumber() + oldCount) > foldIndex.lineCount()) {
+        first = document->begin();
+        last = document->lastBlock();
+        newCount = document->blockCount();
+        oldCount = static_cast<int>(foldIndex.lineCount());
+    }
+
+    changedShapes.clear();
+    for (QTextBlock block = first; block.isValid(); block = block.next()) {
+        QString text = block.text();
+        changedShapes.push_back(FoldIndex::shapeOf(
+            std::u16string_view(reinterpret_cast<const char16_t*>(text.utf16()), static_cast<size_t>(text.size()))));
+        if (block == last)
+            break;
+    }
+    size_t firstLine = static_cast<size_t>(first.blockNumber());
+    foldIndex.replaceLines(firstLine, static_cast<size_t>(oldCount), changedShapes);
+    minimap->linesChanged(firstLine, static_cast<size_t>(oldCount), static_cast<size_t>(newCount));
+    applyFolds(firstLine, static_cast<size_t>(oldCount), static_cast<size_t>(newCount));
+}
+
+/**
+ * @brief Brings block visibility in line with the fold index after an edit
+ * replaced lines [firstLine, firstLine + oldCount) with newCount lines, or
+ * after folds were opened or closed (all zero).
+ *
+ * Only blocks in hidden ranges that appeared, disappeared or were touched
+ * by the edit are visited, so typing with folds closed does not walk the
+ * document. Hidden blocks get no layout lines, so QPlainTextEdit scrolls
+ * past a collapsed region as if it were a single line.
+ */
+void EditorUI::applyFolds(size_t firstLine, size_t oldCount, size_t newCount) {
+    const std::vector<FoldRange>& ranges = foldIndex.hiddenRanges();
+    if (ranges.empty() && appliedFolds.empty())
+        return;
+
+    // Move the applied ranges to post-edit lines; ranges the edit touched
+    // are re-checked in full.
+    std::vector<std::pair<size_t, size_t>> dirty;
+    if (newCount > 0)
+        dirty.emplace_back(firstLine, firstLine + newCount - 1);
+    std::vector<FoldRange> moved;
+    for (FoldRange range : appliedFolds) {
+        if (range.lastHidden < firstLine) {
+            moved.push_back(range);
+        } else if (range.header >= firstLine + oldCount) {
+            moved.push_back({range.header + newCount - oldCount, range.lastHidden + newCount - oldCount});
+        } else {
+            size_t lastLine = range.lastHidden >= firstLine + oldCount ? range.lastHidden + newCount - oldCount
+                                                                        : firstLine + newCount;
+            dirty.emplace_back(std::min(range.header, firstLine), lastLine);
+        }
+    }
+    auto contains = [](const std::vector<FoldRange>& sorted, const FoldRange& range) {
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), range,
+                                   [](const FoldRange& a, const FoldRange& b) { return a.header < b.header; });
+        return it != sorted.end() && *it == range;
+    };
+    for (const FoldRange& range : moved) {
+        if (!contains(ranges, range))
+            dirty.emplace_back(range.header + 1, range.lastHidden);
+    }
+    for (const FoldRange& range : ranges) {
+        if (!contains(moved, range))
+            dirty.emplace_back(range.header + 1, range.lastHidden);
+    }
+
+    // Visibility is not content: the blocks are laid out again without a
+    // contentsChange, which would re-feed this view and the mirror.
+    QTextDocument* document = editor->document();
+    const size_t lastBlock = static_cast<size_t>(document->blockCount() - 1);
+    for (auto [from, to] : dirty) {
+        to = std::min(to, lastBlock);
+        if (from > to)
+            continue;
+        int start = -1;
+        int end = 0;
+        bool shown = false;
+        QTextBlock block = document->findBlockByNumber(static_cast<int>(from));
+        for (size_t line = from; line <= to && block.isValid(); ++line, block = block.next()) {
+            bool visible = !foldIndex.isHidden(line);
+            if (block.isVisible() == visible)
+                continue;
+            block.setVisible(visible);
+            if (start < 0)
+                start = block.position();
+            end = block.position() + block.length();
+            if (visible) {
+                syntaxHighlighter->rehighlightBlock(block);  // Skipped while hidden
+                shown = true;
+            }
+        }
+        if (start >= 0)
+            static_cast<EditorDocumentLayout*>(document->documentLayout())->relayout(start, end - start);
+        if (shown)
+            minimap->linesChanged(from, to - from + 1, to - from + 1);  // Now in colour
+    }
+    appliedFolds = ranges;
+    editor->viewport()->update();
+}
+
+void EditorUI::setFoldAtCursor(bool folded) {
+    if (largeFileMode) {
+        qWarning() << "Folding is disabled in large-file mode";
+        return;
+    }
+    size_t line = static_cast<size_t>(editor->textCursor().blockNumber());
+    if (folded) {
+        std::optional<FoldRange> range = foldIndex.enclosingFold(line);
+        if (!range || !foldIndex.fold(range->header))
+            return;
+        // Keep the cursor out of the hidden blocks
+        QTextCursor tc(editor->document()->findBlockByNumber(static_cast<int>(range->header)));
+        tc.movePosition(QTextCursor::EndOfBlock);
+        editor->setTextCursor(tc);
+    } else if (!foldIndex.unfold(line)) {
+        std::optional<FoldRange> range = foldIndex.enclosingFold(line);
+        if (!range || !foldIndex.unfold(range->header))
+            return;
+    }
+    applyFolds();
+}
+
+std::vector<OutlineEntry> EditorUI::outline() const {
+    return foldIndex.outline();
+}
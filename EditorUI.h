@@ -8,19 +8,49 @@
 #include <QVBoxLayout>
 #include <QJsonObject>
 #include <QCompleter>
+#include <QStringListModel>
 #include <QShortcut>
 #include <QTimer>
+#include <QScrollBar>
+#include <QMutex>
+#include <QTabBar>
+#include <QTextCursor>
+#include <QDateTime>
+#include <map>
+#include <memory>
 
 #include "AIAssistant.h" 
 #include "SyntaxHighlighter.h"
 #include "CodeFormatter.h" 
+#include "large_file_view.h"
+#include "file_follower.h"
+#include "latency_hud.h"
+#include "document_mirror.h"
+#include "edit_trace_recorder.h"
+#include "session_journal.h"
+#include "fold_index.h"
+#include "minimap.h"
+#include "diagnostics_overlay.h"
+#include "workspace.h"
 
 class EditorUI : public QWidget {
     Q_OBJECT
 
 public:
     explicit EditorUI(QWidget* parent = nullptr);
+    ~EditorUI() override;
     void applyTheme(const QString& themeName);
+    void openFile(const QString& path);
+    void openFiles(const QStringList& paths);
+    bool saveFile();
+    void goToOffset(qint64 offset);
+    void setFollowMode(bool enabled);
+    bool exportLatencyTrace(const QString& path);
+    void setTraceRecording(bool enabled);
+    std::vector<OutlineEntry> outline() const;
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
 
 private slots:
     void onAIResponseReceived(const QString& response);
@@ -28,6 +58,12 @@ private slots:
     void onTextChanged();
     void requestCompletion();
     void insertCompletion(const QString& completion);
+    void onLargeFileScrolled(int firstLine);
+    void refreshLargeFileIndex();
+    void flushFollowedFile();
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void onTabChanged(int index);
+    void closeTab(int index);
 
 private:
     QPlainTextEdit* editor;
@@ -36,12 +72,94 @@ private:
     CodeFormatter* codeFormatter;
     QDockWidget* chatDock;
     QCompleter* completer;
+    QStringListModel* completionModel;
     QTimer* debounceTimer;
+    QTabBar* tabBar;
+
+    // Open files: the workspace loads and prefetches their text in the
+    // background and hands it over when a tab is first shown, and each tab
+    // then keeps its own document, with its undo history, highlighting,
+    // folds, view and mirror, so switching tabs only swaps documents. The
+    // shown tab's fold state lives in the members further down and is
+    // swapped back into its Tab when another one is shown.
+    struct Tab {
+        QTextDocument* document = nullptr;
+        SyntaxHighlighter* highlighter = nullptr;
+        // Byte-offset mirror of the document shared by the trace recorder,
+        // the crash-recovery journal and the diagnostics; held while loaded.
+        DocumentMirror* mirror = nullptr;
+        FoldIndex foldIndex;
+        std::vector<FoldRange> appliedFolds;
+        int lastBlockCount = 1;
+        qint64 loadedSize = 0;
+        QTextCursor cursor;
+        int scrollValue = 0;
+        QDateTime lastModified;  ///< Of the file when its text was loaded.
+        bool loaded = false;     ///< Holds the file's text, not a large-file window.
+        bool loading = false;    ///< Waiting for the workspace (see onFileLoaded).
+    };
+    Workspace workspace;
+    std::map<QString, Tab> tabs;
+    Tab untitled;                ///< Shown while no file is open.
+    Tab* currentTab = &untitled;
+    QJsonObject currentTheme;
+
+    // Large-file mode: the editor only holds the visible window of a mapped
+    // file and whole-document features are switched off.
+    std::unique_ptr<LargeFileView> largeFile;
+    QScrollBar* largeFileScrollBar;
+    QTimer* indexProgressTimer;
+    bool largeFileMode = false;
+    QString currentFilePath;
+    qint64 loadedSize = 0;
+
+    // Follow mode: the follower thread queues appended bytes here and one
+    // queued flush drains them, so bursts coalesce into a single insert.
+    std::unique_ptr<FileFollower> follower;
+    QMutex followMutex;
+    std::string followPending;
+    bool followReset = false;
+    bool followFlushQueued = false;
+
+    // Latency tracing: a keystroke is timed from its KeyPress to the end of
+    // the next viewport paint (see eventFilter).
+    LatencyHud* latencyHud;
+    quint64 keyPressStart = 0;
+    bool tracingPaint = false;
+
+    // Edit-trace recording for snsupear_replay (Ctrl+Shift+R)
+    EditTraceRecorder* traceRecorder;
+
+    // Crash-recovery journal of the open file's unsaved edits
+    SessionJournal* sessionJournal;
+
+    Minimap* minimap;
+
+    // Background lint and compiler diagnostics, drawn over the viewport
+    DiagnosticsOverlay* diagnosticsOverlay;
+
+    // Code folding: line shapes are updated per edit and closed folds hide
+    // their blocks, which the document layout then skips.
+    FoldIndex foldIndex;
+    std::vector<FoldRange> appliedFolds;  ///< Hidden ranges the blocks currently reflect.
+    std::vector<LineShape> changedShapes;
+    int lastBlockCount = 1;
 
     void setupUI();
     void setupConnections();
     void setupShortcuts();
     void showCompletionPopup(const QStringList& suggestions);
+    bool enterLargeFileMode(const QString& path);
+    void leaveLargeFileMode();
+    int visibleLineCount() const;
+    void queueFollowFlush();
+    void showTab(const QString& path);
+    void stashCurrentDocument();
+    void showTabDocument(Tab& tab);
+    void showUntitled();
+    void onFileLoaded(const QString& path, const QString& error);
+    void setFoldAtCursor(bool folded);
+    void applyFolds(size_t firstLine = 0, size_t oldCount = 0, size_t newCount = 0);
 };
 
 #endif // EDITOR_UI_H
@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "fixtures.h"
+
+#ifdef SNSUPEAR_BENCH_QT
+#include <QGuiApplication>
+#endif
+
+void registerEngineBenchmarks(size_t maxBytes);
+#ifdef SNSUPEAR_BENCH_QT
+void registerQtBenchmarks(size_t maxBytes);
+#endif
+
+namespace {
+
+// Accepts plain byte counts or KB/MB/GB suffixes.
+size_t parseBytes(const std::string& text) {
+    char* end = nullptr;
+    size_t value = std::strtoull(text.c_str(), &end, 10);
+    std::string unit(end);
+    if (unit == "KB") return value << 10;
+    if (unit == "MB") return value << 20;
+    if (unit == "GB") return value << 30;
+    return value;
+}
+
+} // namespace
+
+/**
+ * @brief Entry point of snsupear_bench.
+ *
+ * Besides the usual --benchmark_* flags (use --benchmark_format=json or
+ * --benchmark_out=FILE --benchmark_out_format=json for machine-readable
+ * results) it accepts:
+ *   --max_bytes=SIZE     largest buffer size to run, default 64MB; pass
+ *                        1GB for the full range
+ *   --fixture_dir=PATH   where generated fixtures are cached
+ */
+int main(int argc, char** argv) {
+#ifdef SNSUPEAR_BENCH_QT
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+#endif
+
+    benchmark::Initialize(&argc, argv);
+
+    size_t maxBytes = size_t(64) << 20;
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--max_bytes=", 12) == 0) {
+            maxBytes = parseBytes(argv[i] + 12);
+        } else if (std::strncmp(argv[i], "--fixture_dir=", 14) == 0) {
+            setFixtureDirectory(argv[i] + 14);
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    registerEngineBenchmarks(maxBytes);
+#ifdef SNSUPEAR_BENCH_QT
+    registerQtBenchmarks(maxBytes);
+#endif
+
+    benchmark::AddCustomContext("fixture_dir", fixtureDirectory());
+    benchmark::AddCustomContext("max_bytes", sizeLabel(maxBytes));
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,387 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "diagnostics.h"
+#include "edit_journal.h"
+#include "fixtures.h"
+#include "large_file_view.h"
+#include "minimap_tiles.h"
+#include "search_engine.h"
+#include "text_buffer.h"
+#include "workspace.h"
+
+namespace {
+
+const size_t kSizes[] = {size_t(1) << 10, size_t(64) << 10, size_t(1) << 20, size_t(64) << 20, size_t(1) << 30};
+
+// Loading a large fixture dwarfs most measurements, so benchmarks of the
+// same size share one buffer. Registration runs the read-only benchmarks of
+// a size first and the editing ones last, so only pristine text is measured
+// by lookups and searches.
+TextBuffer& sharedBuffer(size_t bytes) {
+    static std::unique_ptr<TextBuffer> buffer;
+    static size_t loadedBytes = 0;
+    if (!buffer || loadedBytes != bytes) {
+        buffer.reset();
+        buffer = std::make_unique<TextBuffer>();
+        buffer->loadFile(fixtureFile(FixtureLanguage::Cpp, bytes));
+        loadedBytes = bytes;
+    }
+    return *buffer;
+}
+
+void textBufferInsert(benchmark::State& state, size_t bytes) {
+    TextBuffer& buffer = sharedBuffer(bytes);
+    std::mt19937_64 rng(1);
+    for (auto _ : state) {
+        buffer.insertText("x", rng() % (buffer.getLength() + 1));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void textBufferDelete(benchmark::State& state, size_t bytes) {
+    TextBuffer& buffer = sharedBuffer(bytes);
+    std::mt19937_64 rng(2);
+    for (auto _ : state) {
+        size_t length = buffer.getLength();
+        if (length < bytes / 2) {
+            state.PauseTiming();
+            buffer.loadFile(fixtureFile(FixtureLanguage::Cpp, bytes));
+            length = buffer.getLength();
+            state.ResumeTiming();
+        }
+        size_t start = rng() % length;
+        buffer.deleteText(start, start + 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void textBufferGetLine(benchmark::State& state, size_t bytes) {
+    TextBuffer& buffer = sharedBuffer(bytes);
+    std::mt19937_64 rng(3);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buffer.getLine(rng() % buffer.getLineCount()));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void textBufferLoad(benchmark::State& state, size_t bytes) {
+    std::string path = fixtureFile(FixtureLanguage::Cpp, bytes);
+    size_t memory = 0;
+    for (auto _ : state) {
+        TextBuffer buffer;
+        buffer.loadFile(path);
+        benchmark::DoNotOptimize(buffer.getLineCount());
+        memory = buffer.memoryUsage();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.counters["memory_per_byte"] = static_cast<double>(memory) / static_cast<double>(bytes);
+}
+
+void textBufferLineOfOffset(benchmark::State& state, size_t bytes) {
+    TextBuffer& buffer = sharedBuffer(bytes);
+    std::mt19937_64 rng(4);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buffer.lineOfOffset(rng() % buffer.getLength()));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void largeFileIndex(benchmark::State& state, size_t bytes) {
+    std::string path = fixtureFile(FixtureLanguage::Cpp, bytes);
+    for (auto _ : state) {
+        LargeFileView view;
+        if (!view.open(path)) {
+            state.SkipWithError("cannot map fixture");
+            break;
+        }
+        while (!view.isIndexed()) {
+            std::this_thread::yield();
+        }
+        benchmark::DoNotOptimize(view.lineCount());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+
+enum SearchMode { Literal, CaseInsensitive, WholeWord, Regex };
+
+void findInBufferBench(benchmark::State& state, size_t bytes, SearchMode mode) {
+    TextBuffer& buffer = sharedBuffer(bytes);
+    SearchOptions options;
+    options.caseSensitive = mode != CaseInsensitive;
+    options.wholeWord = mode == WholeWord;
+    options.regex = mode == Regex;
+    const std::string pattern = mode == Regex ? "cursor_[0-9]+" : "cursor";
+    size_t matches = 0;
+    for (auto _ : state) {
+        matches = findInBuffer(buffer, pattern, options).size();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.counters["matches"] = static_cast<double>(matches);
+}
+
+void projectSearch(benchmark::State& state) {
+    std::string root = fixtureTree(256, size_t(64) << 10);
+    ProjectSearch search;
+    for (auto _ : state) {
+        std::atomic<size_t> files{0};
+        search.start(root, "cursor", SearchOptions(), [&files](const FileSearchResult&) { ++files; });
+        search.wait();
+        benchmark::DoNotOptimize(files.load());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * 256 * (size_t(64) << 10)));
+}
+
+std::vector<std::string> workspaceFiles() {
+    static const std::vector<std::string> files = [] {
+        std::vector<std::string> paths;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(fixtureTree(256, size_t(64) << 10))) {
+            if (entry.is_regular_file()) {
+                paths.push_back(entry.path().string());
+            }
+        }
+        return paths;
+    }();
+    return files;
+}
+
+// Opening a project's files into a cold workspace: in parallel, or one
+// TextBuffer::loadFile after another as a single-document editor would.
+void workspaceOpenAll(benchmark::State& state, bool parallel) {
+    const std::vector<std::string>& files = workspaceFiles();
+    for (auto _ : state) {
+        if (parallel) {
+            Workspace workspace;
+            workspace.openAll(files);
+            workspace.waitIdle();
+        } else {
+            for (const std::string& path : files) {
+                TextBuffer buffer;
+                buffer.loadFile(path);
+                benchmark::DoNotOptimize(buffer.getLength());
+            }
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * files.size()));
+}
+
+// Acquiring a cached file, including the on-disk change check. A tab switch
+// in the editor only does this the first time a tab is shown.
+void workspaceAcquireCached(benchmark::State& state) {
+    const std::vector<std::string>& files = workspaceFiles();
+    WorkspaceOptions options;
+    options.prefetchNeighbours = 0;
+    options.recentFiles = 0;
+    Workspace workspace(options);
+    workspace.openAll(files);
+    workspace.waitIdle();
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(workspace.acquire(files[next]));
+        next = (next + 7) % files.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Line summaries of a million-line document, as the highlighter leaves them.
+const std::vector<MinimapCells>& minimapLines() {
+    static const std::vector<MinimapCells> lines = [] {
+        const size_t kLines = 1000000;
+        std::string source = generateSource(FixtureLanguage::Cpp, size_t(64) << 20);
+        std::vector<MinimapCells> summaries;
+        summaries.reserve(kLines);
+        std::u16string line;
+        for (size_t i = 0; i < source.size() && summaries.size() < kLines; ++i) {
+            if (source[i] != '\n') {
+                line += static_cast<char16_t>(static_cast<unsigned char>(source[i]));
+                continue;
+            }
+            MinimapSpan span{0, static_cast<int32_t>(line.size() / 2), static_cast<uint8_t>(summaries.size() % 7)};
+            summaries.emplace_back();
+            MinimapTiles::summarize(line, &span, 1, summaries.back());
+            line.clear();
+        }
+        while (summaries.size() < kLines) {
+            summaries.push_back(summaries[summaries.size() % 1000]);
+        }
+        return summaries;
+    }();
+    return lines;
+}
+
+// One minimap frame: an edit on a visible line (or none), then the tiles
+// covering a 1000-pixel-high strip, scrolled by `scrollLines` per frame.
+void minimapFrame(benchmark::State& state, bool edit, size_t scrollLines) {
+    const std::vector<MinimapCells>& lines = minimapLines();
+    MinimapTiles tiles;
+    const size_t rows = 1000 / MinimapTiles::kLinePixels;
+    size_t top = lines.size() / 2;
+    for (auto _ : state) {
+        if (edit) {
+            tiles.linesChanged(top + rows / 2, 1, 1);
+        }
+        for (size_t index = top / MinimapTiles::kTileLines; index * MinimapTiles::kTileLines < top + rows; ++index) {
+            benchmark::DoNotOptimize(
+                tiles.tile(index, lines.size(), [&lines](size_t line) { return &lines[line]; }));
+        }
+        top = (top + scrollLines) % (lines.size() - rows);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+std::string journalDirectory(const char* name) {
+    return fixtureDirectory() + "/journal/" + name;
+}
+
+// What typing costs the UI thread: encoding and queueing one keystroke.
+// The writer thread commits in the background.
+void journalAppend(benchmark::State& state) {
+    const std::string text = generateSource(FixtureLanguage::Cpp, size_t(1) << 20);
+    EditJournal journal(journalDirectory("append"), text, true);
+    size_t offset = text.size() / 2;
+    for (auto _ : state) {
+        journal.append({{offset, offset, "x"}});
+        ++offset;
+        if (journal.wantsCheckpoint()) {
+            state.PauseTiming();
+            journal.sync();
+            journal.checkpoint(text, false);
+            offset = text.size() / 2;
+            state.ResumeTiming();
+        }
+    }
+    journal.sync();
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Startup recovery of a 1 MB document with `batches` unsaved keystrokes.
+void journalRecover(benchmark::State& state, size_t batches) {
+    const std::string directory = journalDirectory("recover");
+    {
+        const std::string text = generateSource(FixtureLanguage::Cpp, size_t(1) << 20);
+        EditJournal journal(directory, text, true);
+        std::mt19937_64 rng(7);
+        size_t length = text.size();
+        for (size_t i = 0; i < batches; ++i) {
+            size_t offset = rng() % length;
+            journal.append({{offset, offset, "x"}});
+            ++length;
+        }
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(EditJournal::recover(directory));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// The built-in checks over a whole file, as a worker runs them.
+void diagnosticsLint(benchmark::State& state) {
+    const std::string text = generateSource(FixtureLanguage::Cpp, size_t(1) << 20);
+    LintProvider lint;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lint.analyze("bench.cpp", text));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+
+// One diagnostic every kilobyte of a 1 MB document.
+std::vector<Diagnostic> spreadDiagnostics() {
+    std::vector<Diagnostic> diagnostics;
+    for (size_t offset = 0; offset < (size_t(1) << 20); offset += 1024) {
+        diagnostics.push_back({offset + 10, offset + 16, DiagnosticSeverity::Warning, "unused variable"});
+    }
+    return diagnostics;
+}
+
+// What a keystroke costs the UI thread with diagnostics shown: every one
+// of them is moved by an insertion at the top while a snapshot is out.
+void diagnosticsApplyEdit(benchmark::State& state) {
+    DocumentDiagnostics document;
+    std::vector<ByteRange> damaged;
+    document.accept(document.snapshotTaken(), spreadDiagnostics(), damaged);
+    document.snapshotTaken();
+    for (auto _ : state) {
+        document.applyEdits({{0, 0, "x"}}, damaged);
+        damaged.clear();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Showing results that are `batches` keystrokes behind the text.
+void diagnosticsAccept(benchmark::State& state, size_t batches) {
+    const std::vector<Diagnostic> results = spreadDiagnostics();
+    std::vector<ByteRange> damaged;
+    for (auto _ : state) {
+        state.PauseTiming();
+        DocumentDiagnostics document;
+        const uint64_t revision = document.snapshotTaken();
+        for (size_t i = 0; i < batches; ++i) {
+            document.applyEdits({{i * 7, i * 7, "x"}}, damaged);
+        }
+        std::vector<Diagnostic> copy = results;
+        state.ResumeTiming();
+        document.accept(revision, std::move(copy), damaged);
+        damaged.clear();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+void registerEngineBenchmarks(size_t maxBytes) {
+    for (size_t bytes : kSizes) {
+        if (bytes > maxBytes) {
+            continue;
+        }
+        const std::string label = sizeLabel(bytes);
+        benchmark::RegisterBenchmark(("TextBuffer/GetLine/" + label).c_str(), textBufferGetLine, bytes);
+        benchmark::RegisterBenchmark(("LineIndex/LineOfOffset/" + label).c_str(), textBufferLineOfOffset, bytes);
+        benchmark::RegisterBenchmark(("LineIndex/TextBufferLoad/" + label).c_str(), textBufferLoad, bytes)
+            ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("LineIndex/LargeFileView/" + label).c_str(), largeFileIndex, bytes)
+            ->Unit(benchmark::kMillisecond)
+            ->UseRealTime();
+
+        benchmark::RegisterBenchmark(("Search/Literal/" + label).c_str(), findInBufferBench, bytes, Literal)
+            ->Unit(benchmark::kMicrosecond);
+        benchmark::RegisterBenchmark(("Search/CaseInsensitive/" + label).c_str(), findInBufferBench, bytes,
+                                     CaseInsensitive)
+            ->Unit(benchmark::kMicrosecond);
+        benchmark::RegisterBenchmark(("Search/WholeWord/" + label).c_str(), findInBufferBench, bytes, WholeWord)
+            ->Unit(benchmark::kMicrosecond);
+        // std::regex runs far slower than the literal path; beyond 1 MB a
+        // single iteration takes longer than the whole suite is worth.
+        if (bytes <= (size_t(1) << 20)) {
+            benchmark::RegisterBenchmark(("Search/Regex/" + label).c_str(), findInBufferBench, bytes, Regex)
+                ->Unit(benchmark::kMicrosecond);
+        }
+
+        benchmark::RegisterBenchmark(("TextBuffer/Insert/" + label).c_str(), textBufferInsert, bytes);
+        benchmark::RegisterBenchmark(("TextBuffer/Delete/" + label).c_str(), textBufferDelete, bytes);
+    }
+    benchmark::RegisterBenchmark("Minimap/Frame/1Mlines", minimapFrame, false, size_t(0));
+    benchmark::RegisterBenchmark("Minimap/FrameAfterEdit/1Mlines", minimapFrame, true, size_t(0));
+    benchmark::RegisterBenchmark("Minimap/Scroll/1Mlines", minimapFrame, false, size_t(20));
+    benchmark::RegisterBenchmark("Journal/Append", journalAppend);
+    benchmark::RegisterBenchmark("Journal/Recover/1MB+1k", journalRecover, size_t(1000))->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("Journal/Recover/1MB+10k", journalRecover, size_t(10000))
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("Workspace/OpenAll/256x64KB", workspaceOpenAll, true)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark("Workspace/OpenSequential/256x64KB", workspaceOpenAll, false)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark("Workspace/AcquireCached/256x64KB", workspaceAcquireCached);
+    benchmark::RegisterBenchmark("Diagnostics/Lint/1MB", diagnosticsLint)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("Diagnostics/ApplyEdit/1k", diagnosticsApplyEdit);
+    benchmark::RegisterBenchmark("Diagnostics/Accept/1k+100edits", diagnosticsAccept, size_t(100))
+        ->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("Search/Project/256x64KB", projectSearch)->Unit(benchmark::kMillisecond)->UseRealTime();
+}
@@ -0,0 +1,191 @@
+#include "fixtures.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Vocabulary {
+    std::vector<std::string> keywords;
+    std::vector<std::string> types;
+    std::string lineComment;
+    std::string functionOpen;   ///< Printf-style: %s is the function name.
+    std::string functionClose;
+    std::string statementEnd;
+    std::string blockOpen;
+    std::string blockClose;
+};
+
+const Vocabulary& vocabulary(FixtureLanguage language) {
+    static const Vocabulary cpp{
+        {"if", "for", "while", "return", "const", "auto", "static", "switch", "case", "break"},
+        {"int", "size_t", "double", "bool", "char", "std::string", "std::vector<int>"},
+        "// ", "void %s() {", "}", ";", " {", "}"};
+    static const Vocabulary python{
+        {"if", "for", "while", "return", "in", "not", "and", "lambda", "with", "yield"},
+        {"int", "str", "float", "list", "dict", "bool", "bytes"},
+        "# ", "def %s(self):", "", "", ":", ""};
+    static const Vocabulary javascript{
+        {"if", "for", "while", "return", "const", "let", "await", "async", "typeof", "new"},
+        {"Number", "String", "Array", "Object", "Map", "Promise", "Boolean"},
+        "// ", "function %s() {", "}", ";", " {", "}"};
+    switch (language) {
+    case FixtureLanguage::Python:
+        return python;
+    case FixtureLanguage::JavaScript:
+        return javascript;
+    default:
+        return cpp;
+    }
+}
+
+const char* const kWords[] = {"buffer", "line", "offset", "count", "value", "index", "result", "node",
+                              "text", "range", "start", "end", "cursor", "token", "state", "length"};
+
+fs::path& directoryPath() {
+    static fs::path path = fs::temp_directory_path() / "snsupear-bench";
+    return path;
+}
+
+} // namespace
+
+const char* fixtureLanguageName(FixtureLanguage language) {
+    switch (language) {
+    case FixtureLanguage::Python:
+        return "python";
+    case FixtureLanguage::JavaScript:
+        return "javascript";
+    default:
+        return "cpp";
+    }
+}
+
+std::string generateSource(FixtureLanguage language, size_t bytes, uint32_t seed) {
+    const Vocabulary& vocab = vocabulary(language);
+    std::mt19937 rng(seed);
+    auto pick = [&rng](const auto& list) -> const std::string& { return list[rng() % list.size()]; };
+    auto word = [&rng]() { return std::string(kWords[rng() % (sizeof(kWords) / sizeof(kWords[0]))]); };
+
+    std::string out;
+    out.reserve(bytes + 256);
+    size_t function = 0;
+    while (out.size() < bytes) {
+        std::string name = word() + "_" + std::to_string(function++);
+        std::string open = vocab.functionOpen;
+        open.replace(open.find("%s"), 2, name);
+        out += open + "\n";
+
+        int statements = 4 + static_cast<int>(rng() % 12);
+        int depth = 1;
+        for (int s = 0; s < statements; ++s) {
+            std::string indent(static_cast<size_t>(depth) * 4, ' ');
+            switch (rng() % 6) {
+            case 0:
+                out += indent + vocab.lineComment + word() + " " + word() + " " + word() + "\n";
+                break;
+            case 1:
+                out += indent + pick(vocab.keywords) + " " + word() + " < " + std::to_string(rng() % 10000)
+                       + vocab.blockOpen + "\n";
+                if (depth < 6) {
+                    ++depth;
+                }
+                break;
+            case 2:
+                out += indent + pick(vocab.types) + " " + word() + " = \"" + word() + " " + word() + "\""
+                       + vocab.statementEnd + "\n";
+                break;
+            case 3:
+                out += indent + word() + "(" + word() + ", " + std::to_string(rng() % 1000) + "." +
+                       std::to_string(rng() % 100) + ")" + vocab.statementEnd + "\n";
+                break;
+            case 4:
+                if (depth > 1) {
+                    --depth;
+                    if (!vocab.blockClose.empty()) {
+                        out += std::string(static_cast<size_t>(depth) * 4, ' ') + vocab.blockClose + "\n";
+                    }
+                    break;
+                }
+                [[fallthrough]];
+            default:
+                out += indent + pick(vocab.keywords) + " " + word() + " + " + word() + vocab.statementEnd + "\n";
+                break;
+            }
+        }
+        while (depth > 1) {
+            --depth;
+            if (!vocab.blockClose.empty()) {
+                out += std::string(static_cast<size_t>(depth) * 4, ' ') + vocab.blockClose + "\n";
+            }
+        }
+        if (!vocab.functionClose.empty()) {
+            out += vocab.functionClose + "\n";
+        }
+        out += "\n";
+    }
+    out.resize(bytes);
+    return out;
+}
+
+std::string fixtureFile(FixtureLanguage language, size_t bytes) {
+    fs::create_directories(directoryPath());
+    fs::path path = directoryPath() / (std::string(fixtureLanguageName(language)) + "-" + sizeLabel(bytes) + ".txt");
+    std::error_code error;
+    if (fs::file_size(path, error) == bytes && !error) {
+        return path.string();
+    }
+
+    // Written in slices so a 1 GB fixture never needs 1 GB of scratch.
+    constexpr size_t kSlice = size_t(64) << 20;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    for (size_t written = 0, slice = 0; written < bytes; ++slice) {
+        std::string chunk = generateSource(language, std::min(kSlice, bytes - written), 42 + static_cast<uint32_t>(slice));
+        out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        written += chunk.size();
+    }
+    if (!out) {
+        throw std::runtime_error("Failed to write fixture " + path.string());
+    }
+    return path.string();
+}
+
+std::string fixtureTree(size_t files, size_t bytesPerFile) {
+    fs::path root = directoryPath() / ("tree-" + std::to_string(files) + "x" + sizeLabel(bytesPerFile));
+    fs::path marker = root / ".complete";
+    if (fs::exists(marker)) {
+        return root.string();
+    }
+
+    for (size_t i = 0; i < files; ++i) {
+        auto language = static_cast<FixtureLanguage>(i % 3);
+        fs::path directory = root / ("module" + std::to_string(i % 8));
+        fs::create_directories(directory);
+        std::ofstream out(directory / ("file" + std::to_string(i) + ".txt"), std::ios::binary | std::ios::trunc);
+        out << generateSource(language, bytesPerFile, static_cast<uint32_t>(i));
+    }
+    std::ofstream(marker).put('\n');
+    return root.string();
+}
+
+void setFixtureDirectory(const std::string& directory) {
+    directoryPath() = directory;
+}
+
+std::string fixtureDirectory() {
+    return directoryPath().string();
+}
+
+std::string sizeLabel(size_t bytes) {
+    static const char* const units[] = {"B", "KB", "MB", "GB"};
+    size_t unit = 0;
+    while (unit + 1 < 4 && bytes >= 1024 && bytes % 1024 == 0) {
+        bytes /= 1024;
+        ++unit;
+    }
+    return std::to_string(bytes) + units[unit];
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Languages the fixture generator can imitate.
+ */
+enum class FixtureLanguage { Cpp, Python, JavaScript };
+
+const char* fixtureLanguageName(FixtureLanguage language);
+
+/**
+ * @brief Generates exactly @p bytes of plausible source text.
+ *
+ * Output is deterministic for a given language, size and seed: functions
+ * with keywords, identifiers, numbers, string literals, comments and
+ * indentation in roughly the proportions of real code, so highlighting and
+ * search costs resemble an editing session rather than random bytes.
+ */
+std::string generateSource(FixtureLanguage language, size_t bytes, uint32_t seed = 42);
+
+/**
+ * @brief Path of a generated fixture file, written on first use into the
+ * fixture directory and reused by later runs if its size still matches.
+ */
+std::string fixtureFile(FixtureLanguage language, size_t bytes);
+
+/**
+ * @brief Directory holding @p files generated sources of @p bytesPerFile
+ * each, spread over a few subdirectories, for find-in-files runs.
+ */
+std::string fixtureTree(size_t files, size_t bytesPerFile);
+
+/**
+ * @brief Where fixtures are written; defaults to <tmp>/snsupear-bench.
+ */
+void setFixtureDirectory(const std::string& directory);
+std::string fixtureDirectory();
+
+/**
+ * @brief "1KB", "64MB", "1GB" style label for a byte count.
+ */
+std::string sizeLabel(size_t bytes);
@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+
+#include <QString>
+#include <QTextDocument>
+
+#include "code_formatter.h"
+#include "fixtures.h"
+#include "syntax_highlighter.h"
+
+namespace {
+
+void highlight(benchmark::State& state, FixtureLanguage language, size_t bytes) {
+    QTextDocument document;
+    document.setPlainText(QString::fromStdString(generateSource(language, bytes)));
+    SyntaxHighlighter highlighter(&document);
+    highlighter.setLanguage(QString::fromLatin1(fixtureLanguageName(language)));
+    // rehighlight() runs highlightBlock() over every block of the document.
+    for (auto _ : state) {
+        highlighter.rehighlight();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.counters["blocks"] = document.blockCount();
+}
+
+void formatRoundTrip(benchmark::State& state, size_t bytes) {
+    CodeFormatter formatter;
+    const QString source = QString::fromStdString(generateSource(FixtureLanguage::Cpp, bytes));
+    for (auto _ : state) {
+        QString once = formatter.formatCode(source);
+        if (once.isEmpty()) {
+            state.SkipWithError("clang-format failed or is not installed");
+            break;
+        }
+        // A second pass over formatted code must be a no-op.
+        if (formatter.formatCode(once) != once) {
+            state.SkipWithError("formatting is not idempotent");
+            break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes * 2));
+}
+
+} // namespace
+
+void registerQtBenchmarks(size_t maxBytes) {
+    const FixtureLanguage languages[] = {FixtureLanguage::Cpp, FixtureLanguage::Python, FixtureLanguage::JavaScript};
+    const size_t sizes[] = {size_t(64) << 10, size_t(1) << 20};
+    for (FixtureLanguage language : languages) {
+        for (size_t bytes : sizes) {
+            if (bytes > maxBytes) {
+                continue;
+            }
+            std::string name = std::string("Highlight/") + fixtureLanguageName(language) + "/" + sizeLabel(bytes);
+            benchmark::RegisterBenchmark(name.c_str(), highlight, language, bytes)->Unit(benchmark::kMillisecond);
+        }
+    }
+    for (size_t bytes : {size_t(1) << 10, size_t(64) << 10}) {
+        if (bytes <= maxBytes) {
+            benchmark::RegisterBenchmark(("Formatter/RoundTrip/cpp/" + sizeLabel(bytes)).c_str(), formatRoundTrip, bytes)
+                ->Unit(benchmark::kMillisecond)
+                ->UseRealTime();
+        }
+    }
+}
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "edit_trace.h"
+#include "fold_index.h"
+#include "line_checksum.h"
+#include "text_buffer.h"
+
+#ifdef SNSUPEAR_BENCH_QT
+#include <QGuiApplication>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+
+#include "code_formatter.h"
+#include "syntax_highlighter.h"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Stage {
+    const char* name;
+    std::vector<double> micros;
+    uint64_t allocations = 0;  ///< Heap allocations, with SNSUPEAR_COUNT_ALLOCATIONS.
+
+    void add(Clock::time_point start, const AllocationScope& scope) {
+        micros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        allocations += scope.allocations();
+    }
+};
+
+struct Options {
+    std::string path;
+    int repeat = 1;
+    bool json = false;
+    bool highlight = true;
+    bool format = true;
+};
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    auto nth = values.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+#ifdef SNSUPEAR_BENCH_QT
+// Qt position of a byte offset, given the buffer and document before the
+// batch that contains it.
+int documentPosition(const TextBuffer& buffer, const QTextDocument& document, size_t offset) {
+    size_t line = buffer.lineOfOffset(offset);
+    std::string_view prefix = buffer.lineView(line).substr(0, offset - buffer.offsetOfLine(line));
+    return document.findBlockByNumber(static_cast<int>(line)).position() + static_cast<int>(utf16UnitsInUtf8(prefix));
+}
+#endif
+
+} // namespace
+
+/**
+ * @brief Headless replay of an edit trace recorded by the editor.
+ *
+ * Usage: snsupear_replay TRACE [--repeat N] [--json] [--no-highlight]
+ *        [--no-format]
+ *
+ * Every Edits record is applied to a TextBuffer exactly as insertText /
+ * deleteText would, then to a FoldIndex, and, when built with Qt, to a
+ * QTextDocument carrying the SyntaxHighlighter; Format records run
+ * CodeFormatter. Each operation is
+ * timed and the percentiles reported. The final buffer is checked against
+ * the checksum in the trace's End record; a mismatch exits with status 1.
+ * Built with SNSUPEAR_COUNT_ALLOCATIONS, heap allocations per operation
+ * are reported as well.
+ */
+int main(int argc, char** argv) {
+#ifdef SNSUPEAR_BENCH_QT
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+#endif
+
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            options.repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            options.json = true;
+        } else if (std::strcmp(argv[i], "--no-highlight") == 0) {
+            options.highlight = false;
+        } else if (std::strcmp(argv[i], "--no-format") == 0) {
+            options.format = false;
+        } else if (options.path.empty()) {
+            options.path = argv[i];
+        } else {
+            std::cerr << "Unexpected argument: " << argv[i] << std::endl;
+            return 2;
+        }
+    }
+    if (options.path.empty()) {
+        std::cerr << "Usage: snsupear_replay TRACE [--repeat N] [--json] [--no-highlight] [--no-format]" << std::endl;
+        return 2;
+    }
+
+    std::vector<EditTraceRecord> records;
+    try {
+        records = readEditTrace(options.path);
+    } catch (const std::exception& e) {
+        std::cerr << options.path << ": " << e.what() << std::endl;
+        return 2;
+    }
+    if (records.empty() || records.front().kind != EditTraceKind::Snapshot) {
+        std::cerr << options.path << ": trace does not start with a snapshot" << std::endl;
+        return 2;
+    }
+    const EditTraceRecord& snapshot = records.front();
+
+    Stage insertStage{"insertText", {}};
+    Stage deleteStage{"deleteText", {}};
+    Stage replaceStage{"replace", {}};
+    Stage foldStage{"folds", {}};
+    Stage highlightStage{"highlight", {}};
+    Stage completionStage{"completion", {}};
+    Stage formatStage{"format", {}};
+    size_t editRecords = 0;
+    size_t bytesInserted = 0;
+    bool checksumOk = true;
+    bool sawEnd = false;
+
+    auto replayStart = Clock::now();
+    for (int run = 0; run < options.repeat; ++run) {
+        TextBuffer buffer;
+        buffer.applyExternalEdits({{0, 0, snapshot.text}});
+        FoldIndex folds;
+        folds.reset(buffer);
+        DamageRegion damage{};
+        buffer.addChangeListener([&damage](const DamageRegion& region) { damage = region; });
+#ifdef SNSUPEAR_BENCH_QT
+        QTextDocument document;
+        document.setPlainText(QString::fromStdString(snapshot.text));
+        SyntaxHighlighter highlighter(&document);
+        highlighter.setLanguage(QString::fromStdString(snapshot.language));
+        CodeFormatter formatter;
+#endif
+
+        for (const EditTraceRecord& record : records) {
+            switch (record.kind) {
+            case EditTraceKind::Edits: {
+                if (record.edits.empty()) {
+                    break;
+                }
+                ++editRecords;
+#ifdef SNSUPEAR_BENCH_QT
+                if (options.highlight) {
+                    std::vector<std::pair<int, int>> ranges;
+                    for (const TextEdit& edit : record.edits) {
+                        ranges.emplace_back(documentPosition(buffer, document, edit.start),
+                                            documentPosition(buffer, document, edit.end));
+                    }
+                    AllocationScope scope;
+                    auto start = Clock::now();
+                    // Back to front, so earlier positions stay valid.
+                    for (size_t i = record.edits.size(); i-- > 0;) {
+                        QTextCursor cursor(&document);
+                        cursor.setPosition(ranges[i].first);
+                        cursor.setPosition(ranges[i].second, QTextCursor::KeepAnchor);
+                        cursor.insertText(QString::fromStdString(record.edits[i].replacement));
+                    }
+                    highlightStage.add(start, scope);
+                }
+#endif
+                const TextEdit& first = record.edits.front();
+                Stage& stage = record.edits.size() == 1 && first.start == first.end ? insertStage
+                               : record.edits.size() == 1 && first.replacement.empty() ? deleteStage
+                                                                                        : replaceStage;
+                AllocationScope scope;
+                auto start = Clock::now();
+                buffer.applyEdits(record.edits);
+                stage.add(start, scope);
+                {
+                    AllocationScope foldScope;
+                    auto foldStart = Clock::now();
+                    folds.update(buffer, damage);
+                    foldStage.add(foldStart, foldScope);
+                }
+                for (const TextEdit& edit : record.edits) {
+                    bytesInserted += edit.replacement.size();
+                }
+                break;
+            }
+            case EditTraceKind::Completion: {
+                // The editor's synchronous share of a completion is building
+                // the prompt from the whole document.
+                AllocationScope scope;
+                auto start = Clock::now();
+                std::string prompt = buffer.getBuffer();
+                completionStage.add(start, scope);
+                break;
+            }
+            case EditTraceKind::Format:
+#ifdef SNSUPEAR_BENCH_QT
+                if (options.format) {
+                    AllocationScope scope;
+                    auto start = Clock::now();
+                    formatter.formatCode(QString::fromStdString(buffer.getBuffer()));
+                    formatStage.add(start, scope);
+                }
+#endif
+                break;
+            case EditTraceKind::End: {
+                sawEnd = true;
+                LineChecksum checksum;
+                checksum.reset(buffer);
+                checksumOk = checksumOk && checksum.value() == record.checksum;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+    double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - replayStart).count();
+    double sessionSeconds = records.back().timeMicros / 1e6;
+
+    const Stage* stages[] = {&insertStage, &deleteStage, &replaceStage, &foldStage, &highlightStage, &completionStage, &formatStage};
+    if (options.json) {
+        std::cout << "{\"trace\":\"" << options.path << "\",\"records\":" << records.size()
+                  << ",\"repeat\":" << options.repeat << ",\"session_seconds\":" << sessionSeconds
+                  << ",\"replay_ms\":" << totalMs << ",\"edits_per_second\":" << editRecords / (totalMs / 1000.0)
+                  << ",\"bytes_inserted\":" << bytesInserted << ",\"checksum\":\""
+                  << (!sawEnd ? "missing" : checksumOk ? "ok" : "mismatch") << "\",\"stages\":{";
+        bool first = true;
+        for (const Stage* stage : stages) {
+            if (stage->micros.empty()) {
+                continue;
+            }
+            std::cout << (first ? "" : ",") << "\"" << stage->name << "\":{\"count\":" << stage->micros.size()
+                      << ",\"p50_us\":" << percentile(stage->micros, 0.50)
+                      << ",\"p90_us\":" << percentile(stage->micros, 0.90)
+                      << ",\"p99_us\":" << percentile(stage->micros, 0.99)
+                      << ",\"max_us\":" << *std::max_element(stage->micros.begin(), stage->micros.end());
+            if (AllocationCounter::enabled()) {
+                std::cout << ",\"allocations\":" << stage->allocations;
+            }
+            std::cout << "}";
+            first = false;
+        }
+        std::cout << "}}" << std::endl;
+    } else {
+        std::cout << "trace:       " << options.path << " (" << records.size() << " records, "
+                  << sessionSeconds << " s recorded)\n"
+                  << "replay:      " << totalMs << " ms for " << options.repeat << " run(s), "
+                  << editRecords / (totalMs / 1000.0) << " edits/s, " << bytesInserted << " bytes inserted\n"
+                  << "checksum:    " << (!sawEnd ? "missing (trace has no End record)" : checksumOk ? "ok" : "MISMATCH")
+                  << "\n";
+        for (const Stage* stage : stages) {
+            if (stage->micros.empty()) {
+                continue;
+            }
+            std::cout << "  " << stage->name << ": n=" << stage->micros.size()
+                      << "  p50 " << percentile(stage->micros, 0.50) << " us"
+                      << "  p90 " << percentile(stage->micros, 0.90) << " us"
+                      << "  p99 " << percentile(stage->micros, 0.99) << " us"
+                      << "  max " << *std::max_element(stage->micros.begin(), stage->micros.end()) << " us";
+            if (AllocationCounter::enabled()) {
+                std::cout << "  allocs/op " << static_cast<double>(stage->allocations) / stage->micros.size();
+            }
+            std::cout << "\n";
+        }
+    }
+    return checksumOk ? 0 : 1;
+}
@@ -51,15 +51,37 @@ void ConfigManager::setSetting(const QString& key, const QVariant& value) {
     settings.setValue(key, value);
 }
 
+/**
+ * @brief Gets the file size above which files open in large-file mode.
+ * @return The threshold in bytes; defaults to 64 MiB.
+ */
+qint64 ConfigManager::getLargeFileThreshold() const {
+    QSettings settings;
+    return settings.value("editor/largeFileThreshold", qint64(64) * 1024 * 1024).toLongLong();
+}
+
 /**
  * @brief Gets the syntax highlighting rules for the given language.
  * @param language The language identifier.
- * @param forceRefresh If true, forces reloading of the rules from the configuration file.
+ * @param forceRefresh If true, rebuilds the rules instead of returning the cached copy.
  * @return A QJsonObject containing the syntax highlighting rules.
  */
 QJsonObject ConfigManager::getSyntaxRules(const QString& language, bool forceRefresh) {
-    Q_UNUSED(forceRefresh); // Placeholder for potential future implementation
+    auto cached = syntaxRulesCache.constFind(language);
+    if (!forceRefresh && cached != syntaxRulesCache.constEnd()) {
+        return *cached;
+    }
+    QJsonObject syntaxRules = buildSyntaxRules(language);
+    syntaxRulesCache.insert(language, syntaxRules);
+    return syntaxRules;
+}
 
+/**
+ * @brief Builds the syntax highlighting rules for the given language.
+ * @param language The language identifier.
+ * @return A QJsonObject containing the syntax highlighting rules.
+ */
+QJsonObject ConfigManager::buildSyntaxRules(const QString& language) {
     if (language == "cpp") {
         QJsonObject syntaxRules;
 
@@ -104,6 +126,21 @@ QJsonObject ConfigManager::getSyntaxRules(const QString& language, bool forceRef
  * @return A QJsonObject containing the theme configuration.
  */
 QJsonObject ConfigManager::getTheme(const QString& themeName) {
+    auto cached = themeCache.constFind(themeName);
+    if (cached != themeCache.constEnd()) {
+        return *cached;
+    }
+    QJsonObject theme = buildTheme(themeName);
+    themeCache.insert(themeName, theme);
+    return theme;
+}
+
+/**
+ * @brief Builds the theme configuration for the given theme name.
+ * @param themeName The name of the theme.
+ * @return A QJsonObject containing the theme configuration.
+ */
+QJsonObject ConfigManager::buildTheme(const QString& themeName) {
     if (themeName == "Sn_MarinaSync_Dark") {
         return QJsonObject{
             {"background", "#000000"},
@@ -176,6 +213,21 @@ QJsonObject ConfigManager::getTheme(const QString& themeName) {
  * @return A QJsonObject mapping syntax elements to color names.
  */
 QJsonObject ConfigManager::getSyntaxColors(const QString& language) {
+    auto cached = syntaxColorsCache.constFind(language);
+    if (cached != syntaxColorsCache.constEnd()) {
+        return *cached;
+    }
+    QJsonObject syntaxColors = buildSyntaxColors(language);
+    syntaxColorsCache.insert(language, syntaxColors);
+    return syntaxColors;
+}
+
+/**
+ * @brief Builds the syntax color mapping for the given language.
+ * @param language The language identifier.
+ * @return A QJsonObject mapping syntax elements to color names.
+ */
+QJsonObject ConfigManager::buildSyntaxColors(const QString& language) {
     if (language == "cpp") {
         return QJsonObject{
             {"keyword", "blue1"},
@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QJsonObject>
 #include <QVariant>
+#include <QHash>
 
 /**
  * @brief Manages application configuration and settings.
@@ -39,10 +40,16 @@ public:
      */
     void setSetting(const QString& key, const QVariant& value);
 
+    /**
+     * @brief Gets the file size above which files open in large-file mode.
+     * @return The threshold in bytes.
+     */
+    qint64 getLargeFileThreshold() const;
+
     /**
      * @brief Gets the syntax highlighting rules for the given language.
      * @param language The language identifier.
-     * @param forceRefresh If true, forces reloading of the rules from the configuration file.
+     * @param forceRefresh If true, rebuilds the rules instead of returning the cached copy.
      * @return A QJsonObject containing the syntax highlighting rules.
      */
     QJsonObject getSyntaxRules(const QString& language, bool forceRefresh = false);
@@ -66,6 +73,16 @@ private:
      * @brief Private constructor to enforce singleton pattern.
      */
     ConfigManager();
+
+    QJsonObject buildSyntaxRules(const QString& language);
+    QJsonObject buildTheme(const QString& themeName);
+    QJsonObject buildSyntaxColors(const QString& language);
+
+    // Built once per key; QJsonObject copies share the cached data, so
+    // callers get them without allocating.
+    QHash<QString, QJsonObject> syntaxRulesCache;
+    QHash<QString, QJsonObject> themeCache;
+    QHash<QString, QJsonObject> syntaxColorsCache;
 };
 
 #endif // CONFIG_MANAGER_H
@@ -0,0 +1,284 @@
+// diagnostics_overlay.cpp
+#include "diagnostics_overlay.h"
+#include "edit_trace.h"
+#include "latency_trace.h"
+
+#include <QHelpEvent>
+#include <QPainter>
+#include <QPainterPath>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QToolTip>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+QColor severityColor(DiagnosticSeverity severity) {
+    switch (severity) {
+    case DiagnosticSeverity::Error: return QColor(0xe0, 0x52, 0x52);
+    case DiagnosticSeverity::Warning: return QColor(0xd7, 0xa2, 0x22);
+    case DiagnosticSeverity::Note: return QColor(0x4a, 0xa3, 0xdf);
+    }
+    return QColor(Qt::gray);
+}
+
+void drawSquiggle(QPainter& painter, qreal left, qreal right, qreal y) {
+    QPainterPath path(QPointF(left, y));
+    bool up = true;
+    for (qreal x = left + 2; x < right + 2; x += 2, up = !up) {
+        path.lineTo(x, up ? y - 2 : y);
+    }
+    painter.drawPath(path);
+}
+
+} // namespace
+
+DiagnosticsOverlay::DiagnosticsOverlay(QPlainTextEdit* editor)
+    : QWidget(editor)
+    , editor(editor)
+    , debounceTimer(new QTimer(this))
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_NoSystemBackground);
+    debounceTimer->setSingleShot(true);
+    connect(debounceTimer, &QTimer::timeout, this, &DiagnosticsOverlay::onDebounceTimeout);
+    connect(editor, &QPlainTextEdit::updateRequest, this, [this](const QRect&, int dy) {
+        if (dy != 0)
+            update();  // Scrolled
+    });
+    editor->viewport()->installEventFilter(this);
+
+    // The built-in checks always run; a real compiler joins them for C and
+    // C++ when one is installed. The snapshot it checks is not next to the
+    // file, so -iquote points its quoted includes back there.
+    std::vector<std::shared_ptr<DiagnosticProvider>> providers{std::make_shared<LintProvider>()};
+    const std::vector<std::string> cFamily{".c", ".cc", ".cpp", ".cxx", ".h", ".hh", ".hpp", ".hxx"};
+    if (!QStandardPaths::findExecutable("clang-tidy").isEmpty()) {
+        providers.push_back(std::make_shared<CommandProvider>(
+            std::vector<std::string>{"clang-tidy", "--quiet", "{file}", "--", "-iquote", "{dir}"}, cFamily));
+    } else if (!QStandardPaths::findExecutable("clang++").isEmpty()) {
+        providers.push_back(std::make_shared<CommandProvider>(
+            std::vector<std::string>{"clang++", "-fsyntax-only", "-iquote", "{dir}", "-x", "c++", "-"}, cFamily));
+    }
+    service = std::make_unique<DiagnosticsService>(
+        std::move(providers), [this](uint64_t document, uint64_t revision, std::vector<Diagnostic> results) {
+            // On a worker: the results are handled on the UI thread.
+            QMetaObject::invokeMethod(this, [this, document, revision, results = std::move(results)]() mutable {
+                onResults(document, revision, std::move(results));
+            }, Qt::QueuedConnection);
+        });
+    hide();
+}
+
+DiagnosticsOverlay::~DiagnosticsOverlay() {
+    while (!documents.empty())
+        forget(documents.begin()->first);
+}
+
+void DiagnosticsOverlay::open(const QString& filePath, DocumentMirror* mirror) {
+    close();
+    auto it = documents.find(mirror);
+    bool fresh = false;
+    if (it != documents.end() && it->second.path != filePath) {
+        forget(mirror);  // Another file's text now
+        it = documents.end();
+    }
+    if (it == documents.end()) {
+        it = documents.try_emplace(mirror).first;
+        Document& document = it->second;
+        document.path = filePath;
+        document.id = ++lastId;
+        fresh = true;
+        mirror->acquire();
+        // Hidden documents follow their edits too, such as a reload, so
+        // their diagnostics stay in place.
+        connect(mirror, &DocumentMirror::edited, this, [this, &document](const std::vector<TextEdit>& edits) {
+            onEdited(document, edits);
+        });
+    }
+    this->mirror = mirror;
+    shown = &it->second;
+    setGeometry(editor->viewport()->geometry());
+    show();
+    raise();
+    if (fresh || shown->diagnostics.hasUnanalysedEdits())
+        submitSnapshot();  // A freshly opened or changed file is checked without delay
+}
+
+void DiagnosticsOverlay::close() {
+    if (!shown)
+        return;
+    debounceTimer->stop();
+    shown = nullptr;
+    mirror = nullptr;
+    damaged.clear();
+    hide();
+}
+
+void DiagnosticsOverlay::forget(DocumentMirror* mirror) {
+    auto it = documents.find(mirror);
+    if (it == documents.end())
+        return;
+    if (shown == &it->second)
+        close();
+    disconnect(mirror, nullptr, this, nullptr);
+    service->cancel(it->second.id);
+    mirror->release();
+    documents.erase(it);
+}
+
+void DiagnosticsOverlay::onEdited(Document& document, const std::vector<TextEdit>& edits) {
+    document.diagnostics.applyEdits(edits, damaged);
+    if (&document != shown) {
+        damaged.clear();
+        return;
+    }
+    repaintDamaged();
+    if (!debounceTimer->isActive())
+        onDebounceTimeout();  // Arms the timer for the quiet period
+}
+
+void DiagnosticsOverlay::onDebounceTimeout() {
+    // One timer per quiet period rather than a restart per keystroke: it
+    // re-arms itself until the last edit is old enough.
+    if (!shown)
+        return;
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(shown->diagnostics.dueAt()
+                                                                           - std::chrono::steady_clock::now());
+    if (remaining.count() > 0) {
+        debounceTimer->start(static_cast<int>(remaining.count()) + 1);
+        return;
+    }
+    if (shown->diagnostics.hasUnanalysedEdits())
+        submitSnapshot();
+}
+
+void DiagnosticsOverlay::submitSnapshot() {
+    auto text = std::make_shared<const std::string>(mirror->buffer().getBuffer());
+    service->submit(shown->id, shown->path.toStdString(), shown->diagnostics.snapshotTaken(), std::move(text));
+}
+
+void DiagnosticsOverlay::onResults(uint64_t document, uint64_t revision, std::vector<Diagnostic> results) {
+    auto it = std::find_if(documents.begin(), documents.end(),
+                           [document](const auto& entry) { return entry.second.id == document; });
+    if (it == documents.end())
+        return;  // Late results of a document forgotten since
+    if (it->second.diagnostics.accept(revision, std::move(results), damaged) && &it->second == shown)
+        repaintDamaged();
+    damaged.clear();
+}
+
+void DiagnosticsOverlay::repaintDamaged() {
+    if (damaged.empty() || !isVisible()) {
+        damaged.clear();
+        return;
+    }
+    const TextBuffer& text = mirror->buffer();
+    QTextDocument* document = editor->document();
+    const int firstVisible = editor->cursorForPosition(QPoint(0, 0)).blockNumber();
+    const int lastVisible = editor->cursorForPosition(QPoint(0, height())).blockNumber();
+    for (const ByteRange& range : damaged) {
+        int first = static_cast<int>(text.lineOfOffset(std::min(range.start, text.getLength())));
+        int last = static_cast<int>(text.lineOfOffset(std::min(range.end, text.getLength())));
+        first = std::max(first, firstVisible);
+        last = std::min(last, lastVisible);
+        if (first > last)
+            continue;  // Off screen
+        QTextCursor end(document->findBlockByNumber(last));
+        end.movePosition(QTextCursor::EndOfBlock);
+        const int top = editor->cursorRect(QTextCursor(document->findBlockByNumber(first))).top();
+        const int bottom = editor->cursorRect(end).bottom() + 2;  // The squiggle hangs below the text
+        update(QRect(0, top, width(), bottom - top + 1));
+    }
+    damaged.clear();
+}
+
+int DiagnosticsOverlay::documentPosition(size_t offset) const {
+    const TextBuffer& text = mirror->buffer();
+    const size_t line = text.lineOfOffset(std::min(offset, text.getLength()));
+    std::string_view head = text.lineView(line).substr(0, offset - text.offsetOfLine(line));
+    return editor->document()->findBlockByNumber(static_cast<int>(line)).position()
+           + static_cast<int>(utf16UnitsInUtf8(head));
+}
+
+bool DiagnosticsOverlay::eventFilter(QObject* watched, QEvent* event) {
+    if (watched == editor->viewport()) {
+        if (event->type() == QEvent::Resize || event->type() == QEvent::Move) {
+            setGeometry(editor->viewport()->geometry());
+        } else if (event->type() == QEvent::ToolTip && shown) {
+            QHelpEvent* help = static_cast<QHelpEvent*>(event);
+            size_t offset = mirror->byteOffset(editor->cursorForPosition(help->pos()).position());
+            found.clear();
+            shown->diagnostics.overlapping(offset, offset + 1, found);
+            if (found.empty() && offset > 0)
+                shown->diagnostics.overlapping(offset - 1, offset, found);  // The character left of the cursor
+            QStringList messages;
+            for (const Diagnostic* diagnostic : found) {
+                messages << QString("%1: %2").arg(diagnosticSeverityName(diagnostic->severity),
+                                                  QString::fromStdString(diagnostic->message));
+            }
+            if (messages.isEmpty())
+                QToolTip::hideText();
+            else
+                QToolTip::showText(help->globalPos(), messages.join('\n'), editor->viewport());
+            return true;
+        }
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void DiagnosticsOverlay::paintEvent(QPaintEvent* event) {
+    if (!shown || shown->diagnostics.diagnostics().empty())
+        return;
+    SNSUPEAR_TRACE_SCOPE(Paint, "DiagnosticsOverlay::paintEvent");
+
+    // Only diagnostics on the lines being repainted are looked at.
+    const TextBuffer& text = mirror->buffer();
+    QTextDocument* document = editor->document();
+    const QRect area = event->rect();
+    const size_t firstLine = static_cast<size_t>(editor->cursorForPosition(area.topLeft()).blockNumber());
+    const size_t lastLine = static_cast<size_t>(editor->cursorForPosition(area.bottomLeft()).blockNumber());
+    const size_t start = text.offsetOfLine(std::min(firstLine, text.getLineCount() - 1));
+    const size_t end = lastLine + 1 < text.getLineCount() ? text.offsetOfLine(lastLine + 1) : text.getLength() + 1;
+    found.clear();
+    shown->diagnostics.overlapping(start, end, found);
+    if (found.empty())
+        return;
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setClipRect(area);
+    for (const Diagnostic* diagnostic : found) {
+        painter.setPen(QPen(severityColor(diagnostic->severity), 1));
+        const int from = documentPosition(std::max(diagnostic->start, start));
+        const int to = documentPosition(std::min(diagnostic->end, end));
+        for (QTextBlock block = document->findBlock(from); block.isValid() && block.position() <= to;
+             block = block.next()) {
+            QTextLayout* layout = block.layout();
+            if (!block.isVisible() || !layout || layout->lineCount() == 0)
+                continue;  // Folded away
+            const int segmentStart = std::max(from, block.position()) - block.position();
+            const int segmentEnd = std::min(to, block.position() + block.length() - 1) - block.position();
+            // Layout coordinates to the overlay's, which are the viewport's.
+            const QRect blockStart = editor->cursorRect(QTextCursor(block));
+            const QTextLine firstRow = layout->lineAt(0);
+            const QPointF origin(blockStart.left() - firstRow.cursorToX(0), blockStart.top() - firstRow.y());
+
+            const QTextLine startRow = layout->lineForTextPosition(segmentStart);
+            for (int index = startRow.isValid() ? startRow.lineNumber() : layout->lineCount();
+                 index < layout->lineCount(); ++index) {
+                const QTextLine line = layout->lineAt(index);
+                const int lineEnd = line.textStart() + line.textLength();
+                const qreal left = origin.x() + line.cursorToX(std::max(segmentStart, line.textStart()));
+                const qreal right = origin.x() + line.cursorToX(std::min(segmentEnd, lineEnd));
+                // Empty and one-character diagnostics stay visible.
+                drawSquiggle(painter, left, std::max(right, left + 4), origin.y() + line.y() + line.height() - 1);
+                if (segmentEnd <= lineEnd)
+                    break;
+            }
+        }
+    }
+}
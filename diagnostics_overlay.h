@@ -0,0 +1,106 @@
+// diagnostics_overlay.h
+#pragma once
+
+#include <QPlainTextEdit>
+#include <QString>
+#include <QTimer>
+#include <QWidget>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "diagnostics.h"
+#include "document_mirror.h"
+
+/**
+ * @brief Squiggles under the open file's diagnostics, checked in the
+ * background.
+ *
+ * A debounced snapshot of the mirrored document goes to a DiagnosticsService
+ * whose workers run the built-in lint checks and, for C and C++ files,
+ * clang-tidy or clang when installed. Results come back to the UI thread,
+ * are mapped onto the current text through the edits made meanwhile, and
+ * only the lines whose diagnostics changed are repainted. Each document
+ * keeps its diagnostics while another one is shown, following its edits,
+ * so showing it again costs no new analysis. The overlay sits
+ * transparently over the editor's viewport; hovering a squiggle shows its
+ * messages.
+ */
+class DiagnosticsOverlay : public QWidget {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs the overlay for an editor; idle until open().
+     * @param editor The editor to draw over.
+     */
+    explicit DiagnosticsOverlay(QPlainTextEdit* editor);
+    ~DiagnosticsOverlay() override;
+
+    /**
+     * @brief Shows the squiggles of the editor's document, checked as the
+     * contents of the given file; hides those of any document shown. A
+     * document seen before is only checked again if it was edited since.
+     * @param mirror Mirror of the editor's document, held until forget().
+     */
+    void open(const QString& filePath, DocumentMirror* mirror);
+
+    /**
+     * @brief Hides the squiggles. The document's diagnostics are kept, and
+     * results still being computed for it are accepted.
+     */
+    void close();
+
+    /**
+     * @brief Drops a document's diagnostics and any analysis of it, as when
+     * its file is closed; closes it first if it is shown.
+     */
+    void forget(DocumentMirror* mirror);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
+
+private slots:
+    /**
+     * @brief Submits a snapshot once the debounce period has passed.
+     */
+    void onDebounceTimeout();
+
+private:
+    struct Document {
+        QString path;
+        uint64_t id = 0;
+        DocumentDiagnostics diagnostics;
+    };
+
+    void onEdited(Document& document, const std::vector<TextEdit>& edits);
+
+    /**
+     * @brief Queues a snapshot of the shown document for analysis.
+     */
+    void submitSnapshot();
+
+    void onResults(uint64_t document, uint64_t revision, std::vector<Diagnostic> results);
+
+    /**
+     * @brief Repaints the visible lines covering the ranges, then clears
+     * them.
+     */
+    void repaintDamaged();
+
+    /**
+     * @brief Document position of a byte offset in the mirror.
+     */
+    int documentPosition(size_t offset) const;
+
+    QPlainTextEdit* editor;
+    std::unique_ptr<DiagnosticsService> service;
+    std::map<DocumentMirror*, Document> documents;
+    DocumentMirror* mirror = nullptr;  ///< Of the document shown.
+    Document* shown = nullptr;
+    QTimer* debounceTimer;
+    uint64_t lastId = 0;  ///< Ids are never reused, so late results of a forgotten document are ignored.
+    std::vector<ByteRange> damaged;
+    std::vector<const Diagnostic*> found;  ///< Scratch for lookups.
+};
@@ -0,0 +1,154 @@
+// document_mirror.cpp
+#include "document_mirror.h"
+#include "edit_trace.h"
+
+#include <QTextBlock>
+#include <QTextCursor>
+#include <algorithm>
+
+namespace {
+
+constexpr int kCharacterReadLimit = 256;      // Longer inserts are read as a selection
+constexpr size_t kScratchLimit = 64 * 1024;   // Larger replacement buffers are freed
+
+} // namespace
+
+DocumentMirror::DocumentMirror(QTextDocument* document, QObject* parent)
+    : QObject(parent)
+    , document(document)
+{}
+
+void DocumentMirror::acquire() {
+    if (users++ > 0) {
+        return;
+    }
+    mirror.applyExternalEdits({{0, mirror.getLength(), document->toPlainText().toStdString()}});
+    connect(document, &QTextDocument::contentsChange, this, &DocumentMirror::onContentsChange);
+}
+
+void DocumentMirror::release() {
+    if (users == 0 || --users > 0) {
+        return;
+    }
+    disconnect(document, nullptr, this, nullptr);
+    mirror.applyExternalEdits({{0, mirror.getLength(), std::string()}});
+}
+
+void DocumentMirror::onContentsChange(int position, int charsRemoved, int charsAdded) {
+    // Qt counts the document's final paragraph separator, which has no
+    // counterpart in the text; clamp both sides to real characters.
+    int characters = document->characterCount() - 1;
+    charsAdded = std::max(0, std::min(charsAdded, characters - position));
+
+    size_t start = byteOffset(position);
+    size_t end = advance(start, static_cast<size_t>(std::max(0, charsRemoved)));
+
+    // The batch is reused, so typing allocates nothing here once its
+    // replacement has grown to the usual insert.
+    edits.resize(1);
+    TextEdit& edit = edits.front();
+    edit.start = start;
+    edit.end = end;
+    edit.replacement.clear();
+    readAdded(position, charsAdded, edit.replacement);
+
+    // Format-only changes (the highlighter) report equal removed/added text.
+    if (end - start == edit.replacement.size() && mirrorEquals(start, edit.replacement)) {
+        return;
+    }
+
+    mirror.applyExternalEdits(edits);
+    emit edited(edits);
+    if (edit.replacement.capacity() > kScratchLimit) {
+        edit.replacement = std::string();  // Not kept after a large paste
+    }
+}
+
+void DocumentMirror::readAdded(int position, int count, std::string& out) const {
+    if (count > kCharacterReadLimit) {
+        QTextCursor cursor(document);
+        cursor.setPosition(position);
+        cursor.setPosition(position + count, QTextCursor::KeepAnchor);
+        out += cursor.selectedText().replace(QChar::ParagraphSeparator, '\n').toStdString();
+        return;
+    }
+    // A keystroke's few characters are read one by one rather than through
+    // a selection, which would build two temporary strings.
+    for (int i = 0; i < count; ++i) {
+        char32_t code = document->characterAt(position + i).unicode();
+        if (QChar::isHighSurrogate(code) && i + 1 < count) {
+            QChar low = document->characterAt(position + ++i);
+            code = QChar::surrogateToUcs4(static_cast<char16_t>(code), low.unicode());
+        }
+        if (code == QChar::ParagraphSeparator) {
+            code = '\n';
+        }
+        if (code < 0x80) {
+            out.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+}
+
+bool DocumentMirror::mirrorEquals(size_t start, std::string_view text) const {
+    size_t line = mirror.lineOfOffset(start);
+    size_t column = start - mirror.offsetOfLine(line);
+    while (!text.empty() && line < mirror.getLineCount()) {
+        std::string_view rest = mirror.lineView(line).substr(column);
+        size_t length = std::min(rest.size(), text.size());
+        if (text.compare(0, length, rest, 0, length) != 0) {
+            return false;
+        }
+        text.remove_prefix(length);
+        if (text.empty()) {
+            return true;
+        }
+        if (text.front() != '\n' || line + 1 >= mirror.getLineCount()) {
+            return false;
+        }
+        text.remove_prefix(1);
+        ++line;
+        column = 0;
+    }
+    return text.empty();
+}
+
+size_t DocumentMirror::byteOffset(int position) const {
+    QTextBlock block = document->findBlock(position);
+    size_t line = std::min(static_cast<size_t>(std::max(0, block.blockNumber())), mirror.getLineCount() - 1);
+    return mirror.offsetOfLine(line)
+           + utf8BytesForUtf16Units(mirror.lineView(line), static_cast<size_t>(position - block.position()));
+}
+
+size_t DocumentMirror::advance(size_t offset, size_t units) const {
+    size_t line = mirror.lineOfOffset(offset);
+    size_t column = offset - mirror.offsetOfLine(line);
+    while (units > 0) {
+        std::string_view rest = mirror.lineView(line).substr(column);
+        size_t available = utf16UnitsInUtf8(rest);
+        if (units <= available) {
+            return offset + utf8BytesForUtf16Units(rest, units);
+        }
+        offset += rest.size();
+        units -= available;
+        if (line + 1 >= mirror.getLineCount()) {
+            return offset;  // Clamped at the end of the text
+        }
+        ++offset;  // The '\n'
+        --units;
+        ++line;
+        column = 0;
+    }
+    return offset;
+}
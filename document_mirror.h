@@ -0,0 +1,87 @@
+// document_mirror.h
+#pragma once
+
+#include <QObject>
+#include <QTextDocument>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_buffer.h"
+
+/**
+ * @brief Keeps a TextBuffer equal to a document.
+ *
+ * Each document change is converted from Qt's UTF-16 positions to a
+ * byte-offset TextEdit without flattening the document, applied to the
+ * mirror and announced through edited(), so the edit trace recorder and
+ * the session journal see the same batches. Tracking runs while at least
+ * one user holds it through acquire().
+ */
+class DocumentMirror : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a mirror for the given document; idle until
+     * acquire().
+     * @param document The document mirrored.
+     * @param parent The parent object.
+     */
+    explicit DocumentMirror(QTextDocument* document, QObject* parent = nullptr);
+
+    /**
+     * @brief Starts tracking if nobody was, taking the document's current
+     * text.
+     */
+    void acquire();
+
+    /**
+     * @brief Stops tracking once every acquire() has been released.
+     */
+    void release();
+
+    bool isActive() const { return users > 0; }
+
+    const TextBuffer& buffer() const { return mirror; }
+
+    /**
+     * @brief Byte offset in the mirror of a document position before which
+     * the document and the mirror agree.
+     */
+    size_t byteOffset(int position) const;
+
+signals:
+    /**
+     * @brief The document changed by @p edits, in byte offsets of the text
+     * before them; the mirror already holds the result.
+     */
+    void edited(const std::vector<TextEdit>& edits);
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    /**
+     * @brief Byte offset reached by moving @p units UTF-16 code units
+     * forward from @p offset in the mirror; '\n' counts as one unit.
+     */
+    size_t advance(size_t offset, size_t units) const;
+
+    /**
+     * @brief Appends the UTF-8 of @p count characters of the document from
+     * @p position to @p out.
+     */
+    void readAdded(int position, int count, std::string& out) const;
+
+    /**
+     * @brief Whether the mirror holds @p text at byte offset @p start, lines
+     * joined by '\n'.
+     */
+    bool mirrorEquals(size_t start, std::string_view text) const;
+
+    QTextDocument* document;
+    TextBuffer mirror;
+    std::vector<TextEdit> edits;  ///< Reused for every change.
+    int users = 0;
+};
@@ -0,0 +1,67 @@
+// edit_trace_recorder.cpp
+#include "edit_trace_recorder.h"
+#include "line_checksum.h"
+
+#include <QDebug>
+
+EditTraceRecorder::EditTraceRecorder(QPlainTextEdit* editor, QObject* parent)
+    : QObject(parent)
+    , editor(editor)
+{}
+
+EditTraceRecorder::~EditTraceRecorder() {
+    stop();
+}
+
+bool EditTraceRecorder::start(const QString& path, const QString& language, DocumentMirror* mirror) {
+    stop();
+    try {
+        writer = std::make_unique<EditTraceWriter>(path.toStdString());
+    } catch (const std::exception& e) {
+        qWarning() << "Cannot record edit trace:" << e.what();
+        return false;
+    }
+
+    this->mirror = mirror;
+    mirror->acquire();
+    writer->snapshot(mirror->buffer().getBuffer(), language.toStdString());
+
+    connect(mirror, &DocumentMirror::edited, this, &EditTraceRecorder::onEdited);
+    connect(editor, &QPlainTextEdit::cursorPositionChanged, this, &EditTraceRecorder::onCursorPositionChanged);
+    return true;
+}
+
+void EditTraceRecorder::stop() {
+    if (!writer) {
+        return;
+    }
+    disconnect(mirror, nullptr, this, nullptr);
+    disconnect(editor, nullptr, this, nullptr);
+
+    LineChecksum checksum;
+    checksum.reset(mirror->buffer());
+    writer->finish(checksum.value());
+    writer.reset();
+    mirror->release();
+    mirror = nullptr;
+}
+
+void EditTraceRecorder::recordCompletion() {
+    if (writer) {
+        writer->completion(mirror->byteOffset(editor->textCursor().position()));
+    }
+}
+
+void EditTraceRecorder::recordFormat(const QString& language) {
+    if (writer) {
+        writer->format(language.toStdString());
+    }
+}
+
+void EditTraceRecorder::onEdited(const std::vector<TextEdit>& edits) {
+    writer->edits(edits);
+}
+
+void EditTraceRecorder::onCursorPositionChanged() {
+    writer->cursor(mirror->byteOffset(editor->textCursor().position()));
+}
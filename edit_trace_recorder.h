@@ -0,0 +1,65 @@
+// edit_trace_recorder.h
+#pragma once
+
+#include <QObject>
+#include <QPlainTextEdit>
+#include <memory>
+
+#include "document_mirror.h"
+#include "edit_trace.h"
+
+/**
+ * @brief Records an editor session into an edit trace (see edit_trace.h).
+ *
+ * Document changes, cursor moves and completion/format requests are
+ * written with TextBuffer byte offsets taken from a DocumentMirror, whose
+ * checksum at stop() lets the replayer confirm it reproduced the session.
+ */
+class EditTraceRecorder : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a recorder for the given editor; idle until start().
+     * @param editor The editor whose document is recorded.
+     * @param parent The parent object.
+     */
+    explicit EditTraceRecorder(QPlainTextEdit* editor, QObject* parent = nullptr);
+    ~EditTraceRecorder() override;
+
+    /**
+     * @brief Starts recording to a new trace file.
+     * @param path The trace file to create.
+     * @param language Highlighter language stored with the snapshot.
+     * @param mirror Mirror of the editor's document, held while recording.
+     * @return False if the file cannot be created.
+     */
+    bool start(const QString& path, const QString& language, DocumentMirror* mirror);
+
+    /**
+     * @brief Finishes the trace; does nothing if not recording.
+     */
+    void stop();
+
+    bool isRecording() const { return writer != nullptr; }
+
+    /**
+     * @brief Notes a completion request at the cursor.
+     */
+    void recordCompletion();
+
+    /**
+     * @brief Notes a format request.
+     * @param language The language being formatted.
+     */
+    void recordFormat(const QString& language);
+
+private slots:
+    void onEdited(const std::vector<TextEdit>& edits);
+    void onCursorPositionChanged();
+
+private:
+    QPlainTextEdit* editor;
+    DocumentMirror* mirror = nullptr;  ///< While recording.
+    std::unique_ptr<EditTraceWriter> writer;
+};
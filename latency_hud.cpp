@@ -0,0 +1,47 @@
+// latency_hud.cpp
+#include "latency_hud.h"
+#include "latency_trace.h"
+
+/**
+ * @brief Constructs the HUD over the given widget; hidden until shown.
+ * @param parent The widget to overlay.
+ */
+LatencyHud::LatencyHud(QWidget* parent)
+    : QLabel(parent)
+    , refreshTimer(new QTimer(this))
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setStyleSheet("background-color: rgba(0, 0, 0, 160); color: #e0e0e0; padding: 4px 8px;"
+                  "font-family: monospace; border-radius: 4px;");
+    connect(refreshTimer, &QTimer::timeout, this, &LatencyHud::refresh);
+    hide();
+}
+
+void LatencyHud::showEvent(QShowEvent* event) {
+    refresh();
+    refreshTimer->start(500);
+    QLabel::showEvent(event);
+}
+
+void LatencyHud::hideEvent(QHideEvent* event) {
+    refreshTimer->stop();
+    QLabel::hideEvent(event);
+}
+
+/**
+ * @brief Re-reads the percentiles and repositions the overlay.
+ */
+void LatencyHud::refresh() {
+    LatencyPercentiles latency = LatencyTrace::keystrokeLatency();
+    if (latency.samples == 0) {
+        setText("key→paint: no keystrokes yet");
+    } else {
+        setText(QString("key→paint  p50 %1 ms  p99 %2 ms  (n=%3)")
+                    .arg(latency.p50Ms, 0, 'f', 2)
+                    .arg(latency.p99Ms, 0, 'f', 2)
+                    .arg(latency.samples));
+    }
+    adjustSize();
+    move(parentWidget()->width() - width() - 8, 8);
+    raise();
+}
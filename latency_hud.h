@@ -0,0 +1,36 @@
+// latency_hud.h
+#pragma once
+
+#include <QLabel>
+#include <QTimer>
+
+/**
+ * @brief Overlay showing live keystroke-to-paint latency percentiles.
+ *
+ * Reads LatencyTrace::keystrokeLatency() twice a second and pins itself to
+ * the top-right corner of its parent. It ignores the mouse so it never gets
+ * in the way of the editor underneath.
+ */
+class LatencyHud : public QLabel {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs the HUD over the given widget; hidden until shown.
+     * @param parent The widget to overlay.
+     */
+    explicit LatencyHud(QWidget* parent);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private slots:
+    /**
+     * @brief Re-reads the percentiles and repositions the overlay.
+     */
+    void refresh();
+
+private:
+    QTimer* refreshTimer;  ///< Drives refresh() while visible.
+};
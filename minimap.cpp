@@ -0,0 +1,139 @@
+// minimap.cpp
+#include "minimap.h"
+#include "latency_trace.h"
+#include "syntax_highlighter.h"
+#include <QImage>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <algorithm>
+
+Minimap::Minimap(QPlainTextEdit* editor, SyntaxHighlighter* highlighter, QWidget* parent)
+    : QWidget(parent)
+    , editor(editor)
+    , highlighter(highlighter)
+{
+    setFixedWidth(MinimapTiles::kTileWidth);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setCursor(Qt::PointingHandCursor);
+    // Every viewport update may have re-highlighted or scrolled lines.
+    connect(editor, &QPlainTextEdit::updateRequest, this, [this]() { update(); });
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged, this, [this]() { update(); });
+}
+
+void Minimap::linesChanged(size_t firstLine, size_t oldCount, size_t newCount) {
+    tiles.linesChanged(firstLine, oldCount, newCount);
+    update();
+}
+
+void Minimap::setHighlighter(SyntaxHighlighter* highlighter) {
+    this->highlighter->setMinimapEnabled(false);
+    this->highlighter = highlighter;
+    highlighter->setMinimapEnabled(isVisible());
+    tiles.invalidateAll();
+    update();
+}
+
+size_t Minimap::firstShownLine(size_t lineCount) const {
+    const size_t rows = static_cast<size_t>(height() / MinimapTiles::kLinePixels);
+    if (lineCount <= rows)
+        return 0;
+    const QScrollBar* scrollBar = editor->verticalScrollBar();
+    if (scrollBar->maximum() <= 0)
+        return 0;
+    return static_cast<size_t>(static_cast<double>(lineCount - rows) * scrollBar->value() / scrollBar->maximum());
+}
+
+void Minimap::syncColors() {
+    if (highlighter->rulesGeneration() != rulesGeneration) {
+        // The summaries are recoloured as the blocks are highlighted again.
+        rulesGeneration = highlighter->rulesGeneration();
+        tiles.invalidateAll();
+    }
+    QVector<QRgb> colors = highlighter->minimapPalette();
+    colors[0] = editor->palette().color(QPalette::Text).rgb();
+    QRgb base = editor->palette().color(QPalette::Base).rgb();
+    if (colors == palette && base == background)
+        return;
+    palette = colors;
+    background = base;
+    tiles.setColors(std::vector<uint32_t>(palette.cbegin(), palette.cend()), background);
+}
+
+void Minimap::showEvent(QShowEvent* event) {
+    QWidget::showEvent(event);
+    // Summaries went stale while hidden; the tiles drawn from them too.
+    highlighter->setMinimapEnabled(true);
+    tiles.invalidateAll();
+}
+
+void Minimap::hideEvent(QHideEvent* event) {
+    QWidget::hideEvent(event);
+    highlighter->setMinimapEnabled(false);
+}
+
+void Minimap::paintEvent(QPaintEvent* event) {
+    Q_UNUSED(event);
+    SNSUPEAR_TRACE_SCOPE(Paint, "Minimap::paintEvent");
+    syncColors();
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(background));
+
+    QTextDocument* document = editor->document();
+    const size_t lineCount = static_cast<size_t>(document->blockCount());
+    const size_t top = firstShownLine(lineCount);
+    const size_t bottom = std::min(lineCount, top + static_cast<size_t>(height() / MinimapTiles::kLinePixels) + 1);
+    for (size_t index = top / MinimapTiles::kTileLines; index * MinimapTiles::kTileLines < bottom; ++index) {
+        QTextBlock block;
+        const uint32_t* pixels = tiles.tile(index, lineCount, [&](size_t line) -> const MinimapCells* {
+            // Lines are asked for in order, so walk the blocks.
+            block = block.isValid() ? block.next() : document->findBlockByNumber(static_cast<int>(line));
+            const MinimapBlockData* summary = static_cast<const MinimapBlockData*>(block.userData());
+            if (summary && summary->current)
+                return &summary->cells;
+            // A visible block without a summary is still to be highlighted;
+            // the rest were skipped by the highlighter and are summarized here.
+            if (!summary && block.isVisible())
+                return nullptr;
+            return &highlighter->summarizeBlock(block);
+        });
+        const QImage image(reinterpret_cast<const uchar*>(pixels), MinimapTiles::kTileWidth,
+                           MinimapTiles::kTileHeight, QImage::Format_RGB32);
+        const qint64 y = (static_cast<qint64>(index * MinimapTiles::kTileLines) - static_cast<qint64>(top))
+                         * MinimapTiles::kLinePixels;
+        painter.drawImage(QPoint(0, static_cast<int>(y)), image);
+    }
+
+    // Shade the lines the editor is showing; with folds or wrapping that is
+    // not simply a page of lines.
+    const QScrollBar* scrollBar = editor->verticalScrollBar();
+    QTextBlock first = document->findBlockByLineNumber(scrollBar->value());
+    QTextBlock last = document->findBlockByLineNumber(scrollBar->value() + scrollBar->pageStep() - 1);
+    if (!first.isValid())
+        first = document->firstBlock();
+    if (!last.isValid())
+        last = document->lastBlock();
+    const int sliderTop = (first.blockNumber() - static_cast<int>(top)) * MinimapTiles::kLinePixels;
+    const int sliderHeight = (last.blockNumber() - first.blockNumber() + 1) * MinimapTiles::kLinePixels;
+    painter.fillRect(QRect(0, sliderTop, width(), sliderHeight), QColor(128, 128, 128, 60));
+}
+
+void Minimap::mousePressEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton)
+        scrollTo(event->pos().y());
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent* event) {
+    if (event->buttons() & Qt::LeftButton)
+        scrollTo(event->pos().y());
+}
+
+void Minimap::scrollTo(int y) {
+    QTextDocument* document = editor->document();
+    const size_t lineCount = static_cast<size_t>(document->blockCount());
+    size_t line = firstShownLine(lineCount) + static_cast<size_t>(std::max(0, y) / MinimapTiles::kLinePixels);
+    QTextBlock block = document->findBlockByNumber(static_cast<int>(std::min(line, lineCount - 1)));
+    QScrollBar* scrollBar = editor->verticalScrollBar();
+    scrollBar->setValue(block.firstLineNumber() - scrollBar->pageStep() / 2);
+}
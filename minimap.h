@@ -0,0 +1,78 @@
+// minimap.h
+#pragma once
+
+#include <QPlainTextEdit>
+#include <QVector>
+#include <QWidget>
+
+#include "minimap_tiles.h"
+
+class SyntaxHighlighter;
+
+/**
+ * @brief Overview strip beside the editor, drawn from cached tiles.
+ *
+ * Shows two pixel rows per line, scrolling in proportion to the editor,
+ * with the editor's viewport shaded. A paint looks up the two or three
+ * tiles on screen in MinimapTiles and blits them, so it costs the same on
+ * a million-line document as on a short one; lines are only rasterized
+ * again after an edit reaches their tile. While the minimap is hidden the
+ * highlighter skips the summaries. Clicking or dragging scrolls the editor
+ * to the line under the mouse.
+ */
+class Minimap : public QWidget {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs the minimap for an editor whose blocks carry the
+     * highlighter's MinimapBlockData.
+     * @param editor The editor to overview and scroll.
+     * @param highlighter The highlighter colouring the editor's document.
+     * @param parent The parent widget.
+     */
+    Minimap(QPlainTextEdit* editor, SyntaxHighlighter* highlighter, QWidget* parent = nullptr);
+
+    /**
+     * @brief Notes that document lines [firstLine, firstLine + oldCount)
+     * were replaced by newCount lines.
+     */
+    void linesChanged(size_t firstLine, size_t oldCount, size_t newCount);
+
+    /**
+     * @brief Switches to the highlighter of the document the editor now
+     * shows; every tile is drawn again.
+     */
+    void setHighlighter(SyntaxHighlighter* highlighter);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+private:
+    /**
+     * @brief First document line drawn at the top of the minimap.
+     */
+    size_t firstShownLine(size_t lineCount) const;
+
+    /**
+     * @brief Re-reads the editor and highlighter colours; a change, or
+     * reloaded highlighting rules, redraws every tile.
+     */
+    void syncColors();
+
+    /**
+     * @brief Scrolls the editor to centre the line drawn at @p y.
+     */
+    void scrollTo(int y);
+
+    QPlainTextEdit* editor;
+    SyntaxHighlighter* highlighter;
+    MinimapTiles tiles;
+    QVector<QRgb> palette;  ///< Colours the cached tiles were drawn with.
+    quint64 rulesGeneration = 0;  ///< Highlighter rules the cached tiles were drawn with.
+    QRgb background = 0;
+};
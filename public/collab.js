@@ -0,0 +1,351 @@
+// public/collab.js
+// Browser side of collaborative editing. Speaks the same RGA CRDT and binary
+// op encoding as src/crdt_sequence.cpp, over the relay in src/collabRelay.js.
+// Open the editor with ?doc=<name>&token=<the token src/index.js prints> to
+// join a shared document.
+
+(function () {
+    const MSG_WELCOME = 0x00;
+    const MSG_OPS = 0x01;
+    const MSG_SYNCED = 0x02;
+    const MSG_BASE = 0x03;
+    const OP_INSERT = 1;
+    const OP_DELETE = 2;
+    const FLUSH_DELAY_MS = 30;
+
+    const utf8Encoder = new TextEncoder();
+    const utf8Decoder = new TextDecoder();
+
+    // --- LEB128 -----------------------------------------------------------
+
+    function writeVarint(out, value) {
+        while (value >= 0x80) {
+            out.push((value % 128) | 0x80);
+            value = Math.floor(value / 128);
+        }
+        out.push(value);
+    }
+
+    function readVarint(bytes, state) {
+        let value = 0;
+        let scale = 1;
+        for (;;) {
+            if (state.pos >= bytes.length) throw new Error('truncated varint');
+            const byte = bytes[state.pos++];
+            value += (byte & 0x7f) * scale;
+            if ((byte & 0x80) === 0) return value;
+            scale *= 128;
+        }
+    }
+
+    // --- Op encoding ------------------------------------------------------
+
+    function encodeOps(ops) {
+        const out = [MSG_OPS];
+        writeVarint(out, ops.length);
+        for (const op of ops) {
+            out.push(op.kind);
+            writeVarint(out, op.client);
+            writeVarint(out, op.clock);
+            if (op.kind === OP_INSERT) {
+                writeVarint(out, op.origin.client);
+                writeVarint(out, op.origin.clock);
+                const bytes = utf8Encoder.encode(op.text);
+                writeVarint(out, bytes.length);
+                for (const b of bytes) out.push(b);
+            } else {
+                writeVarint(out, op.length);
+            }
+        }
+        return new Uint8Array(out);
+    }
+
+    function decodeOps(bytes, state) {
+        const count = readVarint(bytes, state);
+        const ops = [];
+        for (let i = 0; i < count; i++) {
+            const kind = bytes[state.pos++];
+            const op = { kind, client: readVarint(bytes, state), clock: readVarint(bytes, state) };
+            if (kind === OP_INSERT) {
+                op.origin = { client: readVarint(bytes, state), clock: readVarint(bytes, state) };
+                const length = readVarint(bytes, state);
+                op.text = utf8Decoder.decode(bytes.subarray(state.pos, state.pos + length));
+                state.pos += length;
+            } else if (kind === OP_DELETE) {
+                op.length = readVarint(bytes, state);
+            } else {
+                throw new Error('unknown op kind ' + kind);
+            }
+            ops.push(op);
+        }
+        return ops;
+    }
+
+    function coalesceOps(ops) {
+        const merged = [];
+        for (const op of ops) {
+            const last = merged[merged.length - 1];
+            if (last && last.kind === OP_INSERT && op.kind === OP_INSERT && last.client === op.client) {
+                const chars = Array.from(last.text).length;
+                if (op.clock === last.clock + chars && op.origin.client === last.client
+                    && op.origin.clock === last.clock + chars - 1) {
+                    last.text += op.text;
+                    continue;
+                }
+            }
+            if (last && last.kind === OP_DELETE && op.kind === OP_DELETE && last.client === op.client) {
+                if (op.clock === last.clock + last.length) {
+                    last.length += op.length;
+                    continue;
+                }
+                if (op.clock + op.length === last.clock) {
+                    last.clock = op.clock;
+                    last.length += op.length;
+                    continue;
+                }
+            }
+            merged.push(op);
+        }
+        return merged;
+    }
+
+    // --- RGA sequence -----------------------------------------------------
+    // One item per code point. Browser documents are small enough that the
+    // linear scans here are fine; the C++ sequence keeps runs in a treap.
+
+    class Sequence {
+        constructor() {
+            this.client = 0; // Assigned by the relay
+            this.lamport = 0;
+            this.items = [];
+            this.byId = new Map();
+        }
+
+        // Starts over from `text` as base state: client 0, clocks from 1,
+        // the same ids on every replica.
+        loadBase(text) {
+            this.items = Array.from(text).map((ch, k) => ({ client: 0, clock: k + 1, ch, deleted: false }));
+            this.byId = new Map(this.items.map((item) => [this.key(item.client, item.clock), item]));
+            this.lamport = this.items.length;
+        }
+
+        key(client, clock) {
+            return client + ':' + clock;
+        }
+
+        // UTF-16 offset of items[index] among visible items.
+        utf16Offset(index) {
+            let offset = 0;
+            for (let i = 0; i < index; i++) {
+                if (!this.items[i].deleted) offset += this.items[i].ch.length;
+            }
+            return offset;
+        }
+
+        // Index of the item holding UTF-16 offset `offset`, or items.length.
+        indexAtUtf16(offset) {
+            let seen = 0;
+            for (let i = 0; i < this.items.length; i++) {
+                const item = this.items[i];
+                if (item.deleted) continue;
+                if (seen >= offset) return i;
+                seen += item.ch.length;
+            }
+            return this.items.length;
+        }
+
+        integrate(client, clock, text, origin) {
+            let left = -1;
+            if (origin.client !== 0 || origin.clock !== 0) {
+                const anchor = this.byId.get(this.key(origin.client, origin.clock));
+                if (!anchor) throw new Error('unknown origin');
+                left = this.items.indexOf(anchor);
+            }
+            let i = left + 1;
+            while (i < this.items.length) {
+                const next = this.items[i];
+                if (next.clock > clock || (next.clock === clock && next.client > client)) i++;
+                else break;
+            }
+            const created = Array.from(text).map((ch, k) => ({ client, clock: clock + k, ch, deleted: false }));
+            this.items.splice(i, 0, ...created);
+            for (const item of created) this.byId.set(this.key(item.client, item.clock), item);
+            this.lamport = Math.max(this.lamport, clock + created.length - 1);
+            return i;
+        }
+
+        localInsert(offset16, text) {
+            const index = this.indexAtUtf16(offset16);
+            let origin = { client: 0, clock: 0 };
+            for (let i = index - 1; i >= 0; i--) {
+                if (!this.items[i].deleted) {
+                    origin = { client: this.items[i].client, clock: this.items[i].clock };
+                    break;
+                }
+            }
+            const clock = this.lamport + 1;
+            this.integrate(this.client, clock, text, origin);
+            return { kind: OP_INSERT, client: this.client, clock, origin, text };
+        }
+
+        localDelete(offset16, length16) {
+            const ops = [];
+            let i = this.indexAtUtf16(offset16);
+            let remaining = length16;
+            for (; i < this.items.length && remaining > 0; i++) {
+                const item = this.items[i];
+                if (item.deleted) continue;
+                item.deleted = true;
+                remaining -= item.ch.length;
+                ops.push({ kind: OP_DELETE, client: item.client, clock: item.clock, length: 1 });
+            }
+            return coalesceOps(ops);
+        }
+
+        // Applies a remote op; calls edit(from16, to16, text) for each
+        // resulting change, in order.
+        applyRemote(op, edit) {
+            if (op.kind === OP_INSERT) {
+                if (op.client === 0) throw new Error('insert claims the base client');
+                if (!op.text || this.byId.has(this.key(op.client, op.clock))) return;
+                const index = this.integrate(op.client, op.clock, op.text, op.origin);
+                const at = this.utf16Offset(index);
+                edit(at, at, op.text);
+                return;
+            }
+            for (let k = 0; k < op.length; k++) {
+                const item = this.byId.get(this.key(op.client, op.clock + k));
+                if (!item) throw new Error('unknown id');
+                if (item.deleted) continue;
+                const at = this.utf16Offset(this.items.indexOf(item));
+                item.deleted = true;
+                edit(at, at + item.ch.length, '');
+            }
+        }
+
+        toString() {
+            return this.items.filter((item) => !item.deleted).map((item) => item.ch).join('');
+        }
+    }
+
+    // --- CodeMirror binding -----------------------------------------------
+
+    function attach(editor, options) {
+        const scheme = location.protocol === 'https:' ? 'wss:' : 'ws:';
+        const url = options.url
+            || `${scheme}//${location.host}/collab/${encodeURIComponent(options.docId)}`
+               + `?token=${encodeURIComponent(options.token)}`;
+        const sequence = new Sequence();
+        const socket = new WebSocket(url);
+        socket.binaryType = 'arraybuffer';
+
+        let pending = [];
+        let flushTimer = null;
+        let applyingRemote = false;
+        let synced = false;
+        let baseLoaded = false;
+        const localText = editor.getValue();
+        editor.setOption('readOnly', true); // Until the history has replayed
+
+        function flush() {
+            flushTimer = null;
+            if (pending.length === 0 || socket.readyState !== WebSocket.OPEN) return;
+            socket.send(encodeOps(coalesceOps(pending)));
+            pending = [];
+        }
+
+        function queue(ops) {
+            pending.push(...ops);
+            if (!flushTimer) flushTimer = setTimeout(flush, FLUSH_DELAY_MS);
+        }
+
+        editor.on('change', (cm, change) => {
+            if (applyingRemote || !synced) return;
+            // Text before change.from is unchanged, so its index is still valid.
+            const from = cm.indexFromPos(change.from);
+            const removed = change.removed.join('\n').length;
+            const inserted = change.text.join('\n');
+            const ops = removed > 0 ? sequence.localDelete(from, removed) : [];
+            if (inserted) ops.push(sequence.localInsert(from, inserted));
+            queue(ops);
+        });
+
+        function applyRemote(ops) {
+            applyingRemote = true;
+            try {
+                editor.operation(() => {
+                    for (const op of ops) {
+                        sequence.applyRemote(op, (from, to, text) => {
+                            editor.replaceRange(text, editor.posFromIndex(from), editor.posFromIndex(to), 'remote');
+                        });
+                    }
+                });
+            } finally {
+                applyingRemote = false;
+            }
+        }
+
+        function loadBase(text) {
+            sequence.loadBase(text);
+            applyingRemote = true;
+            try {
+                editor.setValue(text);
+            } finally {
+                applyingRemote = false;
+            }
+            baseLoaded = true;
+        }
+
+        socket.addEventListener('message', (event) => {
+            const bytes = new Uint8Array(event.data);
+            const state = { pos: 1 };
+            if (bytes[0] === MSG_WELCOME) {
+                sequence.client = readVarint(bytes, state);
+            } else if (bytes[0] === MSG_BASE) {
+                loadBase(utf8Decoder.decode(bytes.subarray(1)));
+            } else if (bytes[0] === MSG_OPS) {
+                applyRemote(decodeOps(bytes, state));
+            } else if (bytes[0] === MSG_SYNCED) {
+                // First one in: what is already in the editor becomes the
+                // base the others load.
+                if (!baseLoaded) {
+                    loadBase(localText);
+                    const base = utf8Encoder.encode(localText);
+                    const frame = new Uint8Array(base.length + 1);
+                    frame[0] = MSG_BASE;
+                    frame.set(base, 1);
+                    socket.send(frame);
+                }
+                synced = true;
+                editor.setOption('readOnly', false);
+                if (options.onStatus) options.onStatus('Collaborating on ' + options.docId);
+            }
+        });
+
+        socket.addEventListener('close', () => {
+            synced = false;
+            if (options.onStatus) options.onStatus('Collaboration disconnected');
+        });
+
+        return { sequence, socket };
+    }
+
+    window.SnCollab = { attach, Sequence, encodeOps, decodeOps, coalesceOps };
+
+    document.addEventListener('DOMContentLoaded', () => {
+        const params = new URLSearchParams(location.search);
+        const docId = params.get('doc');
+        const token = params.get('token') || sessionStorage.getItem('snsupearToken');
+        const wrapper = document.querySelector('.CodeMirror');
+        if (!docId || !token || !wrapper || !wrapper.CodeMirror) return;
+        sessionStorage.setItem('snsupearToken', token);
+        attach(wrapper.CodeMirror, {
+            docId,
+            token,
+            onStatus: (message) => {
+                const status = document.getElementById('status');
+                if (status) status.textContent = message;
+            }
+        });
+    });
+})();
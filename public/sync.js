@@ -0,0 +1,476 @@
+// public/sync.js
+// Delta sync with the native file service (src/file_service.cpp) through
+// /api/file. Edits are composed into one sorted batch of byte-offset
+// replacements, encoded like src/edit_delta.cpp and posted against the last
+// acknowledged revision; the server's ack carries a checksum of its buffer
+// (src/line_checksum.cpp) which is checked here once the editor is idle.
+// Open the editor with ?file=<path relative to the service root>&token=<the
+// token src/index.js prints>.
+
+(function () {
+    const SYNC_DELAY_MS = 300;
+    const RETRY_DELAY_MS = 2000;
+    const EMPTY = new Uint8Array(0);
+
+    const utf8Encoder = new TextEncoder();
+    const utf8Decoder = new TextDecoder();
+
+    // --- LEB128 -----------------------------------------------------------
+
+    function writeVarint(out, value) {
+        while (value >= 0x80) {
+            out.push((value % 128) | 0x80);
+            value = Math.floor(value / 128);
+        }
+        out.push(value);
+    }
+
+    // --- UTF-8 helpers ----------------------------------------------------
+
+    function utf8Length(text) {
+        let length = 0;
+        for (let i = 0; i < text.length; i++) {
+            const c = text.charCodeAt(i);
+            if (c < 0x80) length += 1;
+            else if (c < 0x800) length += 2;
+            else if (c >= 0xd800 && c <= 0xdbff && i + 1 < text.length) {
+                length += 4;
+                i++;
+            } else length += 3;
+        }
+        return length;
+    }
+
+    // FNV-1a over the UTF-8 bytes of one line, as hashLine() in C++.
+    function hashLine(text) {
+        let hash = 0x811c9dc5;
+        const mix = (byte) => { hash = Math.imul(hash ^ byte, 0x01000193); };
+        for (let i = 0; i < text.length; i++) {
+            let c = text.charCodeAt(i);
+            if (c >= 0xd800 && c <= 0xdbff && i + 1 < text.length) {
+                c = 0x10000 + ((c - 0xd800) << 10) + (text.charCodeAt(++i) - 0xdc00);
+            }
+            if (c < 0x80) {
+                mix(c);
+            } else if (c < 0x800) {
+                mix(0xc0 | (c >> 6));
+                mix(0x80 | (c & 0x3f));
+            } else if (c < 0x10000) {
+                mix(0xe0 | (c >> 12));
+                mix(0x80 | ((c >> 6) & 0x3f));
+                mix(0x80 | (c & 0x3f));
+            } else {
+                mix(0xf0 | (c >> 18));
+                mix(0x80 | ((c >> 12) & 0x3f));
+                mix(0x80 | ((c >> 6) & 0x3f));
+                mix(0x80 | (c & 0x3f));
+            }
+        }
+        return hash >>> 0;
+    }
+
+    // sum((i + 1) * hashLine(line i)) mod 2^32, as LineChecksum in C++.
+    function checksumLines(lineCount, lineAt) {
+        let sum = 0;
+        for (let i = 0; i < lineCount; i++) {
+            sum = (sum + Math.imul(i + 1, hashLine(lineAt(i)))) >>> 0;
+        }
+        return sum;
+    }
+
+    // --- Line index -----------------------------------------------------
+    // UTF-8 byte length of every line, in chunks with per-chunk totals, so
+    // the byte offset of a line costs one step per chunk rather than one
+    // per line, and non-ASCII text no longer makes every keystroke O(file).
+
+    const CHUNK_LINES = 512;
+
+    class LineIndex {
+        constructor(text) {
+            this.chunks = [];
+            const lengths = text.split('\n').map(utf8Length);
+            for (let i = 0; i < lengths.length; i += CHUNK_LINES) {
+                this.chunks.push(LineIndex.chunk(lengths.slice(i, i + CHUNK_LINES)));
+            }
+        }
+
+        static chunk(lengths) {
+            return { lengths, total: lengths.reduce((sum, length) => sum + length + 1, 0) };
+        }
+
+        // Chunk holding `line` and the byte offset where that chunk starts.
+        locate(line) {
+            let offset = 0;
+            let c = 0;
+            while (c + 1 < this.chunks.length && line >= this.chunks[c].lengths.length) {
+                line -= this.chunks[c].lengths.length;
+                offset += this.chunks[c].total;
+                c++;
+            }
+            return { c, line, offset };
+        }
+
+        offsetOf(line) {
+            const at = this.locate(line);
+            const lengths = this.chunks[at.c].lengths;
+            let offset = at.offset;
+            for (let k = 0; k < at.line; k++) offset += lengths[k] + 1;
+            return offset;
+        }
+
+        length(line) {
+            const at = this.locate(line);
+            return this.chunks[at.c].lengths[at.line];
+        }
+
+        // Replaces `count` lines from `first` with lines of the given lengths.
+        replace(first, count, lengths) {
+            const at = this.locate(first);
+            let c = at.c;
+            let line = at.line;
+            let remaining = count;
+            const head = this.chunks[c].lengths.slice(0, line);
+            let rest = [];
+            while (remaining > 0 && c < this.chunks.length) {
+                const taken = Math.min(remaining, this.chunks[c].lengths.length - line);
+                remaining -= taken;
+                rest = this.chunks[c].lengths.slice(line + taken);
+                c++;
+                line = 0;
+            }
+            let merged = head.concat(lengths, rest);
+            // A chunk shrunk below half size absorbs its successor; one grown
+            // past twice the size is split.
+            if (merged.length < CHUNK_LINES / 2 && c < this.chunks.length) {
+                merged = merged.concat(this.chunks[c++].lengths);
+            }
+            const pieces = [];
+            const size = merged.length > 2 * CHUNK_LINES ? CHUNK_LINES : merged.length;
+            for (let i = 0; i < merged.length; i += size) {
+                pieces.push(LineIndex.chunk(merged.slice(i, i + size)));
+            }
+            this.chunks.splice(at.c, c - at.c, ...pieces);
+        }
+    }
+
+    // --- Byte arrays ------------------------------------------------------
+
+    function concatBytes(parts) {
+        let length = 0;
+        for (const part of parts) length += part.length;
+        const out = new Uint8Array(length);
+        let at = 0;
+        for (const part of parts) {
+            out.set(part, at);
+            at += part.length;
+        }
+        return out;
+    }
+
+    // --- Edit batches -----------------------------------------------------
+
+    // `edits` is sorted and disjoint in base (last acknowledged) byte
+    // offsets; each holds the bytes that now replace [start, end) and the
+    // base bytes it replaced (`old`). Folds in a change that replaced the
+    // current bytes `removed` at `from` with `bytes`; touching edits merge,
+    // so a run of typing stays a single entry.
+    function addChange(edits, from, removed, bytes) {
+        const to = from + removed.length;
+        let shift = 0; // current offset minus base offset
+        let i = 0;
+        while (i < edits.length && edits[i].start + shift + edits[i].text.length < from) {
+            shift += edits[i].text.length - (edits[i].end - edits[i].start);
+            i++;
+        }
+
+        let start = from - shift;
+        let prefix = EMPTY;
+        let cursor = from; // Current offset up to which base bytes are collected
+        if (i < edits.length && edits[i].start + shift <= from) {
+            start = edits[i].start;
+            prefix = edits[i].text.subarray(0, from - (edits[i].start + shift));
+            cursor = edits[i].start + shift;
+        }
+
+        // Between merged edits the current text is still base text, and it
+        // all lies inside the removed range.
+        const old = [];
+        let j = i;
+        let end = null;
+        let suffix = EMPTY;
+        while (j < edits.length && edits[j].start + shift <= to) {
+            const edit = edits[j++];
+            const current = edit.start + shift;
+            if (current > cursor) old.push(removed.subarray(cursor - from, current - from));
+            old.push(edit.old);
+            cursor = current + edit.text.length;
+            if (current + edit.text.length >= to) {
+                end = edit.end;
+                suffix = edit.text.subarray(to - current);
+                break;
+            }
+            shift += edit.text.length - (edit.end - edit.start);
+        }
+        if (end === null) {
+            end = to - shift;
+            if (to > cursor) old.push(removed.subarray(cursor - from));
+        }
+
+        const text = concatBytes([prefix, bytes, suffix]);
+        if (start === end && text.length === 0) edits.splice(i, j - i);
+        else edits.splice(i, j - i, { start, end, text, old: concatBytes(old) });
+    }
+
+    // Applies sorted, disjoint edits to `base`.
+    function applyEdits(base, edits) {
+        const parts = [];
+        let at = 0;
+        for (const edit of edits) {
+            parts.push(base.subarray(at, edit.start), edit.text);
+            at = edit.end;
+        }
+        parts.push(base.subarray(at));
+        return concatBytes(parts);
+    }
+
+    // The base text that `edits` turned into `current`.
+    function revertEdits(current, edits) {
+        const parts = [];
+        let at = 0;
+        let shift = 0;
+        for (const edit of edits) {
+            const position = edit.start + shift;
+            parts.push(current.subarray(at, position), edit.old);
+            at = position + edit.text.length;
+            shift += edit.text.length - (edit.end - edit.start);
+        }
+        parts.push(current.subarray(at));
+        return concatBytes(parts);
+    }
+
+    // Local edits moved onto `server`, which replaced `base`: the server's
+    // change is taken as the one span between their common prefix and
+    // suffix. Edits overlapping it are dropped.
+    function rebaseEdits(base, server, edits) {
+        let prefix = 0;
+        const limit = Math.min(base.length, server.length);
+        while (prefix < limit && base[prefix] === server[prefix]) prefix++;
+        let suffix = 0;
+        while (suffix < limit - prefix && base[base.length - 1 - suffix] === server[server.length - 1 - suffix]) suffix++;
+        const theirsEnd = base.length - suffix;
+        const delta = server.length - base.length;
+
+        const kept = [];
+        let dropped = 0;
+        for (const edit of edits) {
+            if (edit.end <= prefix) kept.push(edit);
+            else if (edit.start >= theirsEnd) kept.push({ ...edit, start: edit.start + delta, end: edit.end + delta });
+            else dropped++;
+        }
+        return { kept, dropped };
+    }
+
+    function encodeDelta(edits) {
+        const out = [];
+        writeVarint(out, edits.length);
+        for (const edit of edits) {
+            writeVarint(out, edit.start);
+            writeVarint(out, edit.end);
+            writeVarint(out, edit.text.length);
+            for (const b of edit.text) out.push(b);
+        }
+        return new Uint8Array(out);
+    }
+
+    // --- CodeMirror binding -----------------------------------------------
+
+    function attach(editor, options) {
+        const api = options.api || '/api/file';
+        const auth = { Authorization: `Bearer ${options.token}` };
+        let id = null;
+        let revision = 0;
+        let edits = [];
+        let inFlight = false;
+        let timer = null;
+        let applying = false;
+        let lines = new LineIndex('');
+        let generation = 0;   // Bumped on every local change
+
+        // Offsets must be bytes of exactly what the server holds.
+        editor.setOption('lineSeparator', '\n');
+
+        function status(message) {
+            if (options.onStatus) options.onStatus(message);
+        }
+
+        function schedule(delay) {
+            if (!timer) timer = setTimeout(() => { timer = null; flush(); }, delay);
+        }
+
+        editor.on('change', (cm, change) => {
+            if (applying || id === null) return;
+            generation++;
+            // Text before change.from is unchanged, so its offset is still valid.
+            const first = change.from.line;
+            const head = utf8Length(cm.getLine(first).slice(0, change.from.ch));
+            const from = lines.offsetOf(first) + head;
+
+            // The new lines' lengths follow from the change alone: the old
+            // first line's head, the inserted lines and the old last line's tail.
+            const last = change.removed.length - 1;
+            const tail = lines.length(first + last)
+                - (last === 0 ? head + utf8Length(change.removed[0]) : utf8Length(change.removed[last]));
+            const added = change.text.map(utf8Length);
+            added[0] += head;
+            added[added.length - 1] += tail;
+            lines.replace(first, change.removed.length, added);
+
+            addChange(edits, from, utf8Encoder.encode(change.removed.join('\n')),
+                      utf8Encoder.encode(change.text.join('\n')));
+            schedule(SYNC_DELAY_MS);
+        });
+
+        // Shows `text` without treating it as a local edit.
+        function setText(text) {
+            const cursor = editor.getCursor();
+            const scroll = editor.getScrollInfo();
+            lines = new LineIndex(text);
+            applying = true;
+            try {
+                editor.setValue(text);
+            } finally {
+                applying = false;
+            }
+            editor.setCursor(cursor);
+            editor.scrollTo(scroll.left, scroll.top);
+        }
+
+        async function fetchContent() {
+            const response = await fetch(`${api}/content/${encodeURIComponent(id)}`, { headers: auth });
+            if (!response.ok) throw new Error(`HTTP error! status: ${response.status}`);
+            return { bytes: new Uint8Array(await response.arrayBuffer()), revision: Number(response.headers.get('X-Revision')) };
+        }
+
+        async function reload() {
+            const content = await fetchContent();
+            revision = content.revision;
+            edits = [];
+            setText(utf8Decoder.decode(content.bytes));
+        }
+
+        // Puts a batch that did not land back under whatever was typed
+        // meanwhile; later edits are in post-batch offsets, so fold them in
+        // from the end backwards.
+        function requeue(batch) {
+            const later = edits;
+            edits = batch;
+            for (let k = later.length - 1; k >= 0; k--) {
+                addChange(edits, later[k].start, later[k].old, later[k].text);
+            }
+        }
+
+        // The server moved past our base: reapplies the unacknowledged
+        // edits on top of its text instead of discarding them.
+        async function rebase(batch) {
+            const content = await fetchContent();
+            requeue(batch);
+            const base = revertEdits(utf8Encoder.encode(editor.getValue()), edits);
+            const { kept, dropped } = rebaseEdits(base, content.bytes, edits);
+            revision = content.revision;
+            edits = kept;
+            setText(utf8Decoder.decode(applyEdits(content.bytes, kept)));
+            status(dropped ? `Merged with server changes; ${dropped} conflicting edit(s) dropped`
+                           : 'Merged with server changes');
+        }
+
+        function verify(expected, atGeneration) {
+            const check = () => {
+                if (generation !== atGeneration || inFlight || edits.length) return;
+                const actual = checksumLines(editor.lineCount(), (i) => editor.getLine(i));
+                if (actual === expected) return;
+                status('Out of sync with server, reloading');
+                reload().catch((error) => console.error('Sync reload error:', error));
+            };
+            if (window.requestIdleCallback) requestIdleCallback(check);
+            else setTimeout(check, 0);
+        }
+
+        async function flush() {
+            if (inFlight || edits.length === 0 || id === null) return;
+            const sending = edits;
+            const sentAt = generation;
+            edits = [];
+            inFlight = true;
+            let rebasing = false;
+            try {
+                const response = await fetch(`${api}/save/${encodeURIComponent(id)}?base=${revision}`, {
+                    method: 'POST',
+                    headers: { ...auth, 'Content-Type': 'application/octet-stream' },
+                    body: encodeDelta(sending)
+                });
+                if (response.status === 409) {
+                    status('File changed on server, merging');
+                    rebasing = true;
+                    await rebase(sending);
+                    inFlight = false;
+                    if (edits.length) schedule(SYNC_DELAY_MS);
+                    return;
+                }
+                if (!response.ok) throw new Error(`HTTP error! status: ${response.status}`);
+                const ack = await response.json();
+                revision = ack.revision;
+                inFlight = false;
+                if (generation === sentAt) verify(ack.checksum, sentAt);
+                status(`Saved revision ${revision}`);
+            } catch (error) {
+                console.error('Sync error:', error);
+                // A failed rebase leaves the batch unsent; the retry meets
+                // the 409 again.
+                requeue(sending);
+                inFlight = false;
+                status(rebasing ? 'Merge failed, retrying' : 'Sync failed, retrying');
+                schedule(RETRY_DELAY_MS);
+                return;
+            }
+            if (edits.length) schedule(SYNC_DELAY_MS);
+        }
+
+        const session = {
+            flush,
+            get revision() { return revision; },
+            ready: (async () => {
+                const response = await fetch(`${api}/load`, {
+                    method: 'POST',
+                    headers: { ...auth, 'Content-Type': 'application/json' },
+                    body: JSON.stringify({ path: options.path })
+                });
+                if (!response.ok) throw new Error(`HTTP error! status: ${response.status}`);
+                id = (await response.json()).id;
+                await reload();
+                status(`Opened ${options.path}`);
+            })()
+        };
+        return session;
+    }
+
+    window.SnSync = { attach, addChange, applyEdits, revertEdits, rebaseEdits, encodeDelta, LineIndex, checksumLines, hashLine, active: null };
+
+    document.addEventListener('DOMContentLoaded', () => {
+        const params = new URLSearchParams(location.search);
+        const path = params.get('file');
+        // The server prints a link carrying its token; keep it for the tab.
+        const token = params.get('token') || sessionStorage.getItem('snsupearToken');
+        const wrapper = document.querySelector('.CodeMirror');
+        if (!path || !token || !wrapper || !wrapper.CodeMirror) return;
+        sessionStorage.setItem('snsupearToken', token);
+        window.SnSync.active = attach(wrapper.CodeMirror, {
+            path,
+            token,
+            onStatus: (message) => {
+                const status = document.getElementById('status');
+                if (status) status.textContent = message;
+            }
+        });
+        window.SnSync.active.ready.catch((error) => console.error('Sync load error:', error));
+    });
+})();
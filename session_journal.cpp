@@ -0,0 +1,140 @@
+// session_journal.cpp
+#include "session_journal.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+SessionJournal::SessionJournal(QObject* parent)
+    : QObject(parent)
+    , journal(std::make_unique<EditJournal>())
+{}
+
+SessionJournal::~SessionJournal() {
+    close();
+    journal.reset();  // The application is exiting: the edits must reach the disk
+}
+
+std::optional<QString> SessionJournal::recoverable(const QString& filePath) {
+    const QString path = directoryFor(filePath);
+    if (path == directory) {
+        journal->sync();  // Its close may still be queued
+    }
+    std::optional<JournalRecovery> recovery = EditJournal::recover(path.toStdString());
+    if (!recovery || !recovery->unsaved) {
+        return std::nullopt;
+    }
+    return QString::fromStdString(recovery->text);
+}
+
+void SessionJournal::open(const QString& filePath, DocumentMirror* mirror, bool saved) {
+    close();
+    attach(filePath, mirror, saved);
+    journal->open(directory.toStdString(), mirror->buffer().getBuffer(), saved);
+}
+
+void SessionJournal::reattach(const QString& filePath, DocumentMirror* mirror, bool saved) {
+    close();
+    attach(filePath, mirror, saved);
+    pending = true;
+}
+
+void SessionJournal::attach(const QString& filePath, DocumentMirror* mirror, bool saved) {
+    this->mirror = mirror;
+    mirror->acquire();
+    directory = directoryFor(filePath);
+    active = true;
+    dirty = !saved;
+    suspended = false;
+    pending = false;
+    connect(mirror, &DocumentMirror::edited, this, &SessionJournal::onEdited);
+}
+
+void SessionJournal::close() {
+    if (!active) {
+        return;
+    }
+    active = false;
+    disconnect(mirror, nullptr, this, nullptr);
+    std::string error = journal->lastError();
+    if (!pending) {
+        journal->close(!dirty);  // The writer commits what is still queued
+    }
+    mirror->release();
+    mirror = nullptr;
+    if (!error.empty()) {
+        qWarning() << "Edit journal error:" << QString::fromStdString(error);
+    }
+}
+
+void SessionJournal::discard() {
+    if (active && pending && dirty) {
+        journal->remove(directory.toStdString());
+    }
+    dirty = false;
+    close();
+}
+
+void SessionJournal::markSaved() {
+    if (!active) {
+        return;
+    }
+    if (!pending) {
+        journal->checkpoint(mirror->buffer().getBuffer(), true);
+    } else if (dirty) {
+        journal->remove(directory.toStdString());  // Nothing left to recover
+    }
+    dirty = false;
+}
+
+void SessionJournal::suspend() {
+    if (!active || suspended) {
+        return;
+    }
+    disconnect(mirror, nullptr, this, nullptr);
+    suspended = true;
+}
+
+void SessionJournal::resume() {
+    if (!active || !suspended) {
+        return;
+    }
+    if (!pending) {
+        journal->checkpoint(mirror->buffer().getBuffer(), !dirty);
+    } else if (dirty) {
+        // The journal left by close() lacks what was appended meanwhile.
+        journal->open(directory.toStdString(), mirror->buffer().getBuffer(), false);
+        pending = false;
+    }
+    suspended = false;
+    connect(mirror, &DocumentMirror::edited, this, &SessionJournal::onEdited);
+}
+
+void SessionJournal::onEdited(const std::vector<TextEdit>& edits) {
+    if (pending) {
+        // First edit since reattach(): the journal restarts from the text
+        // with it applied.
+        journal->open(directory.toStdString(), mirror->buffer().getBuffer(), false);
+        pending = false;
+        dirty = true;
+        return;
+    }
+    journal->append(edits);
+    dirty = true;
+    if (journal->wantsCheckpoint()) {
+        // Compaction: the journal restarts from a snapshot of the mirror.
+        std::string error = journal->lastError();
+        if (!error.empty()) {
+            qWarning() << "Edit journal error:" << QString::fromStdString(error);
+        }
+        journal->checkpoint(mirror->buffer().getBuffer(), false);
+    }
+}
+
+QString SessionJournal::directoryFor(const QString& filePath) {
+    QByteArray key = QCryptographicHash::hash(QFileInfo(filePath).absoluteFilePath().toUtf8(),
+                                              QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+           + "/journal/" + QString::fromLatin1(key);
+}
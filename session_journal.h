@@ -0,0 +1,115 @@
+// session_journal.h
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "document_mirror.h"
+#include "edit_journal.h"
+
+/**
+ * @brief Crash-recovery journal of the open file's edits.
+ *
+ * Feeds the batches a DocumentMirror announces to an EditJournal kept in
+ * the application's data directory, one per file path, and compacts it
+ * with the mirror's text when the journal asks. Writing happens on the
+ * journal's own thread, started once for the session; opening and closing
+ * a file only queue work for it, so neither typing nor switching files
+ * waits for the disk. A document shown again after close() is journaled
+ * from its first edit: until then the journal close() kept, if any, still
+ * holds its text.
+ */
+class SessionJournal : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a session journal; idle until open().
+     * @param parent The parent object.
+     */
+    explicit SessionJournal(QObject* parent = nullptr);
+
+    /**
+     * @brief Closes the journal and waits for the writer to commit it.
+     */
+    ~SessionJournal() override;
+
+    /**
+     * @brief Text with unsaved changes that an earlier session, or this one
+     * before the file was closed, left for the given file, if any.
+     * @param filePath The file the session was editing.
+     */
+    std::optional<QString> recoverable(const QString& filePath);
+
+    /**
+     * @brief Starts journaling the document, whose current text is the
+     * first checkpoint; closes any journal already open.
+     * @param filePath The file being edited.
+     * @param mirror Mirror of the document, held while open.
+     * @param saved Whether the document matches the file on disk.
+     */
+    void open(const QString& filePath, DocumentMirror* mirror, bool saved);
+
+    /**
+     * @brief Journals a document again that is unchanged since its
+     * close(), writing nothing until it is edited; closes any journal
+     * already open.
+     * @param filePath The file being edited.
+     * @param mirror Mirror of the document, held while open.
+     * @param saved Whether the document matches the file on disk.
+     */
+    void reattach(const QString& filePath, DocumentMirror* mirror, bool saved);
+
+    /**
+     * @brief Stops journaling. Unsaved changes stay recoverable; a journal
+     * with nothing unsaved is removed.
+     */
+    void close();
+
+    /**
+     * @brief Stops journaling and removes the journal, unsaved changes
+     * included, as when they are thrown away.
+     */
+    void discard();
+
+    /**
+     * @brief Notes that the document was just written to its file.
+     */
+    void markSaved();
+
+    /**
+     * @brief Stops journaling changes that only bring the document in line
+     * with its file, such as follow-mode appends, until resume().
+     */
+    void suspend();
+
+    /**
+     * @brief Journals edits again, starting from a checkpoint of the
+     * document as it now is.
+     */
+    void resume();
+
+    bool isOpen() const { return active; }
+
+private slots:
+    void onEdited(const std::vector<TextEdit>& edits);
+
+private:
+    void attach(const QString& filePath, DocumentMirror* mirror, bool saved);
+
+    /**
+     * @brief Journal directory for a file path.
+     */
+    static QString directoryFor(const QString& filePath);
+
+    DocumentMirror* mirror = nullptr;  ///< While open.
+    std::unique_ptr<EditJournal> journal;
+    QString directory;        ///< Of the file open last.
+    bool active = false;
+    bool dirty = false;       ///< Edited since the last save.
+    bool suspended = false;
+    bool pending = false;     ///< Reattached and not written to since.
+};
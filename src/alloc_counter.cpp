@@ -0,0 +1,85 @@
+#include "alloc_counter.h"
+
+#ifdef SNSUPEAR_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local uint64_t allocationCount = 0;
+thread_local uint64_t allocationBytes = 0;
+
+void* countedAllocate(std::size_t size) {
+    ++allocationCount;
+    allocationBytes += size;
+    return std::malloc(size ? size : 1);
+}
+
+void* countedAllocateAligned(std::size_t size, std::align_val_t alignment) {
+    ++allocationCount;
+    allocationBytes += size;
+    // aligned_alloc wants a size that is a multiple of the alignment.
+    std::size_t align = static_cast<std::size_t>(alignment);
+    return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+} // namespace
+
+uint64_t AllocationCounter::threadAllocations() {
+    return allocationCount;
+}
+
+uint64_t AllocationCounter::threadBytes() {
+    return allocationBytes;
+}
+
+void* operator new(std::size_t size) {
+    if (void* p = countedAllocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* p = countedAllocateAligned(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#else
+
+uint64_t AllocationCounter::threadAllocations() {
+    return 0;
+}
+
+uint64_t AllocationCounter::threadBytes() {
+    return 0;
+}
+
+#endif
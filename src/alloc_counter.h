@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * @brief Heap allocation counts for finding allocations on hot paths.
+ *
+ * Build with SNSUPEAR_COUNT_ALLOCATIONS (CMake option of the same name) to
+ * replace the global operator new with a counting one. Counts are kept per
+ * thread, so a scope on the UI thread sees only its own allocations.
+ * Without the option nothing is counted and enabled() is false.
+ */
+class AllocationCounter {
+public:
+    static constexpr bool enabled() {
+#ifdef SNSUPEAR_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Allocations made by the calling thread so far.
+     */
+    static uint64_t threadAllocations();
+
+    /**
+     * @brief Bytes requested by the calling thread so far.
+     */
+    static uint64_t threadBytes();
+};
+
+/**
+ * @brief Counts the calling thread's allocations from construction on.
+ */
+class AllocationScope {
+public:
+    AllocationScope()
+        : startAllocations(AllocationCounter::threadAllocations()), startBytes(AllocationCounter::threadBytes()) {}
+
+    uint64_t allocations() const { return AllocationCounter::threadAllocations() - startAllocations; }
+    uint64_t bytes() const { return AllocationCounter::threadBytes() - startBytes; }
+
+private:
+    uint64_t startAllocations;
+    uint64_t startBytes;
+};
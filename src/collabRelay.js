@@ -0,0 +1,294 @@
+import { WebSocketServer, WebSocket } from 'ws';
+import { tokenMatches } from './middleware/requireToken.js';
+
+// Message types; the first byte of every binary frame.
+export const MSG_WELCOME = 0x00; // relay -> client: varint client id
+export const MSG_OPS = 0x01;     // both ways: encoded CRDT op batch (see src/crdt_sequence.h)
+export const MSG_SYNCED = 0x02;  // relay -> client: history replay finished
+export const MSG_BASE = 0x03;    // both ways: UTF-8 text the document started from
+
+const OP_INSERT = 1;
+const OP_DELETE = 2;
+
+const MAX_ROOMS = 256;
+const IDLE_ROOM_MS = 10 * 60 * 1000;        // Kept this long after the last peer leaves
+const COMPACT_EVERY = 512;                  // History batches merged into one
+const MAX_ROOM_BYTES = 8 * 1024 * 1024;     // Base plus history
+const DOC_ID = /^(?!\.{1,2}$)[\w.-]{1,128}$/;
+
+function encodeVarint(value, out = []) {
+  while (value >= 0x80) {
+    out.push((value & 0x7f) | 0x80);
+    value = Math.floor(value / 128);
+  }
+  out.push(value);
+  return out;
+}
+
+function readVarint(bytes, state) {
+  let value = 0;
+  let scale = 1;
+  for (let shift = 0; shift < 64; shift += 7) {
+    if (state.pos >= bytes.length) throw new Error('truncated varint');
+    const byte = bytes[state.pos++];
+    value += (byte & 0x7f) * scale;
+    if ((byte & 0x80) === 0) return value;
+    scale *= 128;
+  }
+  throw new Error('varint too long');
+}
+
+function codePoints(bytes) {
+  let count = 0;
+  for (const b of bytes) {
+    if ((b & 0xc0) !== 0x80) count++;
+  }
+  return count;
+}
+
+// Decodes the ops of a MSG_OPS frame; throws on malformed input.
+function decodeOps(frame) {
+  const state = { pos: 1 };
+  const count = readVarint(frame, state);
+  const ops = [];
+  for (let i = 0; i < count; i++) {
+    if (state.pos >= frame.length) throw new Error('truncated op');
+    const kind = frame[state.pos++];
+    const op = { kind, client: readVarint(frame, state), clock: readVarint(frame, state) };
+    if (kind === OP_INSERT) {
+      op.originClient = readVarint(frame, state);
+      op.originClock = readVarint(frame, state);
+      const length = readVarint(frame, state);
+      if (state.pos + length > frame.length) throw new Error('truncated text');
+      op.text = frame.subarray(state.pos, state.pos + length);
+      op.chars = codePoints(op.text);
+      state.pos += length;
+    } else if (kind === OP_DELETE) {
+      op.length = readVarint(frame, state);
+    } else {
+      throw new Error('unknown op kind');
+    }
+    ops.push(op);
+  }
+  if (state.pos !== frame.length) throw new Error('trailing bytes');
+  return ops;
+}
+
+function encodeOps(ops) {
+  const head = [MSG_OPS];
+  encodeVarint(ops.length, head);
+  const parts = [Buffer.from(head)];
+  for (const op of ops) {
+    const fields = [op.kind];
+    encodeVarint(op.client, fields);
+    encodeVarint(op.clock, fields);
+    if (op.kind === OP_INSERT) {
+      encodeVarint(op.originClient, fields);
+      encodeVarint(op.originClock, fields);
+      encodeVarint(op.text.length, fields);
+      parts.push(Buffer.from(fields), op.text);
+    } else {
+      encodeVarint(op.length, fields);
+      parts.push(Buffer.from(fields));
+    }
+  }
+  return Buffer.concat(parts);
+}
+
+// Same merging as coalesceCrdtOps() in src/crdt_sequence.cpp.
+function coalesceOps(ops) {
+  const merged = [];
+  for (const op of ops) {
+    const last = merged[merged.length - 1];
+    if (last && last.kind === OP_INSERT && op.kind === OP_INSERT && last.client === op.client
+        && op.clock === last.clock + last.chars && op.originClient === last.client
+        && op.originClock === last.clock + last.chars - 1) {
+      last.text = Buffer.concat([last.text, op.text]);
+      last.chars += op.chars;
+      continue;
+    }
+    if (last && last.kind === OP_DELETE && op.kind === OP_DELETE && last.client === op.client) {
+      if (op.clock === last.clock + last.length) {
+        last.length += op.length;
+        continue;
+      }
+      if (op.clock + op.length === last.clock) {
+        last.clock = op.clock;
+        last.length += op.length;
+        continue;
+      }
+    }
+    merged.push({ ...op });
+  }
+  return merged;
+}
+
+// The relay assigns each connection a client id, gives newcomers the
+// document's base text and op history and forwards every batch to the
+// other peers in arrival order. That single order is causal, so clients
+// never see an op before the ops it depends on.
+//
+// The first peer of a room gets MSG_SYNCED with no base and answers with
+// its own text as MSG_BASE; peers joining meanwhile wait for it. Ops are
+// only checked, never applied: a batch must decode and may only insert
+// under the sender's id. The history is compacted by merging batches, and
+// a room that still outgrows MAX_ROOM_BYTES is closed so its peers start
+// over from their saved text.
+//
+// WebSockets are not covered by CORS, so an upgrade must come from a page
+// of this server (its Origin, when a browser sends one, names our host)
+// and carry the file routes' token as ?token=.
+function sameOrigin(req) {
+  const origin = req.headers.origin;
+  if (!origin) return true; // Not a browser
+  try {
+    return new URL(origin).host === req.headers.host;
+  } catch {
+    return false;
+  }
+}
+
+export function attachCollabRelay(server) {
+  const wss = new WebSocketServer({ noServer: true, maxPayload: MAX_ROOM_BYTES });
+  const rooms = new Map();
+
+  server.on('upgrade', (req, socket, head) => {
+    const { pathname, searchParams } = new URL(req.url, 'http://localhost');
+    if (!sameOrigin(req) || !tokenMatches(searchParams.get('token'))) {
+      socket.write('HTTP/1.1 401 Unauthorized\r\nConnection: close\r\n\r\n');
+      socket.destroy();
+      return;
+    }
+    const match = /^\/collab\/([^/]+)$/.exec(pathname);
+    let docId = null;
+    try {
+      docId = match && decodeURIComponent(match[1]);
+    } catch {
+      // Malformed escapes are refused below
+    }
+    if (!docId || !DOC_ID.test(docId)) {
+      socket.destroy();
+      return;
+    }
+    wss.handleUpgrade(req, socket, head, (ws) => join(ws, docId));
+  });
+
+  function openRoom(docId) {
+    if (rooms.size >= MAX_ROOMS) {
+      // Make way by dropping the longest-idle room, if any is idle.
+      let oldest = null;
+      for (const [id, room] of rooms) {
+        if (room.idleSince && (!oldest || room.idleSince < rooms.get(oldest).idleSince)) oldest = id;
+      }
+      if (!oldest) return null;
+      closeRoom(oldest);
+    }
+    const room = {
+      clients: new Set(), waiting: [], ids: new Map(), founder: null, base: null,
+      history: [], historyBytes: 0, nextClientId: 1, idleSince: 0, idleTimer: null
+    };
+    rooms.set(docId, room);
+    return room;
+  }
+
+  function closeRoom(docId, code, reason) {
+    const room = rooms.get(docId);
+    if (!room) return;
+    rooms.delete(docId);
+    clearTimeout(room.idleTimer);
+    for (const ws of room.ids.keys()) ws.close(code, reason);
+  }
+
+  function sendState(room, ws) {
+    ws.send(Buffer.concat([Buffer.from([MSG_BASE]), room.base]));
+    for (const batch of room.history) ws.send(batch);
+    ws.send(Buffer.from([MSG_SYNCED]));
+    room.clients.add(ws);
+  }
+
+  function promoteFounder(room) {
+    room.founder = room.waiting.shift() || null;
+    if (room.founder) {
+      room.founder.send(Buffer.from([MSG_SYNCED]));
+      room.clients.add(room.founder);
+    }
+  }
+
+  function compact(room) {
+    const ops = [];
+    for (const batch of room.history) {
+      for (const op of decodeOps(batch)) ops.push(op);
+    }
+    const merged = encodeOps(coalesceOps(ops));
+    room.history = [merged];
+    room.historyBytes = merged.length;
+  }
+
+  function join(ws, docId) {
+    const room = rooms.get(docId) || openRoom(docId);
+    if (!room) {
+      ws.close(1013, 'too many documents open');
+      return;
+    }
+    clearTimeout(room.idleTimer);
+    room.idleSince = 0;
+
+    const clientId = room.nextClientId++;
+    room.ids.set(ws, clientId);
+    ws.send(Buffer.from([MSG_WELCOME, ...encodeVarint(clientId)]));
+    if (room.base) {
+      sendState(room, ws);
+    } else if (!room.founder) {
+      room.waiting.unshift(ws);
+      promoteFounder(room);
+    } else {
+      room.waiting.push(ws);
+    }
+
+    ws.on('message', (data, isBinary) => {
+      if (!isBinary || data.length < 1 || rooms.get(docId) !== room) return;
+      if (data[0] === MSG_BASE) {
+        if (ws !== room.founder || room.base) return;
+        room.base = Buffer.from(data.subarray(1));
+        for (const peer of room.waiting.splice(0)) sendState(room, peer);
+        return;
+      }
+      if (data[0] !== MSG_OPS || !room.base || !room.clients.has(ws)) return;
+      let ops;
+      try {
+        ops = decodeOps(data);
+      } catch {
+        ws.close(1007, 'malformed ops');
+        return;
+      }
+      if (ops.some((op) => op.kind === OP_INSERT && op.client !== clientId)) {
+        ws.close(1008, 'ops must be inserted under the assigned client id');
+        return;
+      }
+
+      room.history.push(data);
+      room.historyBytes += data.length;
+      if (room.history.length >= COMPACT_EVERY) compact(room);
+      for (const peer of room.clients) {
+        if (peer !== ws && peer.readyState === WebSocket.OPEN) peer.send(data);
+      }
+      if (room.base.length + room.historyBytes > MAX_ROOM_BYTES) {
+        closeRoom(docId, 1009, 'document history too large; reopen to start over');
+      }
+    });
+
+    ws.on('close', () => {
+      if (rooms.get(docId) !== room) return;
+      room.ids.delete(ws);
+      room.clients.delete(ws);
+      room.waiting = room.waiting.filter((peer) => peer !== ws);
+      if (ws === room.founder && !room.base) promoteFounder(room);
+      if (room.ids.size === 0) {
+        room.idleSince = Date.now();
+        room.idleTimer = setTimeout(() => closeRoom(docId), IDLE_ROOM_MS);
+      }
+    });
+  }
+
+  return wss;
+}
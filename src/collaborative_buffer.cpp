@@ -0,0 +1,109 @@
+#include "collaborative_buffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Sets a flag for its lifetime, so an exception cannot leave it set.
+class FlagScope {
+public:
+    explicit FlagScope(bool& flag) : flag(flag) { flag = true; }
+    ~FlagScope() { flag = false; }
+
+    FlagScope(const FlagScope&) = delete;
+    FlagScope& operator=(const FlagScope&) = delete;
+
+private:
+    bool& flag;
+};
+
+} // namespace
+
+CollaborativeBuffer::CollaborativeBuffer(TextBuffer& buffer)
+    : buffer(buffer)
+{
+    // Every replica opening the same text shares it as base state.
+    sequence.loadBase(buffer.getBuffer());
+    buffer.addChangeListener([this](const DamageRegion& damage) { onBufferChanged(damage); });
+}
+
+void CollaborativeBuffer::loadBase(std::string_view text) {
+    {
+        FlagScope scope(applying);
+        buffer.loadText(text);
+    }
+    sequence.loadBase(std::string(text));
+    pending.clear();
+}
+
+void CollaborativeBuffer::applyLocalEdits(const std::vector<TextEdit>& edits) {
+    if (sequence.clientId() == 0) {
+        throw std::logic_error("CollaborativeBuffer: no client id assigned");
+    }
+    {
+        // The buffer validates the batch before the sequence sees it.
+        FlagScope scope(applying);
+        buffer.applyEdits(edits);
+    }
+
+    // Walk the batch back to front so earlier offsets stay valid.
+    for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+        if (it->end > it->start) {
+            std::vector<CrdtOp> deletes = sequence.localDelete(it->start, it->end);
+            pending.insert(pending.end(), deletes.begin(), deletes.end());
+        }
+        if (!it->replacement.empty()) {
+            pending.push_back(sequence.localInsert(it->start, it->replacement));
+        }
+    }
+}
+
+void CollaborativeBuffer::applyRemote(std::string_view encodedOps) {
+    std::vector<CrdtOp> ops = decodeCrdtOps(encodedOps);
+    FlagScope scope(applying);
+    for (const CrdtOp& op : ops) {
+        // Each op's edits are sequential, so apply them one at a time.
+        for (const TextEdit& edit : sequence.applyRemote(op)) {
+            buffer.applyExternalEdits({edit});
+        }
+    }
+}
+
+std::string CollaborativeBuffer::takePendingOps() {
+    if (pending.empty()) {
+        return std::string();
+    }
+    coalesceCrdtOps(pending);
+    std::string encoded = encodeCrdtOps(pending);
+    pending.clear();
+    return encoded;
+}
+
+void CollaborativeBuffer::onBufferChanged(const DamageRegion& damage) {
+    if (applying) {
+        return;
+    }
+    if (damage.oldLength > 0) {
+        std::vector<CrdtOp> deletes = sequence.localDelete(damage.startOffset, damage.startOffset + damage.oldLength);
+        pending.insert(pending.end(), deletes.begin(), deletes.end());
+    }
+    if (damage.newLength > 0) {
+        std::string inserted;
+        inserted.reserve(damage.newLength);
+        size_t end = damage.startOffset + damage.newLength;
+        for (size_t line = buffer.lineOfOffset(damage.startOffset), offset = damage.startOffset; offset < end; ++line) {
+            size_t lineStart = buffer.offsetOfLine(line);
+            std::string_view text = buffer.lineView(line);
+            size_t from = offset - lineStart;
+            size_t to = std::min(text.size(), end - lineStart);
+            inserted.append(text.substr(from, to - from));
+            offset = lineStart + to;
+            if (offset < end) {
+                inserted += '\n';
+                ++offset;
+            }
+        }
+        pending.push_back(sequence.localInsert(damage.startOffset, inserted));
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "crdt_sequence.h"
+#include "text_buffer.h"
+
+/**
+ * @brief Keeps a TextBuffer in sync with a shared CrdtSequence.
+ *
+ * Local edits made through applyLocalEdits() become precise CRDT ops;
+ * any other change to the buffer (undo, redo, appendText) is picked up from
+ * its DamageRegion as a replace of the damaged span. Ops are queued and
+ * handed out in coalesced, encoded batches, so a typing burst between two
+ * flushes travels as one insert.
+ *
+ * The text the buffer starts with is base state shared by every replica,
+ * not an op: each one loads the same base, either its own copy of the file
+ * or the one the relay sends (loadBase()). Local edits need the client id
+ * the relay assigns (setClientId()).
+ */
+class CollaborativeBuffer {
+public:
+    explicit CollaborativeBuffer(TextBuffer& buffer);
+
+    CollaborativeBuffer(const CollaborativeBuffer&) = delete;
+    CollaborativeBuffer& operator=(const CollaborativeBuffer&) = delete;
+
+    /**
+     * @brief Replaces the buffer's text and the shared state with @p text
+     * as base, dropping queued ops.
+     */
+    void loadBase(std::string_view text);
+
+    /**
+     * @brief Applies a sorted, disjoint batch to the buffer (one undo step)
+     * and records the matching ops. Throws std::logic_error before a client
+     * id is assigned.
+     */
+    void applyLocalEdits(const std::vector<TextEdit>& edits);
+
+    /**
+     * @brief Integrates an encoded batch from another replica and applies
+     * the resulting edits to the buffer; its undo history is moved past
+     * them rather than recording them.
+     */
+    void applyRemote(std::string_view encodedOps);
+
+    /**
+     * @brief Returns queued local ops as one encoded batch, or an empty
+     * string if there is nothing to send.
+     */
+    std::string takePendingOps();
+
+    void setClientId(uint32_t clientId) { sequence.setClientId(clientId); }
+    const CrdtSequence& crdt() const { return sequence; }
+
+private:
+    void onBufferChanged(const DamageRegion& damage);
+
+    TextBuffer& buffer;
+    CrdtSequence sequence;
+    std::vector<CrdtOp> pending;
+    bool applying = false;  ///< Set while we change the buffer ourselves.
+};
@@ -0,0 +1,84 @@
+import { Readable } from 'stream';
+
+const FILE_SERVICE_URL = process.env.FILE_SERVICE_URL || 'http://127.0.0.1:3001';
+// Shared with snsupear_fileserver, which refuses requests without it.
+const SERVICE_SECRET = process.env.SNSUPEAR_SERVICE_SECRET || '';
+const SERVICE_AUTH = { 'X-Service-Secret': SERVICE_SECRET };
+if (!SERVICE_SECRET) {
+  console.warn('SNSUPEAR_SERVICE_SECRET is not set; the file service will refuse every request');
+}
+
+// Headers from the native service that the browser needs to see verbatim.
+const FORWARDED_HEADERS = ['content-type', 'content-length', 'content-range', 'accept-ranges', 'x-revision'];
+
+/**
+ * Thin proxy in front of the native file service (snsupear_fileserver).
+ * File bytes never pass through JSON here: reads are streamed straight
+ * from the service (which uses sendfile) and saves forward the raw
+ * edit-delta body untouched.
+ */
+export class FileController {
+  loadFile = async (req, res, next) => {
+    try {
+      // The service confines resolved paths to its root; this only turns
+      // away what can never be a relative path.
+      const path = req.body?.path;
+      if (typeof path !== 'string' || path === '' || path.startsWith('/') || path.includes('\0')) {
+        res.status(400).json({ error: 'path must be relative to the workspace root' });
+        return;
+      }
+      const upstream = await fetch(`${FILE_SERVICE_URL}/load`, {
+        method: 'POST',
+        headers: { ...SERVICE_AUTH, 'Content-Type': 'application/json' },
+        body: JSON.stringify({ path })
+      });
+      await this.#relay(upstream, res);
+    } catch (err) {
+      next(err);
+    }
+  };
+
+  getFileContent = async (req, res, next) => {
+    try {
+      const headers = { ...SERVICE_AUTH };
+      if (req.headers.range) {
+        headers.Range = req.headers.range;
+      }
+      const upstream = await fetch(`${FILE_SERVICE_URL}/content/${encodeURIComponent(req.params.id)}`, { headers });
+      // Byte ranges must reach the client as-is, not re-encoded by compression().
+      res.setHeader('Cache-Control', 'no-transform');
+      await this.#relay(upstream, res);
+    } catch (err) {
+      next(err);
+    }
+  };
+
+  saveFile = async (req, res, next) => {
+    try {
+      const base = req.query.base !== undefined ? `?base=${encodeURIComponent(req.query.base)}` : '';
+      const upstream = await fetch(`${FILE_SERVICE_URL}/save/${encodeURIComponent(req.params.id)}${base}`, {
+        method: 'POST',
+        headers: { ...SERVICE_AUTH, 'Content-Type': req.headers['content-type'] || '' },
+        body: req.body
+      });
+      await this.#relay(upstream, res);
+    } catch (err) {
+      next(err);
+    }
+  };
+
+  async #relay(upstream, res) {
+    res.status(upstream.status);
+    for (const name of FORWARDED_HEADERS) {
+      const value = upstream.headers.get(name);
+      if (value !== null) {
+        res.setHeader(name, value);
+      }
+    }
+    if (!upstream.body) {
+      res.end();
+      return;
+    }
+    Readable.fromWeb(upstream.body).pipe(res);
+  }
+}
@@ -0,0 +1,468 @@
+#include "crdt_sequence.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "varint.h"
+
+// A run of code points with consecutive clocks from one client, and a treap
+// node ordered by document position.
+struct CrdtRun {
+    uint32_t client;
+    uint64_t clock;     ///< Clock of the first code point.
+    std::string text;
+    size_t chars;       ///< Code points in text.
+    bool deleted = false;
+
+    uint32_t priority = 0;
+    CrdtRun* left = nullptr;
+    CrdtRun* right = nullptr;
+    CrdtRun* parent = nullptr;
+    size_t count = 1;          ///< Runs in this subtree.
+    size_t subtreeBytes = 0;   ///< Visible bytes in this subtree.
+    size_t subtreeChars = 0;   ///< Visible code points in this subtree.
+};
+
+namespace {
+
+size_t countCodePoints(std::string_view text) {
+    size_t count = 0;
+    for (char c : text) {
+        if ((static_cast<unsigned char>(c) & 0xC0) != 0x80) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t byteOffsetOfChar(std::string_view text, size_t chars) {
+    size_t seen = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if ((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80 && seen++ == chars) {
+            return i;
+        }
+    }
+    return text.size();
+}
+
+size_t runCount(const CrdtRun* run) { return run ? run->count : 0; }
+size_t runBytes(const CrdtRun* run) { return run ? run->subtreeBytes : 0; }
+size_t runChars(const CrdtRun* run) { return run ? run->subtreeChars : 0; }
+size_t ownBytes(const CrdtRun* run) { return run->deleted ? 0 : run->text.size(); }
+
+void pull(CrdtRun* run) {
+    run->count = 1 + runCount(run->left) + runCount(run->right);
+    run->subtreeBytes = ownBytes(run) + runBytes(run->left) + runBytes(run->right);
+    run->subtreeChars = (run->deleted ? 0 : run->chars) + runChars(run->left) + runChars(run->right);
+    if (run->left) {
+        run->left->parent = run;
+    }
+    if (run->right) {
+        run->right->parent = run;
+    }
+}
+
+void pullToRoot(CrdtRun* run) {
+    for (; run; run = run->parent) {
+        pull(run);
+    }
+}
+
+// Splits off the first k runs of t into a, the rest into b.
+void split(CrdtRun* t, size_t k, CrdtRun*& a, CrdtRun*& b) {
+    if (!t) {
+        a = b = nullptr;
+        return;
+    }
+    if (runCount(t->left) < k) {
+        split(t->right, k - runCount(t->left) - 1, t->right, b);
+        a = t;
+    } else {
+        split(t->left, k, a, t->left);
+        b = t;
+    }
+    pull(t);
+}
+
+CrdtRun* merge(CrdtRun* a, CrdtRun* b) {
+    if (!a || !b) {
+        return a ? a : b;
+    }
+    if (a->priority > b->priority) {
+        a->right = merge(a->right, b);
+        pull(a);
+        return a;
+    }
+    b->left = merge(a, b->left);
+    pull(b);
+    return b;
+}
+
+size_t rank(const CrdtRun* run) {
+    size_t r = runCount(run->left);
+    for (; run->parent; run = run->parent) {
+        if (run == run->parent->right) {
+            r += runCount(run->parent->left) + 1;
+        }
+    }
+    return r;
+}
+
+size_t visibleBytesBefore(const CrdtRun* run) {
+    size_t bytes = runBytes(run->left);
+    for (; run->parent; run = run->parent) {
+        if (run == run->parent->right) {
+            bytes += runBytes(run->parent->left) + ownBytes(run->parent);
+        }
+    }
+    return bytes;
+}
+
+CrdtRun* leftmost(CrdtRun* run) {
+    while (run && run->left) {
+        run = run->left;
+    }
+    return run;
+}
+
+CrdtRun* successor(CrdtRun* run) {
+    if (run->right) {
+        return leftmost(run->right);
+    }
+    while (run->parent && run == run->parent->right) {
+        run = run->parent;
+    }
+    return run->parent;
+}
+
+void markDeleted(CrdtRun* run) {
+    run->deleted = true;
+    pullToRoot(run);
+}
+
+// RGA order: a later (higher clock, then higher client) sibling comes first.
+bool precedes(const CrdtRun* run, uint32_t client, uint64_t clock) {
+    return run->clock > clock || (run->clock == clock && run->client > client);
+}
+
+} // namespace
+
+CrdtSequence::CrdtSequence(uint32_t clientId) : client(clientId) {}
+
+CrdtSequence::~CrdtSequence() {
+    clear();
+}
+
+void CrdtSequence::clear() {
+    for (auto& perClient : index) {
+        for (auto& entry : perClient.second) {
+            delete entry.second;
+        }
+    }
+    index.clear();
+    root = nullptr;
+    lamport = 0;
+}
+
+void CrdtSequence::loadBase(const std::string& text) {
+    clear();
+    if (!text.empty()) {
+        integrate(0, 1, text, CrdtId{0, 0});
+    }
+}
+
+uint32_t CrdtSequence::nextPriority() {
+    // xorshift32; treap priorities only need to be well spread.
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+CrdtRun* CrdtSequence::find(uint32_t runClient, uint64_t clock) const {
+    auto perClient = index.find(runClient);
+    if (perClient == index.end()) {
+        return nullptr;
+    }
+    auto it = perClient->second.upper_bound(clock);
+    if (it == perClient->second.begin()) {
+        return nullptr;
+    }
+    CrdtRun* run = std::prev(it)->second;
+    return clock < run->clock + run->chars ? run : nullptr;
+}
+
+CrdtRun* CrdtSequence::splitRun(CrdtRun* run, size_t chars) {
+    size_t byte = byteOffsetOfChar(run->text, chars);
+    CrdtRun* tail = new CrdtRun{run->client, run->clock + chars, run->text.substr(byte), run->chars - chars};
+    tail->deleted = run->deleted;
+    tail->priority = nextPriority();
+    run->text.resize(byte);
+    run->chars = chars;
+    pullToRoot(run);
+
+    index[tail->client][tail->clock] = tail;
+    insertAfter(run, tail);
+    return tail;
+}
+
+CrdtRun* CrdtSequence::findVisibleByte(size_t position, size_t& offsetInRun) const {
+    CrdtRun* run = root;
+    while (run) {
+        size_t leftBytes = runBytes(run->left);
+        if (position < leftBytes) {
+            run = run->left;
+            continue;
+        }
+        position -= leftBytes;
+        if (position < ownBytes(run)) {
+            offsetInRun = position;
+            return run;
+        }
+        position -= ownBytes(run);
+        run = run->right;
+    }
+    return nullptr;
+}
+
+void CrdtSequence::insertAfter(CrdtRun* anchor, CrdtRun* run) {
+    size_t k = anchor ? rank(anchor) + 1 : 0;
+    CrdtRun* a = nullptr;
+    CrdtRun* b = nullptr;
+    split(root, k, a, b);
+    if (a) {
+        a->parent = nullptr;
+    }
+    if (b) {
+        b->parent = nullptr;
+    }
+    pull(run);
+    root = merge(merge(a, run), b);
+    root->parent = nullptr;
+}
+
+CrdtRun* CrdtSequence::integrate(uint32_t runClient, uint64_t clock, const std::string& text, CrdtId origin) {
+    CrdtRun* left = nullptr;
+    if (origin.client != 0 || origin.clock != 0) {
+        left = find(origin.client, origin.clock);
+        if (!left) {
+            throw std::invalid_argument("CrdtSequence: insert references an unknown origin");
+        }
+        size_t chars = origin.clock - left->clock + 1;
+        if (chars < left->chars) {
+            splitRun(left, chars);
+        }
+    }
+
+    // Skip concurrent inserts at the same origin that order first; their
+    // descendants all carry higher clocks, so whole runs are skipped.
+    CrdtRun* next = left ? successor(left) : leftmost(root);
+    bool skipped = false;
+    while (next && precedes(next, runClient, clock)) {
+        left = next;
+        next = successor(next);
+        skipped = true;
+    }
+
+    // Typing straight after our own last code point extends that run.
+    if (!skipped && left && !left->deleted && left->client == runClient
+        && left->clock + left->chars == clock && origin.client == runClient) {
+        left->text += text;
+        left->chars += countCodePoints(text);
+        pullToRoot(left);
+        lamport = std::max(lamport, left->clock + left->chars - 1);
+        return left;
+    }
+
+    CrdtRun* run = new CrdtRun{runClient, clock, text, countCodePoints(text)};
+    run->priority = nextPriority();
+    index[runClient][clock] = run;
+    insertAfter(left, run);
+    lamport = std::max(lamport, clock + run->chars - 1);
+    return run;
+}
+
+CrdtOp CrdtSequence::localInsert(size_t bytePosition, const std::string& text) {
+    if (client == 0) {
+        throw std::logic_error("CrdtSequence::localInsert: no client id assigned");
+    }
+    CrdtId origin{0, 0};
+    if (bytePosition > 0) {
+        size_t offset = 0;
+        CrdtRun* run = findVisibleByte(bytePosition - 1, offset);
+        if (!run) {
+            throw std::out_of_range("CrdtSequence::localInsert: position past end");
+        }
+        size_t chars = countCodePoints(std::string_view(run->text).substr(0, offset + 1));
+        origin = {run->client, run->clock + chars - 1};
+    }
+
+    uint64_t clock = lamport + 1;
+    integrate(client, clock, text, origin);
+    return {CrdtOp::Kind::Insert, client, clock, origin, text, 0};
+}
+
+std::vector<CrdtOp> CrdtSequence::localDelete(size_t byteStart, size_t byteEnd) {
+    std::vector<CrdtOp> ops;
+    while (byteStart < byteEnd) {
+        size_t offset = 0;
+        CrdtRun* run = findVisibleByte(byteStart, offset);
+        if (!run) {
+            break;
+        }
+        if (offset > 0) {
+            run = splitRun(run, countCodePoints(std::string_view(run->text).substr(0, offset)));
+        }
+        size_t taken = run->text.size();
+        if (taken > byteEnd - byteStart) {
+            taken = byteEnd - byteStart;
+            splitRun(run, countCodePoints(std::string_view(run->text).substr(0, taken)));
+        }
+        ops.push_back({CrdtOp::Kind::Delete, run->client, run->clock, {0, 0}, std::string(), run->chars});
+        markDeleted(run);
+        // The deleted bytes drop out of the visible text; byteStart stays.
+        byteEnd -= taken;
+    }
+    coalesceCrdtOps(ops);
+    return ops;
+}
+
+std::vector<TextEdit> CrdtSequence::applyRemote(const CrdtOp& op) {
+    std::vector<TextEdit> edits;
+    if (op.kind == CrdtOp::Kind::Insert) {
+        if (op.client == 0) {
+            throw std::invalid_argument("CrdtSequence: insert claims the reserved base client");
+        }
+        if (op.text.empty() || find(op.client, op.clock)) {
+            return edits;
+        }
+        CrdtRun* run = integrate(op.client, op.clock, op.text, op.origin);
+        // The run may have absorbed the text at its end.
+        size_t position = visibleBytesBefore(run) + ownBytes(run) - op.text.size();
+        edits.push_back({position, position, op.text});
+        return edits;
+    }
+
+    uint64_t clock = op.clock;
+    uint64_t remaining = op.length;
+    while (remaining > 0) {
+        CrdtRun* run = find(op.client, clock);
+        if (!run) {
+            throw std::invalid_argument("CrdtSequence: delete references an unknown id");
+        }
+        if (clock > run->clock) {
+            run = splitRun(run, clock - run->clock);
+        }
+        if (run->chars > remaining) {
+            splitRun(run, remaining);
+        }
+        if (!run->deleted) {
+            size_t position = visibleBytesBefore(run);
+            edits.push_back({position, position + run->text.size(), std::string()});
+            markDeleted(run);
+        }
+        remaining -= run->chars;
+        clock += run->chars;
+    }
+    return edits;
+}
+
+std::string CrdtSequence::toString() const {
+    std::string text;
+    text.reserve(visibleBytes());
+    for (CrdtRun* run = leftmost(root); run; run = successor(run)) {
+        if (!run->deleted) {
+            text += run->text;
+        }
+    }
+    return text;
+}
+
+size_t CrdtSequence::visibleBytes() const {
+    return runBytes(root);
+}
+
+size_t CrdtSequence::visibleChars() const {
+    return runChars(root);
+}
+
+size_t CrdtSequence::nodeCount() const {
+    return runCount(root);
+}
+
+void coalesceCrdtOps(std::vector<CrdtOp>& ops) {
+    std::vector<CrdtOp> merged;
+    merged.reserve(ops.size());
+    for (CrdtOp& op : ops) {
+        if (!merged.empty()) {
+            CrdtOp& last = merged.back();
+            if (last.kind == CrdtOp::Kind::Insert && op.kind == CrdtOp::Kind::Insert && last.client == op.client) {
+                uint64_t chars = countCodePoints(last.text);
+                if (op.clock == last.clock + chars && op.origin.client == last.client
+                    && op.origin.clock == last.clock + chars - 1) {
+                    last.text += op.text;
+                    continue;
+                }
+            }
+            if (last.kind == CrdtOp::Kind::Delete && op.kind == CrdtOp::Kind::Delete && last.client == op.client) {
+                if (op.clock == last.clock + last.length) {
+                    last.length += op.length;
+                    continue;
+                }
+                if (op.clock + op.length == last.clock) {  // Backspacing.
+                    last.clock = op.clock;
+                    last.length += op.length;
+                    continue;
+                }
+            }
+        }
+        merged.push_back(std::move(op));
+    }
+    ops = std::move(merged);
+}
+
+std::string encodeCrdtOps(const std::vector<CrdtOp>& ops) {
+    std::string out;
+    appendVarint(out, ops.size());
+    for (const CrdtOp& op : ops) {
+        out.push_back(static_cast<char>(op.kind));
+        appendVarint(out, op.client);
+        appendVarint(out, op.clock);
+        if (op.kind == CrdtOp::Kind::Insert) {
+            appendVarint(out, op.origin.client);
+            appendVarint(out, op.origin.clock);
+            appendVarint(out, op.text.size());
+            out += op.text;
+        } else {
+            appendVarint(out, op.length);
+        }
+    }
+    return out;
+}
+
+std::vector<CrdtOp> decodeCrdtOps(std::string_view data) {
+    size_t pos = 0;
+    uint64_t count = readVarint(data, pos);
+    std::vector<CrdtOp> ops;
+    ops.reserve(static_cast<size_t>(std::min<uint64_t>(count, data.size())));
+    for (uint64_t i = 0; i < count; ++i) {
+        CrdtOp op{};
+        uint8_t kind = static_cast<uint8_t>(readBytes(data, pos, 1)[0]);
+        if (kind != static_cast<uint8_t>(CrdtOp::Kind::Insert) && kind != static_cast<uint8_t>(CrdtOp::Kind::Delete)) {
+            throw std::invalid_argument("unknown CRDT op kind");
+        }
+        op.kind = static_cast<CrdtOp::Kind>(kind);
+        op.client = static_cast<uint32_t>(readVarint(data, pos));
+        op.clock = readVarint(data, pos);
+        if (op.kind == CrdtOp::Kind::Insert) {
+            op.origin.client = static_cast<uint32_t>(readVarint(data, pos));
+            op.origin.clock = readVarint(data, pos);
+            op.text = std::string(readBytes(data, pos, static_cast<size_t>(readVarint(data, pos))));
+        } else {
+            op.length = readVarint(data, pos);
+        }
+        ops.push_back(std::move(op));
+    }
+    return ops;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "text_buffer.h"
+
+struct CrdtRun;
+
+// Identifies one code point: the replica that inserted it and its Lamport
+// clock. Client 0 is reserved: clock 0 is the start of the document and
+// clocks from 1 are the base text every replica starts from.
+struct CrdtId {
+    uint32_t client;
+    uint64_t clock;
+};
+
+// An insert carries a run of code points with consecutive clocks starting at
+// `clock`, placed after `origin`. A delete removes `length` code points with
+// consecutive clocks starting at (client, clock).
+struct CrdtOp {
+    enum class Kind : uint8_t { Insert = 1, Delete = 2 };
+
+    Kind kind;
+    uint32_t client;
+    uint64_t clock;
+    CrdtId origin;     ///< Insert only.
+    std::string text;  ///< Insert only, UTF-8.
+    uint64_t length;   ///< Delete only, in code points.
+};
+
+/**
+ * @brief RGA sequence CRDT over Unicode code points, stored as runs.
+ *
+ * Consecutive code points typed by one replica share a node, so typing
+ * costs one node per burst rather than one per character. Nodes live in an
+ * implicit treap that keeps visible byte and code-point counts per subtree,
+ * and an id index maps (client, clock) to its node; locating an id or a
+ * position, splitting a run and inserting are all O(log n). Deleted code
+ * points stay as tombstones so concurrent inserts can still find their
+ * origin.
+ */
+class CrdtSequence {
+public:
+    /// Client 0 means unassigned: local inserts throw std::logic_error until
+    /// setClientId() is given the id the relay hands out.
+    explicit CrdtSequence(uint32_t clientId = 0);
+    ~CrdtSequence();
+
+    CrdtSequence(const CrdtSequence&) = delete;
+    CrdtSequence& operator=(const CrdtSequence&) = delete;
+
+    uint32_t clientId() const { return client; }
+    void setClientId(uint32_t id) { client = id; }
+
+    /**
+     * @brief Discards the sequence and starts over from @p text as base
+     * state. Replicas that load the same base share its ids without any op
+     * being sent.
+     */
+    void loadBase(const std::string& text);
+
+    /**
+     * @brief Inserts UTF-8 text at a visible byte offset.
+     * @return The operation to broadcast.
+     */
+    CrdtOp localInsert(size_t bytePosition, const std::string& text);
+
+    /**
+     * @brief Deletes visible bytes [byteStart, byteEnd), which must fall on
+     * code point boundaries.
+     * @return One delete per run of consecutive ids, in document order.
+     */
+    std::vector<CrdtOp> localDelete(size_t byteStart, size_t byteEnd);
+
+    /**
+     * @brief Integrates an operation from another replica.
+     * @return The resulting byte edits, to be applied one after another.
+     * Already-integrated inserts are ignored. Throws std::invalid_argument
+     * if the op references an id this replica has not seen.
+     */
+    std::vector<TextEdit> applyRemote(const CrdtOp& op);
+
+    std::string toString() const;
+    size_t visibleBytes() const;
+    size_t visibleChars() const;
+    size_t nodeCount() const;
+
+private:
+    void clear();
+    CrdtRun* integrate(uint32_t runClient, uint64_t clock, const std::string& text, CrdtId origin);
+    CrdtRun* find(uint32_t runClient, uint64_t clock) const;
+    CrdtRun* splitRun(CrdtRun* run, size_t chars);
+    CrdtRun* findVisibleByte(size_t position, size_t& offsetInRun) const;
+    void insertAfter(CrdtRun* anchor, CrdtRun* run);
+    uint32_t nextPriority();
+
+    uint32_t client;
+    uint64_t lamport = 0;
+    CrdtRun* root = nullptr;
+    uint32_t seed = 0x9E3779B9u;
+    std::unordered_map<uint32_t, std::map<uint64_t, CrdtRun*>> index;  ///< client -> first clock -> run
+};
+
+/**
+ * @brief Merges adjacent ops that continue each other (a typing burst, a
+ * run of backspaces) into single ops.
+ */
+void coalesceCrdtOps(std::vector<CrdtOp>& ops);
+
+/**
+ * @brief Encodes ops as: varint count, then per op a kind byte followed by
+ * varint fields (insert: client, clock, origin client, origin clock, byte
+ * length, UTF-8 bytes; delete: client, clock, length).
+ */
+std::string encodeCrdtOps(const std::vector<CrdtOp>& ops);
+
+/**
+ * @brief Decodes encodeCrdtOps() output; throws std::invalid_argument on
+ * malformed input.
+ */
+std::vector<CrdtOp> decodeCrdtOps(std::string_view data);
@@ -0,0 +1,706 @@
+#include "diagnostics.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+
+// A file full of warnings is not made more useful by the ten-thousandth.
+constexpr size_t kMaxDiagnostics = 1000;
+
+bool isIdentifierByte(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+std::string extensionOf(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+enum class CommentStyle { None, CLike, Hash };
+
+CommentStyle commentStyleOf(const std::string& path) {
+    static const char* const cLike[] = {".c", ".cc", ".cpp", ".cxx", ".h", ".hh", ".hpp", ".hxx",
+                                        ".js", ".mjs", ".ts", ".tsx", ".jsx", ".java", ".cs", ".go",
+                                        ".rs", ".swift", ".kt", ".css", ".json"};
+    static const char* const hash[] = {".py", ".sh", ".rb", ".pl", ".cmake", ".yaml", ".yml", ".toml"};
+    const std::string extension = extensionOf(path);
+    for (const char* candidate : cLike) {
+        if (extension == candidate) {
+            return CommentStyle::CLike;
+        }
+    }
+    for (const char* candidate : hash) {
+        if (extension == candidate) {
+            return CommentStyle::Hash;
+        }
+    }
+    return CommentStyle::None;
+}
+
+char closerOf(char opener) {
+    return opener == '(' ? ')' : opener == '[' ? ']' : '}';
+}
+
+void checkBrackets(std::string_view text, CommentStyle style, std::vector<Diagnostic>& out) {
+    struct Open {
+        char bracket;
+        size_t offset;
+    };
+    std::vector<Open> stack;
+    enum class State { Code, LineComment, BlockComment, String } state = State::Code;
+    char quote = 0;
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i];
+        switch (state) {
+        case State::LineComment:
+            if (c == '\n') {
+                state = State::Code;
+            }
+            continue;
+        case State::BlockComment:
+            if (c == '*' && i + 1 < text.size() && text[i + 1] == '/') {
+                state = State::Code;
+                ++i;
+            }
+            continue;
+        case State::String:
+            if (c == '\\') {
+                ++i;
+            } else if (c == quote || c == '\n') {  // Unterminated strings end with the line
+                state = State::Code;
+            }
+            continue;
+        case State::Code:
+            break;
+        }
+
+        const char next = i + 1 < text.size() ? text[i + 1] : '\0';
+        if (style == CommentStyle::CLike && c == '/' && (next == '/' || next == '*')) {
+            state = next == '/' ? State::LineComment : State::BlockComment;
+            ++i;
+        } else if (style == CommentStyle::Hash && c == '#') {
+            state = State::LineComment;
+        } else if (c == '"' || c == '\'' || (c == '`' && style == CommentStyle::CLike)) {
+            state = State::String;
+            quote = c;
+        } else if (c == '(' || c == '[' || c == '{') {
+            stack.push_back({c, i});
+        } else if (c == ')' || c == ']' || c == '}') {
+            auto match = std::find_if(stack.rbegin(), stack.rend(),
+                                      [c](const Open& open) { return closerOf(open.bracket) == c; });
+            if (match == stack.rend()) {
+                out.push_back({i, i + 1, DiagnosticSeverity::Error, std::string("Unmatched '") + c + "'"});
+                continue;
+            }
+            // Whatever opened inside the match and was never closed.
+            for (auto open = stack.rbegin(); open != match; ++open) {
+                out.push_back({open->offset, open->offset + 1, DiagnosticSeverity::Error,
+                               std::string("'") + open->bracket + "' is not closed before '" + c + "'"});
+            }
+            stack.erase(std::prev(match.base()), stack.end());
+        }
+    }
+    for (const Open& open : stack) {
+        out.push_back({open.offset, open.offset + 1, DiagnosticSeverity::Error,
+                       std::string("Unclosed '") + open.bracket + "'"});
+    }
+}
+
+void checkLines(std::string_view text, size_t maxLineLength, std::vector<Diagnostic>& out) {
+    size_t lineStart = 0;
+    while (lineStart <= text.size()) {
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = text.size();
+        }
+        size_t contentEnd = lineEnd;
+        if (contentEnd > lineStart && text[contentEnd - 1] == '\r') {
+            --contentEnd;  // CRLF is not trailing whitespace
+        }
+        size_t trimmed = contentEnd;
+        while (trimmed > lineStart && (text[trimmed - 1] == ' ' || text[trimmed - 1] == '\t')) {
+            --trimmed;
+        }
+        if (trimmed < contentEnd) {
+            out.push_back({trimmed, contentEnd, DiagnosticSeverity::Note, "Trailing whitespace"});
+        }
+
+        size_t characters = 0;
+        size_t overflow = contentEnd;
+        for (size_t i = lineStart; i < contentEnd; ++i) {
+            if ((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80 && ++characters == maxLineLength + 1) {
+                overflow = i;
+            }
+        }
+        if (characters > maxLineLength) {
+            out.push_back({overflow, contentEnd, DiagnosticSeverity::Warning,
+                           "Line is " + std::to_string(characters) + " characters long (limit "
+                               + std::to_string(maxLineLength) + ")"});
+        }
+        lineStart = lineEnd + 1;
+    }
+}
+
+struct ProcessResult {
+    std::string output;  ///< stdout and stderr, interleaved.
+    bool completed = false;
+};
+
+// The tool runs in a process group of its own, so killing the group also
+// ends what it started (a compiler driver's cc1, a shell's commands) and
+// nothing is left holding the output pipe. @p track is called with the
+// group once it is started and again, with running false, before it is
+// reaped.
+ProcessResult runProcess(const std::vector<std::string>& argv, std::string_view input, bool pipeInput,
+                         std::chrono::milliseconds timeout, const std::function<void(pid_t, bool)>& track) {
+    ProcessResult result;
+    int inPipe[2] = {-1, -1};
+    int outPipe[2] = {-1, -1};
+    if ((pipeInput && ::pipe2(inPipe, O_CLOEXEC) != 0) || ::pipe2(outPipe, O_CLOEXEC) != 0) {
+        std::string message = std::string("pipe failed: ") + std::strerror(errno);
+        for (int fd : inPipe) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        throw std::runtime_error(message);
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (pipeInput) {
+        posix_spawn_file_actions_adddup2(&actions, inPipe[0], STDIN_FILENO);
+    } else {
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    }
+    posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDERR_FILENO);
+
+    std::vector<char*> args;
+    for (const std::string& arg : argv) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    pid_t pid = -1;
+    int spawned = ::posix_spawnp(&pid, args[0], &actions, &attributes, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    if (pipeInput) {
+        ::close(inPipe[0]);
+    }
+    ::close(outPipe[1]);
+    if (spawned != 0) {
+        if (pipeInput) {
+            ::close(inPipe[1]);
+        }
+        ::close(outPipe[0]);
+        throw std::runtime_error("Cannot run " + argv[0] + ": " + std::strerror(spawned));
+    }
+    track(pid, true);
+
+    int writeFd = pipeInput ? inPipe[1] : -1;
+    if (writeFd >= 0) {
+        ::fcntl(writeFd, F_SETFL, ::fcntl(writeFd, F_GETFL) | O_NONBLOCK);
+    }
+    // A tool that exits early must not kill the editor with SIGPIPE.
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t written = 0;
+    char chunk[16384];
+    bool outputOpen = true;
+    while (outputOpen) {
+        auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) {
+            break;
+        }
+        pollfd fds[2] = {{outPipe[0], POLLIN, 0}, {writeFd, POLLOUT, 0}};
+        int ready = ::poll(fds, writeFd >= 0 ? 2 : 1, static_cast<int>(remaining.count()));
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        if (writeFd >= 0 && (fds[1].revents & (POLLOUT | POLLERR | POLLHUP))) {
+            ssize_t n = ::write(writeFd, input.data() + written, input.size() - written);
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+            }
+            if ((n < 0 && errno != EAGAIN && errno != EINTR) || written == input.size()) {
+                ::close(writeFd);  // EOF for the tool
+                writeFd = -1;
+            }
+        }
+        if (fds[0].revents & (POLLIN | POLLERR | POLLHUP)) {
+            ssize_t n = ::read(outPipe[0], chunk, sizeof(chunk));
+            if (n > 0) {
+                result.output.append(chunk, static_cast<size_t>(n));
+            } else if (n == 0 || errno != EINTR) {
+                outputOpen = false;
+            }
+        }
+    }
+    if (writeFd >= 0) {
+        ::close(writeFd);
+    }
+    ::close(outPipe[0]);
+
+    result.completed = !outputOpen;
+    track(pid, false);
+    ::kill(-pid, SIGKILL);  // Timed out, or whatever the tool left running
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    // Drop a SIGPIPE raised by our writes before unblocking it.
+    timespec zero{0, 0};
+    while (sigtimedwait(&blocked, nullptr, &zero) > 0) {
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    return result;
+}
+
+} // namespace
+
+const char* diagnosticSeverityName(DiagnosticSeverity severity) {
+    switch (severity) {
+    case DiagnosticSeverity::Error: return "error";
+    case DiagnosticSeverity::Warning: return "warning";
+    case DiagnosticSeverity::Note: return "note";
+    }
+    return "unknown";
+}
+
+bool Diagnostic::operator==(const Diagnostic& other) const {
+    return start == other.start && end == other.end && severity == other.severity && message == other.message;
+}
+
+bool Diagnostic::operator<(const Diagnostic& other) const {
+    return std::tie(start, end, severity, message) < std::tie(other.start, other.end, other.severity, other.message);
+}
+
+std::vector<Diagnostic> LintProvider::analyze(const std::string& path, std::string_view text) {
+    std::vector<Diagnostic> diagnostics;
+    CommentStyle style = commentStyleOf(path);
+    if (style != CommentStyle::None) {
+        checkBrackets(text, style, diagnostics);
+    }
+    checkLines(text, maxLineLength, diagnostics);
+    return diagnostics;
+}
+
+CommandProvider::CommandProvider(std::vector<std::string> command, std::vector<std::string> extensions,
+                                 std::chrono::milliseconds timeout)
+    : command(std::move(command)), extensions(std::move(extensions)), timeout(timeout) {
+    if (this->command.empty()) {
+        throw std::invalid_argument("CommandProvider: empty command");
+    }
+}
+
+std::vector<Diagnostic> CommandProvider::analyze(const std::string& path, std::string_view text) {
+    if (!extensions.empty() && std::find(extensions.begin(), extensions.end(), extensionOf(path)) == extensions.end()) {
+        return {};
+    }
+    {
+        std::lock_guard<std::mutex> lock(childMutex);
+        if (stopped) {
+            return {};
+        }
+    }
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    if (directory.empty()) {
+        directory = ".";
+    }
+
+    // The snapshot goes to a private temporary file only if the tool wants
+    // a file name.
+    std::string file;
+    std::vector<std::string> argv = command;
+    for (std::string& arg : argv) {
+        for (size_t at = arg.find("{dir}"); at != std::string::npos; at = arg.find("{dir}", at + directory.size())) {
+            arg.replace(at, 5, directory);
+        }
+        size_t at = arg.find("{file}");
+        if (at == std::string::npos) {
+            continue;
+        }
+        if (file.empty()) {
+            std::string extension = extensionOf(path);
+            std::string pattern =
+                (std::filesystem::temp_directory_path() / "snsupear-diag-XXXXXX").string() + extension;
+            int fd = ::mkstemps(pattern.data(), static_cast<int>(extension.size()));
+            if (fd < 0) {
+                throw std::runtime_error(std::string("Cannot create snapshot file: ") + std::strerror(errno));
+            }
+            bool ok = ::write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+            ::close(fd);
+            file = pattern;
+            if (!ok) {
+                ::unlink(file.c_str());
+                throw std::runtime_error("Cannot write snapshot file " + file);
+            }
+        }
+        arg.replace(at, 6, file);
+    }
+
+    // A group is only killed by stop() while tracked, that is before its
+    // leader is reaped, so its id cannot have been reused yet.
+    auto track = [this](pid_t group, bool running) {
+        std::lock_guard<std::mutex> lock(childMutex);
+        if (!running) {
+            children.erase(group);
+            return;
+        }
+        children.insert(group);
+        if (stopped) {
+            ::kill(-group, SIGKILL);  // Started as stop() ran
+        }
+    };
+    ProcessResult result;
+    try {
+        result = runProcess(argv, text, file.empty(), timeout, track);
+    } catch (...) {
+        if (!file.empty()) {
+            ::unlink(file.c_str());
+        }
+        throw;
+    }
+    if (!file.empty()) {
+        ::unlink(file.c_str());
+    }
+    bool cutShort = !result.completed;
+    {
+        std::lock_guard<std::mutex> lock(childMutex);
+        cutShort = cutShort || stopped;
+    }
+    if (cutShort) {
+        return {};  // Timed out or stopped; partial output may describe half a file
+    }
+    return parseOutput(result.output, text, file.empty() ? "<stdin>" : file);
+}
+
+void CommandProvider::stop() {
+    std::lock_guard<std::mutex> lock(childMutex);
+    stopped = true;
+    for (pid_t group : children) {
+        ::kill(-group, SIGKILL);
+    }
+}
+
+std::vector<Diagnostic> CommandProvider::parseOutput(std::string_view output, std::string_view text,
+                                                     const std::string& file) {
+    std::vector<size_t> lineStarts{0};
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\n') {
+            lineStarts.push_back(i + 1);
+        }
+    }
+
+    std::vector<Diagnostic> diagnostics;
+    const std::string prefix = file + ":";
+    size_t pos = 0;
+    while (pos < output.size()) {
+        size_t end = output.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = output.size();
+        }
+        std::string_view line = output.substr(pos, end - pos);
+        pos = end + 1;
+        if (line.substr(0, prefix.size()) != prefix) {
+            continue;
+        }
+
+        // <line>:<column>: <severity>: <message>
+        std::string rest(line.substr(prefix.size()));
+        char* cursor = rest.data();
+        unsigned long lineNumber = std::strtoul(cursor, &cursor, 10);
+        if (*cursor != ':') {
+            continue;
+        }
+        unsigned long column = std::strtoul(cursor + 1, &cursor, 10);
+        if (*cursor != ':' || lineNumber == 0 || lineNumber > lineStarts.size()) {
+            continue;
+        }
+        std::string_view tail(cursor + 1);
+        while (!tail.empty() && tail.front() == ' ') {
+            tail.remove_prefix(1);
+        }
+        static const std::pair<const char*, DiagnosticSeverity> severities[] = {
+            {"fatal error: ", DiagnosticSeverity::Error},
+            {"error: ", DiagnosticSeverity::Error},
+            {"warning: ", DiagnosticSeverity::Warning},
+            {"note: ", DiagnosticSeverity::Note},
+        };
+        const auto* severity = std::find_if(std::begin(severities), std::end(severities), [tail](const auto& entry) {
+            return tail.substr(0, std::strlen(entry.first)) == entry.first;
+        });
+        if (severity == std::end(severities)) {
+            continue;
+        }
+        tail.remove_prefix(std::strlen(severity->first));
+
+        const size_t lineStart = lineStarts[lineNumber - 1];
+        size_t lineEnd = text.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = text.size();
+        }
+        size_t start = std::min(lineStart + (column > 0 ? column - 1 : 0), lineEnd);
+        size_t stop = start;
+        while (stop < lineEnd && isIdentifierByte(text[stop])) {
+            ++stop;
+        }
+        if (stop == start && start < lineEnd) {
+            ++stop;
+        }
+        diagnostics.push_back({start, stop, severity->second, std::string(tail)});
+    }
+    return diagnostics;
+}
+
+DiagnosticsService::DiagnosticsService(std::vector<std::shared_ptr<DiagnosticProvider>> providers,
+                                       ResultCallback onResults, size_t threadCount)
+    : providers(std::move(providers)), onResults(std::move(onResults)) {
+    for (size_t i = 0; i < std::max<size_t>(threadCount, 1); ++i) {
+        workers.emplace_back(&DiagnosticsService::workerLoop, this);
+    }
+}
+
+DiagnosticsService::~DiagnosticsService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (const std::shared_ptr<DiagnosticProvider>& provider : providers) {
+        provider->stop();
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void DiagnosticsService::submit(uint64_t document, const std::string& path, uint64_t revision,
+                                std::shared_ptr<const std::string> text) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto [it, inserted] = waiting.insert_or_assign(document, Job{path, revision, std::move(text)});
+        if (inserted) {
+            order.push_back(document);
+        }
+    }
+    wake.notify_one();
+}
+
+void DiagnosticsService::cancel(uint64_t document) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (waiting.erase(document) > 0) {
+        order.erase(std::find(order.begin(), order.end(), document));
+    }
+    if (running.count(document)) {
+        cancelled.insert(document);
+    }
+    if (waiting.empty() && running.empty()) {
+        idle.notify_all();
+    }
+}
+
+void DiagnosticsService::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return waiting.empty() && running.empty(); });
+}
+
+void DiagnosticsService::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        auto runnable = order.end();
+        wake.wait(lock, [this, &runnable] {
+            runnable = std::find_if(order.begin(), order.end(),
+                                    [this](uint64_t document) { return running.count(document) == 0; });
+            return stopping || runnable != order.end();
+        });
+        if (stopping) {
+            return;
+        }
+        const uint64_t document = *runnable;
+        order.erase(runnable);
+        auto job = waiting.extract(document);
+        running.insert(document);
+        lock.unlock();
+
+        std::vector<Diagnostic> diagnostics;
+        for (const std::shared_ptr<DiagnosticProvider>& provider : providers) {
+            try {
+                std::vector<Diagnostic> found = provider->analyze(job.mapped().path, *job.mapped().text);
+                diagnostics.insert(diagnostics.end(), std::make_move_iterator(found.begin()),
+                                   std::make_move_iterator(found.end()));
+            } catch (const std::exception&) {
+                // A missing or failing tool contributes nothing.
+            }
+        }
+        std::sort(diagnostics.begin(), diagnostics.end());
+        diagnostics.erase(std::unique(diagnostics.begin(), diagnostics.end()), diagnostics.end());
+        if (diagnostics.size() > kMaxDiagnostics) {
+            diagnostics.resize(kMaxDiagnostics);
+        }
+
+        lock.lock();
+        if (cancelled.erase(document) == 0 && !stopping) {
+            lock.unlock();
+            onResults(document, job.mapped().revision, std::move(diagnostics));
+            lock.lock();
+        }
+        running.erase(document);
+        if (waiting.empty() && running.empty()) {
+            idle.notify_all();
+        }
+        wake.notify_all();  // The document's next snapshot may be waiting
+    }
+}
+
+DocumentDiagnostics::DocumentDiagnostics(std::chrono::milliseconds debounce)
+    : debounce(debounce), lastEdit(std::chrono::steady_clock::now()) {}
+
+void DocumentDiagnostics::applyEdits(const std::vector<TextEdit>& edits, std::vector<ByteRange>& damaged) {
+    if (edits.empty()) {
+        return;
+    }
+    ++current;
+    lastEdit = std::chrono::steady_clock::now();
+    if (!inFlight.empty()) {
+        log.push_back({current, edits});
+    }
+    scratch.clear();
+    mapThrough(shown, edits, &scratch);
+    for (const Diagnostic& dropped : scratch) {
+        damaged.push_back({dropped.start, dropped.end});
+    }
+}
+
+uint64_t DocumentDiagnostics::snapshotTaken() {
+    snapshotRevision = current;
+    if (inFlight.empty() || inFlight.back() != current) {
+        inFlight.push_back(current);
+    }
+    return current;
+}
+
+bool DocumentDiagnostics::accept(uint64_t revision, std::vector<Diagnostic> diagnostics,
+                                 std::vector<ByteRange>& damaged) {
+    if (revision < shownRevision) {
+        return false;
+    }
+    while (!inFlight.empty() && inFlight.front() <= revision) {
+        inFlight.pop_front();
+    }
+    std::sort(diagnostics.begin(), diagnostics.end());
+    for (const Batch& batch : log) {
+        if (batch.revision > revision) {
+            mapThrough(diagnostics, batch.edits, nullptr);
+        }
+    }
+    while (!log.empty() && (inFlight.empty() || log.front().revision <= inFlight.front())) {
+        log.pop_front();
+    }
+    shownRevision = revision;
+
+    scratch.clear();
+    std::set_symmetric_difference(shown.begin(), shown.end(), diagnostics.begin(), diagnostics.end(),
+                                  std::back_inserter(scratch));
+    for (const Diagnostic& changed : scratch) {
+        damaged.push_back({changed.start, changed.end});
+    }
+    shown = std::move(diagnostics);
+    return true;
+}
+
+void DocumentDiagnostics::reset(std::vector<ByteRange>& damaged) {
+    for (const Diagnostic& diagnostic : shown) {
+        damaged.push_back({diagnostic.start, diagnostic.end});
+    }
+    shown.clear();
+    log.clear();
+    inFlight.clear();
+    snapshotRevision = current;
+    shownRevision = current;
+}
+
+void DocumentDiagnostics::overlapping(size_t start, size_t end, std::vector<const Diagnostic*>& out) const {
+    for (const Diagnostic& diagnostic : shown) {
+        if (diagnostic.start >= end && !(diagnostic.start == end && diagnostic.start == start)) {
+            break;  // Sorted by start
+        }
+        if (diagnostic.end > start || (diagnostic.start == diagnostic.end && diagnostic.start >= start)) {
+            out.push_back(&diagnostic);
+        }
+    }
+}
+
+void DocumentDiagnostics::mapThrough(std::vector<Diagnostic>& diagnostics, const std::vector<TextEdit>& edits,
+                                     std::vector<Diagnostic>* dropped) {
+    auto kept = diagnostics.begin();
+    for (Diagnostic& diagnostic : diagnostics) {
+        // Edits are sorted; those wholly before the diagnostic (including
+        // an insertion at its start) move it, one that overlaps it, or
+        // inserts inside it, touches it.
+        size_t before = 0;
+        size_t removedBefore = 0;
+        size_t insertedUpToEnd = 0;
+        bool touched = false;
+        for (const TextEdit& edit : edits) {
+            if (edit.end <= diagnostic.start) {
+                before += edit.replacement.size();
+                removedBefore += edit.end - edit.start;
+            } else if (edit.start >= diagnostic.end) {
+                break;  // This and every later edit come after it
+            } else {
+                touched = true;
+            }
+            insertedUpToEnd += edit.replacement.size();
+        }
+        if (!touched) {
+            diagnostic.start = diagnostic.start + before - removedBefore;
+            diagnostic.end = diagnostic.end + before - removedBefore;
+            if (&*kept != &diagnostic) {
+                *kept = std::move(diagnostic);
+            }
+            ++kept;
+        } else if (dropped) {
+            // Where it was, in the new text, generously: the views repaint it.
+            Diagnostic moved = std::move(diagnostic);
+            moved.start = moved.start + before - removedBefore;
+            moved.end = std::max(moved.start, moved.end + insertedUpToEnd - removedBefore);
+            dropped->push_back(std::move(moved));
+        }
+    }
+    diagnostics.erase(kept, diagnostics.end());
+}
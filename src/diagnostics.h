@@ -0,0 +1,270 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "text_buffer.h"
+
+enum class DiagnosticSeverity : uint8_t { Error, Warning, Note };
+
+const char* diagnosticSeverityName(DiagnosticSeverity severity);
+
+struct Diagnostic {
+    size_t start = 0;  ///< Byte offsets in the text analysed, or in the
+    size_t end = 0;    ///< current text once mapped by DocumentDiagnostics.
+    DiagnosticSeverity severity = DiagnosticSeverity::Error;
+    std::string message;
+
+    bool operator==(const Diagnostic& other) const;
+    bool operator<(const Diagnostic& other) const;  ///< By position first.
+};
+
+struct ByteRange {
+    size_t start;
+    size_t end;
+};
+
+/**
+ * @brief Something that checks a snapshot of a document.
+ *
+ * analyze() runs on a DiagnosticsService worker and may be called
+ * concurrently for different documents.
+ */
+class DiagnosticProvider {
+public:
+    virtual ~DiagnosticProvider() = default;
+
+    /**
+     * @param path The document's file, for tools that care about its
+     * directory or extension; the text need not match what is on disk.
+     */
+    virtual std::vector<Diagnostic> analyze(const std::string& path, std::string_view text) = 0;
+
+    /**
+     * @brief Ends analyze() calls in progress on other threads as soon as
+     * possible, for shutdown; later calls may return nothing.
+     */
+    virtual void stop() {}
+};
+
+/**
+ * @brief Built-in checks that need no external tool: unbalanced brackets
+ * (outside C-style strings and comments), trailing whitespace and long
+ * lines. Stands in for a language server where none is installed.
+ */
+class LintProvider : public DiagnosticProvider {
+public:
+    explicit LintProvider(size_t maxLineLength = 120) : maxLineLength(maxLineLength) {}
+
+    std::vector<Diagnostic> analyze(const std::string& path, std::string_view text) override;
+
+private:
+    size_t maxLineLength;
+};
+
+/**
+ * @brief Runs a compiler or linter as a child process on each snapshot.
+ *
+ * In the command, "{dir}" is replaced by the document's directory and
+ * "{file}" by a temporary copy of the snapshot with the document's
+ * extension; without "{file}" the snapshot is piped to stdin. Either way
+ * the snapshot is not in the document's directory, so a C or C++ tool
+ * needs "-iquote {dir}" to find the document's own quoted includes. Output lines
+ * of the form "<file>:<line>:<column>: <severity>: <message>" about the
+ * snapshot ("<stdin>" or the temporary file) become diagnostics, as clang,
+ * clang-tidy and gcc print them. A run longer than the timeout is killed,
+ * with any processes it started, as are runs in progress on stop().
+ * Documents whose extension is not listed are skipped; an empty list runs
+ * the command on every document.
+ */
+class CommandProvider : public DiagnosticProvider {
+public:
+    explicit CommandProvider(std::vector<std::string> command, std::vector<std::string> extensions = {},
+                             std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+    std::vector<Diagnostic> analyze(const std::string& path, std::string_view text) override;
+
+    /**
+     * @brief Diagnostics in @p output that refer to @p file, positioned in
+     * @p text; each spans the identifier at its column, or one byte.
+     */
+    static std::vector<Diagnostic> parseOutput(std::string_view output, std::string_view text,
+                                               const std::string& file);
+
+    void stop() override;
+
+private:
+    std::vector<std::string> command;
+    std::vector<std::string> extensions;  ///< Lower case, with the dot.
+    std::chrono::milliseconds timeout;
+
+    std::mutex childMutex;
+    std::set<pid_t> children;  ///< Process groups of the runs in progress.
+    bool stopped = false;
+};
+
+/**
+ * @brief Runs providers on immutable snapshots on worker threads.
+ *
+ * Snapshots are queued per document: a snapshot still waiting is replaced
+ * by a newer one of the same document, and a document is never analysed by
+ * two workers at once, so its results arrive in revision order. Results are
+ * passed to the callback on the worker thread; a UI should marshal them to
+ * its own thread.
+ */
+class DiagnosticsService {
+public:
+    using ResultCallback =
+        std::function<void(uint64_t document, uint64_t revision, std::vector<Diagnostic> diagnostics)>;
+
+    DiagnosticsService(std::vector<std::shared_ptr<DiagnosticProvider>> providers, ResultCallback onResults,
+                       size_t threadCount = 1);
+
+    /**
+     * @brief Stops the providers, so a tool still running is killed rather
+     * than waited for, and joins the workers. Runs in progress report no
+     * results.
+     */
+    ~DiagnosticsService();
+
+    DiagnosticsService(const DiagnosticsService&) = delete;
+    DiagnosticsService& operator=(const DiagnosticsService&) = delete;
+
+    /**
+     * @brief Queues a snapshot of @p document at @p revision.
+     */
+    void submit(uint64_t document, const std::string& path, uint64_t revision,
+                std::shared_ptr<const std::string> text);
+
+    /**
+     * @brief Drops the document's waiting snapshot; results of a run in
+     * progress are discarded.
+     */
+    void cancel(uint64_t document);
+
+    /**
+     * @brief Blocks until nothing is queued or running.
+     */
+    void waitIdle();
+
+private:
+    struct Job {
+        std::string path;
+        uint64_t revision = 0;
+        std::shared_ptr<const std::string> text;
+    };
+
+    void workerLoop();
+
+    std::vector<std::shared_ptr<DiagnosticProvider>> providers;
+    ResultCallback onResults;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::map<uint64_t, Job> waiting;
+    std::deque<uint64_t> order;        ///< Documents in waiting, oldest first.
+    std::set<uint64_t> running;
+    std::set<uint64_t> cancelled;      ///< Running documents whose results go.
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+/**
+ * @brief Diagnostics of one document, kept on its current revision.
+ *
+ * Every edit batch the document gets is applied here too: diagnostics the
+ * batch touches are dropped (the next analysis decides about them), the
+ * rest move with the text. Batches since the oldest snapshot still being
+ * analysed are logged, so results for an older revision are mapped through
+ * the edits made since before they are shown. Both steps report the byte
+ * ranges whose diagnostics changed, which is all a view needs to repaint.
+ *
+ * Analysis is debounced: dueAt() is the quiet period after the latest edit.
+ */
+class DocumentDiagnostics {
+public:
+    explicit DocumentDiagnostics(std::chrono::milliseconds debounce = std::chrono::milliseconds(300));
+
+    uint64_t revision() const { return current; }
+
+    /**
+     * @brief Applies an edit batch, in offsets of the text before it.
+     * @param damaged Receives ranges, in offsets after it, whose
+     * diagnostics changed.
+     */
+    void applyEdits(const std::vector<TextEdit>& edits, std::vector<ByteRange>& damaged);
+
+    /**
+     * @brief Whether there are edits no snapshot has been taken of.
+     */
+    bool hasUnanalysedEdits() const { return snapshotRevision != current; }
+
+    std::chrono::steady_clock::time_point dueAt() const { return lastEdit + debounce; }
+
+    /**
+     * @brief Notes that a snapshot of the current revision was submitted.
+     * @return The revision.
+     */
+    uint64_t snapshotTaken();
+
+    /**
+     * @brief Shows results for @p revision, mapped to the current one.
+     * Results older than those shown are ignored.
+     * @param damaged Receives ranges whose diagnostics changed.
+     * @return False if the results were ignored.
+     */
+    bool accept(uint64_t revision, std::vector<Diagnostic> diagnostics, std::vector<ByteRange>& damaged);
+
+    /**
+     * @brief Forgets all diagnostics and history, as for a new document.
+     */
+    void reset(std::vector<ByteRange>& damaged);
+
+    /**
+     * @brief Shown diagnostics, sorted by position.
+     */
+    const std::vector<Diagnostic>& diagnostics() const { return shown; }
+
+    /**
+     * @brief Shown diagnostics overlapping [start, end); an empty
+     * diagnostic at @p start counts.
+     */
+    void overlapping(size_t start, size_t end, std::vector<const Diagnostic*>& out) const;
+
+private:
+    struct Batch {
+        uint64_t revision;  ///< Revision the batch produced.
+        std::vector<TextEdit> edits;
+    };
+
+    /**
+     * @brief Maps @p diagnostics through @p edits; those touched go to
+     * @p dropped.
+     */
+    static void mapThrough(std::vector<Diagnostic>& diagnostics, const std::vector<TextEdit>& edits,
+                           std::vector<Diagnostic>* dropped);
+
+    std::chrono::milliseconds debounce;
+    std::chrono::steady_clock::time_point lastEdit;
+    uint64_t current = 0;
+    uint64_t snapshotRevision = 0;
+    uint64_t shownRevision = 0;
+    std::deque<uint64_t> inFlight;  ///< Snapshot revisions awaiting results.
+    std::deque<Batch> log;          ///< Batches after inFlight.front().
+    std::vector<Diagnostic> shown;
+    std::vector<Diagnostic> scratch;
+};
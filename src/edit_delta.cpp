@@ -0,0 +1,49 @@
+#include "edit_delta.h"
+
+#include <algorithm>
+
+#include "varint.h"
+
+std::string encodeEditDelta(const std::vector<TextEdit>& edits) {
+    std::string out;
+    out.reserve(editDeltaSize(edits));
+    appendEditDelta(out, edits);
+    return out;
+}
+
+void appendEditDelta(std::string& out, const std::vector<TextEdit>& edits) {
+    appendVarint(out, edits.size());
+    for (const TextEdit& edit : edits) {
+        appendVarint(out, edit.start);
+        appendVarint(out, edit.end);
+        appendVarint(out, edit.replacement.size());
+        out += edit.replacement;
+    }
+}
+
+size_t editDeltaSize(const std::vector<TextEdit>& edits) {
+    size_t size = varintSize(edits.size());
+    for (const TextEdit& edit : edits) {
+        size += varintSize(edit.start) + varintSize(edit.end) + varintSize(edit.replacement.size())
+                + edit.replacement.size();
+    }
+    return size;
+}
+
+std::vector<TextEdit> decodeEditDelta(std::string_view data) {
+    size_t pos = 0;
+    uint64_t count = readVarint(data, pos);
+    std::vector<TextEdit> edits;
+    edits.reserve(static_cast<size_t>(std::min<uint64_t>(count, data.size())));
+    for (uint64_t i = 0; i < count; ++i) {
+        TextEdit edit;
+        edit.start = static_cast<size_t>(readVarint(data, pos));
+        edit.end = static_cast<size_t>(readVarint(data, pos));
+        edit.replacement = std::string(readBytes(data, pos, static_cast<size_t>(readVarint(data, pos))));
+        edits.push_back(std::move(edit));
+    }
+    if (pos != data.size()) {
+        throw std::invalid_argument("trailing bytes after edit delta");
+    }
+    return edits;
+}
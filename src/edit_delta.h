@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_buffer.h"
+
+/**
+ * @brief Encodes a batch of edits as a compact binary delta.
+ *
+ * Layout: varint edit count, then per edit varint start, varint end,
+ * varint replacement length and the replacement bytes. Offsets refer to the
+ * text before the delta; edits are sorted and disjoint, exactly as
+ * TextBuffer::applyEdits expects.
+ */
+std::string encodeEditDelta(const std::vector<TextEdit>& edits);
+
+/**
+ * @brief Appends the encodeEditDelta() bytes of @p edits to @p out, so a
+ * caller reusing @p out allocates only when it grows.
+ */
+void appendEditDelta(std::string& out, const std::vector<TextEdit>& edits);
+
+/**
+ * @brief Size in bytes of encodeEditDelta(@p edits).
+ */
+size_t editDeltaSize(const std::vector<TextEdit>& edits);
+
+/**
+ * @brief Decodes encodeEditDelta() output; throws std::invalid_argument on
+ * malformed input.
+ */
+std::vector<TextEdit> decodeEditDelta(std::string_view data);
@@ -0,0 +1,454 @@
+#include "edit_journal.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "edit_delta.h"
+#include "varint.h"
+
+namespace {
+
+constexpr char kCheckpointMagic[4] = {'S', 'N', 'C', 'P'};
+constexpr char kJournalMagic[4] = {'S', 'N', 'J', 'L'};
+constexpr uint64_t kVersion = 1;
+constexpr size_t kSpareLimit = 1 << 20;  // Larger group buffers (pastes) are freed
+
+// CRC-32 (IEEE 802.3, reflected), as zlib computes it.
+const std::array<uint32_t, 256>& crcTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    return table;
+}
+
+uint32_t crc32(std::string_view data) {
+    const std::array<uint32_t, 256>& table = crcTable();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (char c : data) {
+        crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void appendU32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+uint32_t readU32(std::string_view in, size_t& pos) {
+    std::string_view bytes = readBytes(in, pos, 4);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+void writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("journal write failed: ") + std::strerror(errno));
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+int createFile(const std::string& path, int extraFlags) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | extraFlags, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create " + path + ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+// Makes a rename in @p directory durable.
+void syncDirectory(const std::string& directory) {
+    int fd = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+bool readFile(const std::string& path, std::string& data) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+} // namespace
+
+EditJournal::EditJournal(const EditJournalOptions& options) : options(options) {
+    // Generations continue from the clock, not 1, so a journal left by an
+    // earlier session can never match this session's checkpoints.
+    generation = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                           std::chrono::system_clock::now().time_since_epoch())
+                                           .count());
+    writer = std::thread(&EditJournal::writerLoop, this);
+}
+
+EditJournal::EditJournal(const std::string& directory, std::string text, bool saved,
+                         const EditJournalOptions& options)
+    : EditJournal(options) {
+    open(directory, std::move(text), saved);
+}
+
+EditJournal::~EditJournal() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    writer.join();
+    if (journalFd >= 0) {
+        ::close(journalFd);
+    }
+}
+
+void EditJournal::open(const std::string& directory, std::string text, bool saved) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Even the first snapshot is written by the writer thread.
+        error.clear();
+        checkpointSize = text.size();
+        journalBytes = 0;
+        journalBatches = 0;
+        queue.push_back({OpKind::Open, std::move(text), 0, saved, directory});
+        ++queuedOps;
+    }
+    wake.notify_one();
+}
+
+void EditJournal::close(bool removeFiles) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Op op{OpKind::Close, std::string(), 0, false, std::string()};
+        op.removeFiles = removeFiles;
+        queue.push_back(std::move(op));
+        ++queuedOps;
+    }
+    wake.notify_one();
+}
+
+void EditJournal::remove(const std::string& directory) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({OpKind::Remove, std::string(), 0, false, directory});
+        ++queuedOps;
+    }
+    wake.notify_one();
+}
+
+void EditJournal::append(const std::vector<TextEdit>& edits) {
+    if (edits.empty()) {
+        return;
+    }
+    const size_t size = editDeltaSize(edits);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.empty() || queue.back().kind != OpKind::Edits) {
+            // The writer hands back the buffer of the group it committed.
+            queue.push_back({OpKind::Edits, std::move(spare), 0, false, std::string()});
+            spare.clear();
+        }
+        Op& op = queue.back();
+        appendVarint(op.data, size);
+        appendEditDelta(op.data, edits);
+        ++op.batches;
+        journalBytes += size;
+        ++journalBatches;
+        ++queuedOps;
+    }
+    wake.notify_one();
+}
+
+bool EditJournal::wantsCheckpoint() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return journalBytes > std::max(options.checkpointBytes, checkpointSize)
+           || journalBatches > options.checkpointBatches;
+}
+
+void EditJournal::checkpoint(std::string text, bool saved) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Edits still queued are committed before the snapshot: until it is
+        // durable, recovery goes through the old journal.
+        checkpointSize = text.size();
+        journalBytes = 0;
+        journalBatches = 0;
+        queue.push_back({OpKind::Checkpoint, std::move(text), 0, saved, std::string()});
+        ++queuedOps;
+    }
+    wake.notify_one();
+}
+
+void EditJournal::sync() {
+    std::unique_lock<std::mutex> lock(mutex);
+    const uint64_t target = queuedOps;
+    syncRequested = true;
+    wake.notify_one();
+    committed.wait(lock, [this, target] { return durableOps >= target; });
+}
+
+std::string EditJournal::lastError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
+
+void EditJournal::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        // Let the edits of a burst of typing share one commit.
+        wake.wait_for(lock, options.commitDelay, [this] { return stopping || syncRequested; });
+
+        std::deque<Op> batch;
+        batch.swap(queue);
+        const uint64_t target = queuedOps;
+        const bool finalPass = stopping;
+        syncRequested = false;
+        lock.unlock();
+
+        for (Op& op : batch) {
+            try {
+                switch (op.kind) {
+                case OpKind::Edits:
+                    writeEdits(op);
+                    break;
+                case OpKind::Checkpoint:
+                    syncEdits();
+                    writeCheckpoint(op);
+                    break;
+                case OpKind::Open:
+                    closeJournal(false);
+                    openJournal(op);
+                    break;
+                case OpKind::Close:
+                    closeJournal(op.removeFiles);
+                    break;
+                case OpKind::Remove:
+                    if (op.directory != directory) {
+                        std::error_code ec;
+                        std::filesystem::remove_all(op.directory, ec);
+                    }
+                    break;
+                }
+            } catch (const std::exception& e) {
+                fail(e.what());
+            }
+        }
+        syncEdits();
+
+        lock.lock();
+        for (Op& op : batch) {
+            if (op.kind == OpKind::Edits && op.data.capacity() > spare.capacity()
+                && op.data.capacity() <= kSpareLimit) {
+                op.data.clear();
+                spare = std::move(op.data);
+            }
+        }
+        durableOps = target;
+        committed.notify_all();
+        if (finalPass && queue.empty()) {
+            return;
+        }
+    }
+}
+
+void EditJournal::syncEdits() {
+    if (editsUnsynced && journalFd >= 0 && ::fdatasync(journalFd) != 0) {
+        fail(std::string("journal fdatasync failed: ") + std::strerror(errno));
+    }
+    editsUnsynced = false;
+}
+
+void EditJournal::openJournal(const Op& op) {
+    std::error_code ec;
+    std::filesystem::create_directories(op.directory, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create journal directory " + op.directory + ": " + ec.message());
+    }
+    directory = op.directory;
+    writeCheckpoint(op);
+}
+
+void EditJournal::closeJournal(bool removeFiles) {
+    syncEdits();
+    if (journalFd >= 0) {
+        ::close(journalFd);
+        journalFd = -1;
+    }
+    if (removeFiles && !directory.empty()) {
+        std::error_code ec;
+        std::filesystem::remove_all(directory, ec);
+    }
+    directory.clear();
+}
+
+void EditJournal::writeEdits(const Op& op) {
+    if (journalFd < 0) {
+        throw std::runtime_error("journal is not open");
+    }
+    // One reused buffer: the length and CRC go in front once the payload
+    // is in place.
+    std::string& record = recordBuffer;
+    record.assign(8, '\0');
+    appendVarint(record, op.batches);
+    record += op.data;
+    std::string header;
+    const std::string_view payload = std::string_view(record).substr(8);
+    appendU32(header, static_cast<uint32_t>(payload.size()));
+    appendU32(header, crc32(payload));
+    record.replace(0, header.size(), header);
+    writeAll(journalFd, record);
+    editsUnsynced = true;
+    if (record.capacity() > kSpareLimit) {
+        record = std::string();
+    }
+}
+
+void EditJournal::writeCheckpoint(const Op& op) {
+    if (directory.empty()) {
+        throw std::runtime_error("journal is not open");
+    }
+    ++generation;
+
+    // Snapshot first: until the new journal replaces the old one, the old
+    // journal's generation no longer matches and recovery ignores it, which
+    // is right because the snapshot already contains its edits.
+    const std::string checkpointPath = directory + "/checkpoint";
+    std::string header(kCheckpointMagic, sizeof(kCheckpointMagic));
+    appendVarint(header, kVersion);
+    appendVarint(header, generation);
+    header.push_back(op.saved ? 1 : 0);
+    appendU32(header, crc32(op.data));
+    appendVarint(header, op.data.size());
+    int fd = createFile(checkpointPath + ".tmp", 0);
+    try {
+        writeAll(fd, header);
+        writeAll(fd, op.data);
+        if (::fsync(fd) != 0) {
+            throw std::runtime_error(std::string("checkpoint fsync failed: ") + std::strerror(errno));
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    if (::rename((checkpointPath + ".tmp").c_str(), checkpointPath.c_str()) != 0) {
+        throw std::runtime_error(std::string("checkpoint rename failed: ") + std::strerror(errno));
+    }
+
+    const std::string journalPath = directory + "/journal";
+    std::string journalHeader(kJournalMagic, sizeof(kJournalMagic));
+    appendVarint(journalHeader, kVersion);
+    appendVarint(journalHeader, generation);
+    int newFd = createFile(journalPath + ".tmp", O_APPEND);
+    try {
+        writeAll(newFd, journalHeader);
+        if (::fsync(newFd) != 0 || ::rename((journalPath + ".tmp").c_str(), journalPath.c_str()) != 0) {
+            throw std::runtime_error(std::string("journal rotation failed: ") + std::strerror(errno));
+        }
+    } catch (...) {
+        ::close(newFd);
+        throw;
+    }
+    syncDirectory(directory);
+    if (journalFd >= 0) {
+        ::close(journalFd);
+    }
+    journalFd = newFd;
+}
+
+void EditJournal::fail(const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = message;
+}
+
+std::optional<JournalRecovery> EditJournal::recover(const std::string& directory) {
+    std::string checkpoint;
+    if (!readFile(directory + "/checkpoint", checkpoint)
+        || checkpoint.compare(0, sizeof(kCheckpointMagic), kCheckpointMagic, sizeof(kCheckpointMagic)) != 0) {
+        return std::nullopt;
+    }
+    uint64_t generation;
+    bool saved;
+    std::string_view text;
+    try {
+        size_t pos = sizeof(kCheckpointMagic);
+        if (readVarint(checkpoint, pos) != kVersion) {
+            return std::nullopt;
+        }
+        generation = readVarint(checkpoint, pos);
+        saved = readBytes(checkpoint, pos, 1)[0] != 0;
+        uint32_t crc = readU32(checkpoint, pos);
+        text = readBytes(checkpoint, pos, static_cast<size_t>(readVarint(checkpoint, pos)));
+        if (crc32(text) != crc) {
+            return std::nullopt;
+        }
+    } catch (const std::invalid_argument&) {
+        return std::nullopt;
+    }
+
+    TextBuffer buffer;
+    buffer.applyExternalEdits({{0, 0, std::string(text)}});
+    checkpoint.clear();
+    checkpoint.shrink_to_fit();
+
+    JournalRecovery recovery;
+    std::string journal;
+    if (readFile(directory + "/journal", journal)
+        && journal.compare(0, sizeof(kJournalMagic), kJournalMagic, sizeof(kJournalMagic)) == 0) {
+        try {
+            size_t pos = sizeof(kJournalMagic);
+            if (readVarint(journal, pos) == kVersion && readVarint(journal, pos) == generation) {
+                // Stops at the first torn or corrupt record: the tail a
+                // crash cut short.
+                while (pos < journal.size()) {
+                    uint32_t length = readU32(journal, pos);
+                    uint32_t crc = readU32(journal, pos);
+                    std::string_view payload = readBytes(journal, pos, length);
+                    if (crc32(payload) != crc) {
+                        break;
+                    }
+                    size_t at = 0;
+                    for (uint64_t batches = readVarint(payload, at); batches > 0; --batches) {
+                        std::string_view delta = readBytes(payload, at, static_cast<size_t>(readVarint(payload, at)));
+                        buffer.applyExternalEdits(decodeEditDelta(delta));
+                        ++recovery.replayedBatches;
+                    }
+                }
+            }
+        } catch (const std::invalid_argument&) {
+            // Truncated or out-of-range record: keep what replayed cleanly.
+        }
+    }
+    recovery.text = buffer.getBuffer();
+    recovery.unsaved = !saved || recovery.replayedBatches > 0;
+    return recovery;
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "text_buffer.h"
+
+struct EditJournalOptions {
+    /// How long the writer waits for more edits before a commit.
+    std::chrono::milliseconds commitDelay{20};
+    /// Journal size past which wantsCheckpoint() asks for compaction,
+    /// unless the checkpoint itself is larger.
+    size_t checkpointBytes = size_t(4) << 20;
+    /// Batches since the checkpoint past which wantsCheckpoint() asks for
+    /// compaction; bounds recovery replay, which costs one
+    /// TextBuffer::applyExternalEdits per batch.
+    size_t checkpointBatches = 10000;
+};
+
+struct JournalRecovery {
+    std::string text;
+    bool unsaved = false;  ///< Differs from the last saved text.
+    size_t replayedBatches = 0;
+};
+
+/**
+ * @brief Crash-recovery write-ahead journal of a document's edits.
+ *
+ * A directory holds two files. "checkpoint" is a snapshot of the text:
+ * "SNCP", varint version, varint generation, a saved flag byte, the text's
+ * CRC-32 (4 bytes, little endian), varint length and the text. "journal"
+ * is "SNJL", varint version, the generation of the checkpoint it extends,
+ * then records of a 4-byte length, a 4-byte CRC-32 of the payload and the
+ * payload: varint batch count, then per batch a varint length and an
+ * edit_delta.h encoded TextBuffer::applyEdits batch.
+ *
+ * append() only encodes the batch into the queued group, reusing the
+ * buffer of the last committed group, and queues it. A writer thread commits
+ * the queue in groups, one record and one fdatasync per group, so the UI
+ * thread never waits for the disk. Once the journal outgrows its
+ * checkpoint or holds enough batches, checkpoint() writes a new snapshot
+ * and starts a fresh journal, both replaced atomically by rename; edits
+ * queued before it are committed to the old journal first, so they
+ * survive a crash before the snapshot is durable. open() and close() are
+ * queued the same way, so one writer serves every document in turn.
+ * Recovery loads the checkpoint and replays the journal up to the first
+ * torn or corrupt record, so it costs the unsaved edits, not the history.
+ */
+class EditJournal {
+public:
+    /**
+     * @brief Starts the writer with no journal open.
+     */
+    explicit EditJournal(const EditJournalOptions& options = EditJournalOptions());
+
+    /**
+     * @brief Starts the writer and open()s @p directory.
+     */
+    EditJournal(const std::string& directory, std::string text, bool saved,
+                const EditJournalOptions& options = EditJournalOptions());
+
+    /**
+     * @brief Commits everything queued and stops the writer.
+     */
+    ~EditJournal();
+
+    EditJournal(const EditJournal&) = delete;
+    EditJournal& operator=(const EditJournal&) = delete;
+
+    /**
+     * @brief Queues switching to a journal in @p directory, created if
+     * missing, whose first checkpoint is @p text; files of an earlier
+     * session there are replaced. The journal open before is closed and
+     * kept. Failures are reported through lastError().
+     * @param saved Whether @p text is what is on disk.
+     */
+    void open(const std::string& directory, std::string text, bool saved);
+
+    /**
+     * @brief Queues committing the open journal and closing it.
+     * @param removeFiles Whether to delete its directory afterwards, when
+     * nothing in it needs recovering.
+     */
+    void close(bool removeFiles);
+
+    /**
+     * @brief Queues deleting a journal closed earlier in @p directory, as
+     * when its unsaved edits are saved or thrown away without reopening
+     * it. The open journal is not affected.
+     */
+    void remove(const std::string& directory);
+
+    /**
+     * @brief Queues a batch, in offsets of the text before it.
+     */
+    void append(const std::vector<TextEdit>& edits);
+
+    /**
+     * @brief Whether enough has been journaled since the last checkpoint
+     * that checkpoint() should be called with the current text.
+     */
+    bool wantsCheckpoint() const;
+
+    /**
+     * @brief Queues a snapshot of the current text; the journal restarts
+     * from it. Call with @p saved after writing the text to its file.
+     */
+    void checkpoint(std::string text, bool saved);
+
+    /**
+     * @brief Blocks until everything queued so far is on disk.
+     */
+    void sync();
+
+    /**
+     * @brief Last write error on the writer thread since open(), empty if
+     * none.
+     */
+    std::string lastError() const;
+
+    /**
+     * @brief Rebuilds the text left in @p directory by a previous session;
+     * nullopt if there is no readable checkpoint.
+     */
+    static std::optional<JournalRecovery> recover(const std::string& directory);
+
+private:
+    enum class OpKind { Edits, Checkpoint, Open, Close, Remove };
+
+    struct Op {
+        OpKind kind;
+        std::string data;  ///< Edits: encoded batches; Checkpoint and Open: the text.
+        size_t batches = 0;
+        bool saved = false;
+        std::string directory;     ///< Open and Remove only.
+        bool removeFiles = false;  ///< Close only.
+    };
+
+    void writerLoop();
+    void writeEdits(const Op& op);
+    void writeCheckpoint(const Op& op);
+    void openJournal(const Op& op);
+    void closeJournal(bool removeFiles);
+    void fail(const std::string& message);
+
+    /**
+     * @brief Makes the edits written since the last call durable.
+     */
+    void syncEdits();
+
+    EditJournalOptions options;
+    std::string directory;       ///< Writer thread only.
+    bool editsUnsynced = false;  ///< Writer thread only.
+    int journalFd = -1;          ///< Writer thread only.
+    uint64_t generation = 0;     ///< Writer thread only.
+    std::string recordBuffer;    ///< Writer thread only.
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable committed;
+    std::deque<Op> queue;
+    std::string spare;           ///< Committed group's buffer, reused by append().
+    uint64_t queuedOps = 0;      ///< Ever queued; ops merge, so this counts appends.
+    uint64_t durableOps = 0;
+    bool syncRequested = false;
+    bool stopping = false;
+    size_t journalBytes = 0;     ///< Queued since the last checkpoint.
+    size_t journalBatches = 0;
+    size_t checkpointSize = 0;
+    std::string error;
+    std::thread writer;
+};
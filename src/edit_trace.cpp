@@ -0,0 +1,175 @@
+#include "edit_trace.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "edit_delta.h"
+#include "varint.h"
+
+namespace {
+
+constexpr char kMagic[4] = {'S', 'N', 'T', 'R'};
+constexpr uint64_t kVersion = 1;
+constexpr size_t kFlushBytes = 64 * 1024;
+
+// Length of the UTF-8 sequence led by @p lead; stray bytes count as one.
+size_t sequenceLength(unsigned char lead) {
+    if (lead >= 0xF0) return 4;
+    if (lead >= 0xE0) return 3;
+    if (lead >= 0xC0) return 2;
+    return 1;
+}
+
+} // namespace
+
+EditTraceWriter::EditTraceWriter(const std::string& path)
+    : out(path, std::ios::binary | std::ios::trunc), last(std::chrono::steady_clock::now()) {
+    if (!out) {
+        throw std::runtime_error("Cannot open trace file " + path);
+    }
+    pending.append(kMagic, sizeof(kMagic));
+    appendVarint(pending, kVersion);
+}
+
+EditTraceWriter::~EditTraceWriter() {
+    flush();
+}
+
+void EditTraceWriter::snapshot(const std::string& text, const std::string& language) {
+    std::string payload;
+    appendVarint(payload, language.size());
+    payload += language;
+    payload += text;
+    append(EditTraceKind::Snapshot, payload);
+}
+
+void EditTraceWriter::edits(const std::vector<TextEdit>& batch) {
+    append(EditTraceKind::Edits, encodeEditDelta(batch));
+}
+
+void EditTraceWriter::cursor(size_t offset) {
+    std::string payload;
+    appendVarint(payload, offset);
+    append(EditTraceKind::Cursor, payload);
+}
+
+void EditTraceWriter::completion(size_t offset) {
+    std::string payload;
+    appendVarint(payload, offset);
+    append(EditTraceKind::Completion, payload);
+}
+
+void EditTraceWriter::format(const std::string& language) {
+    append(EditTraceKind::Format, language);
+}
+
+void EditTraceWriter::finish(uint32_t checksum) {
+    if (finished) {
+        return;
+    }
+    std::string payload;
+    appendVarint(payload, checksum);
+    append(EditTraceKind::End, payload);
+    finished = true;
+    flush();
+}
+
+void EditTraceWriter::append(EditTraceKind kind, const std::string& payload) {
+    if (finished) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    pending.push_back(static_cast<char>(kind));
+    appendVarint(pending, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - last).count()));
+    appendVarint(pending, payload.size());
+    pending += payload;
+    last = now;
+    if (pending.size() >= kFlushBytes) {
+        flush();
+    }
+}
+
+void EditTraceWriter::flush() {
+    if (!pending.empty()) {
+        out.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+        out.flush();
+        pending.clear();
+    }
+}
+
+std::vector<EditTraceRecord> readEditTrace(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open trace file " + path);
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0) {
+        throw std::invalid_argument("not an edit trace");
+    }
+    size_t pos = sizeof(kMagic);
+    if (readVarint(data, pos) != kVersion) {
+        throw std::invalid_argument("unsupported edit trace version");
+    }
+
+    std::vector<EditTraceRecord> records;
+    uint64_t time = 0;
+    while (pos < data.size()) {
+        EditTraceRecord record;
+        std::string_view payload;
+        try {
+            record.kind = static_cast<EditTraceKind>(data[pos++]);
+            time += readVarint(data, pos);
+            payload = readBytes(data, pos, static_cast<size_t>(readVarint(data, pos)));
+        } catch (const std::invalid_argument&) {
+            break;  // Torn tail from an interrupted recording.
+        }
+        record.timeMicros = time;
+
+        size_t at = 0;
+        switch (record.kind) {
+        case EditTraceKind::Snapshot:
+            record.language = std::string(readBytes(payload, at, static_cast<size_t>(readVarint(payload, at))));
+            record.text = std::string(payload.substr(at));
+            break;
+        case EditTraceKind::Edits:
+            record.edits = decodeEditDelta(payload);
+            break;
+        case EditTraceKind::Cursor:
+        case EditTraceKind::Completion:
+            record.offset = static_cast<size_t>(readVarint(payload, at));
+            break;
+        case EditTraceKind::Format:
+            record.language = std::string(payload);
+            break;
+        case EditTraceKind::End:
+            record.checksum = static_cast<uint32_t>(readVarint(payload, at));
+            break;
+        default:
+            continue;
+        }
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+size_t utf8BytesForUtf16Units(std::string_view text, size_t units) {
+    size_t pos = 0;
+    while (units > 0 && pos < text.size()) {
+        size_t length = sequenceLength(static_cast<unsigned char>(text[pos]));
+        // Astral code points take a surrogate pair.
+        units -= std::min<size_t>(units, length == 4 ? 2 : 1);
+        pos = std::min(text.size(), pos + length);
+    }
+    return pos;
+}
+
+size_t utf16UnitsInUtf8(std::string_view text) {
+    size_t units = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t length = sequenceLength(static_cast<unsigned char>(text[pos]));
+        units += length == 4 ? 2 : 1;
+        pos += length;
+    }
+    return units;
+}
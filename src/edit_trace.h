@@ -0,0 +1,89 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_buffer.h"
+
+// Kinds of record in an edit trace. Values are part of the file format.
+enum class EditTraceKind : uint8_t {
+    Snapshot = 1,    ///< Document text (and language) when recording began.
+    Edits = 2,       ///< One TextBuffer::applyEdits batch.
+    Cursor = 3,      ///< Cursor moved to a byte offset.
+    Completion = 4,  ///< Completion requested at a byte offset.
+    Format = 5,      ///< Format requested for a language.
+    End = 6,         ///< Recording stopped; carries the final LineChecksum.
+};
+
+struct EditTraceRecord {
+    EditTraceKind kind;
+    uint64_t timeMicros = 0;      ///< Since the start of the recording.
+    std::vector<TextEdit> edits;  ///< Edits
+    size_t offset = 0;            ///< Cursor, Completion
+    std::string text;             ///< Snapshot text
+    std::string language;         ///< Snapshot, Format
+    uint32_t checksum = 0;        ///< End
+};
+
+/**
+ * @brief Writes an editing session as a compact binary trace.
+ *
+ * Layout: "SNTR", varint version, then records of one kind byte, varint
+ * microseconds since the previous record, varint payload length and the
+ * payload. Edits payloads use the edit_delta.h encoding, so a keystroke
+ * costs a handful of bytes. Records are buffered and written in chunks.
+ */
+class EditTraceWriter {
+public:
+    /**
+     * @brief Creates or truncates @p path; throws std::runtime_error if it
+     * cannot be opened.
+     */
+    explicit EditTraceWriter(const std::string& path);
+    ~EditTraceWriter();
+
+    EditTraceWriter(const EditTraceWriter&) = delete;
+    EditTraceWriter& operator=(const EditTraceWriter&) = delete;
+
+    void snapshot(const std::string& text, const std::string& language);
+    void edits(const std::vector<TextEdit>& edits);
+    void cursor(size_t offset);
+    void completion(size_t offset);
+    void format(const std::string& language);
+
+    /**
+     * @brief Appends the End record and flushes. Later calls are ignored.
+     */
+    void finish(uint32_t checksum);
+
+private:
+    void append(EditTraceKind kind, const std::string& payload);
+    void flush();
+
+    std::ofstream out;
+    std::string pending;
+    std::chrono::steady_clock::time_point last;
+    bool finished = false;
+};
+
+/**
+ * @brief Reads a whole trace; throws std::runtime_error if the file cannot
+ * be read and std::invalid_argument if it is malformed. Records of unknown
+ * kind are skipped. A trace cut short by a crash yields the records before
+ * the damage and no End record.
+ */
+std::vector<EditTraceRecord> readEditTrace(const std::string& path);
+
+/**
+ * @brief Bytes of @p text that make up its first @p units UTF-16 code
+ * units, for converting Qt positions to TextBuffer offsets.
+ */
+size_t utf8BytesForUtf16Units(std::string_view text, size_t units);
+
+/**
+ * @brief UTF-16 code units needed for the UTF-8 @p text.
+ */
+size_t utf16UnitsInUtf8(std::string_view text);
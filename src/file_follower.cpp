@@ -0,0 +1,222 @@
+#include "file_follower.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace {
+
+// Largest single read; bigger appends are delivered in several chunks.
+constexpr size_t kMaxChunk = 8 << 20;
+// Safety-net re-check interval, and the poll interval without inotify.
+constexpr int kPollMillis = 250;
+
+// Length of the prefix of data that ends on a complete UTF-8 sequence.
+size_t completeUtf8Prefix(const std::string& data) {
+    size_t size = data.size();
+    for (size_t back = 1; back <= 3 && back <= size; ++back) {
+        unsigned char c = static_cast<unsigned char>(data[size - back]);
+        if ((c & 0xC0) == 0x80) {
+            continue;  // continuation byte; keep looking for the lead
+        }
+        size_t needed = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+        return needed > back ? size - back : size;
+    }
+    return size;
+}
+
+} // namespace
+
+FileFollower::~FileFollower() {
+    stop();
+}
+
+bool FileFollower::start(const std::string& filePath, size_t startOffset, Callbacks newCallbacks) {
+    stop();
+
+    path = filePath;
+    callbacks = std::move(newCallbacks);
+    if (!reopen()) {
+        return false;
+    }
+    offset = startOffset;
+    carry.clear();
+
+    if (pipe(wakePipe) != 0) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    stopping.store(false);
+    worker = std::thread(&FileFollower::run, this);
+    return true;
+}
+
+void FileFollower::stop() {
+    if (worker.joinable()) {
+        stopping.store(true);
+        char byte = 0;
+        (void)!write(wakePipe[1], &byte, 1);
+        worker.join();
+    }
+    for (int& end : wakePipe) {
+        if (end >= 0) {
+            ::close(end);
+            end = -1;
+        }
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool FileFollower::reopen() {
+    int newFd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (newFd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(newFd, &st) != 0) {
+        ::close(newFd);
+        return false;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = newFd;
+    inode = static_cast<unsigned long long>(st.st_ino);
+    return true;
+}
+
+void FileFollower::run() {
+#if defined(__linux__)
+    int notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int fileWatch = -1;
+    if (notifyFd >= 0) {
+        fileWatch = inotify_add_watch(notifyFd, path.c_str(), IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+        // The directory watch catches a rotated-in replacement file.
+        std::string directory = path.substr(0, path.find_last_of('/') == std::string::npos ? 0 : path.find_last_of('/'));
+        inotify_add_watch(notifyFd, directory.empty() ? "." : directory.c_str(), IN_CREATE | IN_MOVED_TO);
+    }
+#else
+    int notifyFd = -1;
+#endif
+
+    check();  // Anything appended between the caller's load and now.
+    while (!stopping.load()) {
+        pollfd fds[2] = {{wakePipe[0], POLLIN, 0}, {notifyFd, POLLIN, 0}};
+        int ready = poll(fds, notifyFd >= 0 ? 2 : 1, kPollMillis);
+        if (stopping.load()) {
+            break;
+        }
+        if (ready > 0 && notifyFd >= 0 && (fds[1].revents & POLLIN)) {
+#if defined(__linux__)
+            // Drain the queue; every event just means "re-check".
+            alignas(inotify_event) char events[4096];
+            bool rewatch = false;
+            ssize_t n;
+            while ((n = read(notifyFd, events, sizeof(events))) > 0) {
+                for (char* p = events; p < events + n;) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                    if (event->wd == fileWatch && (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))) {
+                        rewatch = true;
+                    }
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+            check();
+            if (rewatch || fileWatch < 0) {
+                if (fileWatch >= 0) {
+                    inotify_rm_watch(notifyFd, fileWatch);
+                }
+                fileWatch = inotify_add_watch(notifyFd, path.c_str(), IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+            }
+            continue;
+#endif
+        }
+        check();
+    }
+
+    if (notifyFd >= 0) {
+        ::close(notifyFd);
+    }
+}
+
+void FileFollower::check() {
+    struct stat byPath;
+    bool pathExists = stat(path.c_str(), &byPath) == 0;
+    if (pathExists && static_cast<unsigned long long>(byPath.st_ino) != inode) {
+        // Rotated: drain what was appended to the old file, then switch.
+        struct stat old;
+        if (fstat(fd, &old) == 0 && static_cast<size_t>(old.st_size) > offset) {
+            readAppended(static_cast<size_t>(old.st_size));
+        }
+        if (!reopen()) {
+            return;
+        }
+        offset = 0;
+        carry.clear();
+        if (callbacks.onReset) {
+            callbacks.onReset();
+        }
+    }
+
+    struct stat current;
+    if (fstat(fd, &current) != 0) {
+        return;
+    }
+    size_t size = static_cast<size_t>(current.st_size);
+    if (size < offset) {
+        offset = 0;
+        carry.clear();
+        if (callbacks.onReset) {
+            callbacks.onReset();
+        }
+    }
+    if (size > offset) {
+        readAppended(size);
+    }
+}
+
+void FileFollower::readAppended(size_t newSize) {
+    if (!callbacks.onAppend) {
+        offset = newSize;
+        if (callbacks.onGrow) {
+            callbacks.onGrow(newSize);
+        }
+        return;
+    }
+
+    while (offset < newSize && !stopping.load(std::memory_order_relaxed)) {
+        size_t want = std::min(kMaxChunk, newSize - offset);
+        std::string chunk = std::move(carry);
+        carry.clear();
+        size_t kept = chunk.size();
+        chunk.resize(kept + want);
+        ssize_t got = pread(fd, &chunk[kept], want, static_cast<off_t>(offset));
+        if (got <= 0) {
+            carry = chunk.substr(0, kept);
+            return;
+        }
+        chunk.resize(kept + static_cast<size_t>(got));
+        offset += static_cast<size_t>(got);
+
+        size_t complete = completeUtf8Prefix(chunk);
+        carry.assign(chunk, complete, std::string::npos);
+        chunk.resize(complete);
+        if (!chunk.empty()) {
+            callbacks.onAppend(std::move(chunk));
+        }
+    }
+    if (callbacks.onGrow) {
+        callbacks.onGrow(offset);
+    }
+}
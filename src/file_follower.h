@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Follows a growing file (tail -F semantics).
+ *
+ * A background thread waits for inotify events on the file and its
+ * directory (stat polling where inotify is unavailable) and reads only the
+ * byte range appended since the last check. Truncation and rotation (the
+ * path being renamed, deleted or replaced) are reported through onReset,
+ * after which the new file is followed from its start.
+ */
+class FileFollower {
+public:
+    struct Callbacks {
+        /// Appended bytes. Chunks end on a UTF-8 sequence boundary; an
+        /// incomplete trailing sequence is held back until the rest arrives.
+        /// Leave unset to skip reading when only onGrow is needed.
+        std::function<void(std::string&& appended)> onAppend;
+        /// New file size after each growth.
+        std::function<void(size_t newSize)> onGrow;
+        /// The file was truncated or replaced; content restarts at offset 0.
+        std::function<void()> onReset;
+    };
+
+    FileFollower() = default;
+    ~FileFollower();
+
+    FileFollower(const FileFollower&) = delete;
+    FileFollower& operator=(const FileFollower&) = delete;
+
+    /**
+     * @brief Starts following @p path from byte @p startOffset, typically the
+     * size already loaded by the caller. Callbacks run on the follower thread.
+     * @return False if the file cannot be opened.
+     */
+    bool start(const std::string& path, size_t startOffset, Callbacks callbacks);
+
+    /**
+     * @brief Stops the follower thread; no callbacks run after this returns.
+     */
+    void stop();
+
+    bool isRunning() const { return worker.joinable(); }
+
+private:
+    void run();
+    void check();
+    bool reopen();
+    void readAppended(size_t newSize);
+
+    std::string path;
+    Callbacks callbacks;
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+
+    int fd = -1;
+    unsigned long long inode = 0;
+    size_t offset = 0;
+    std::string carry;  ///< Incomplete UTF-8 sequence from the previous read.
+    int wakePipe[2] = {-1, -1};
+};
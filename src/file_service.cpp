@@ -0,0 +1,717 @@
+#include "file_service.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+#include "edit_delta.h"
+
+namespace {
+
+constexpr size_t kMaxHeaderBytes = 16 * 1024;
+constexpr size_t kMaxBodyBytes = size_t(512) << 20;
+constexpr auto kWriteBackDelay = std::chrono::milliseconds(250);
+constexpr size_t kWriteChunkBytes = size_t(1) << 20;
+
+std::string errorText(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Copies [offset, offset + count) of fileFd to the socket without passing
+// through user space where the platform allows it.
+bool sendFileRange(int socketFd, int fileFd, size_t offset, size_t count) {
+#if defined(__linux__)
+    off_t position = static_cast<off_t>(offset);
+    while (count > 0) {
+        ssize_t sent = sendfile(socketFd, fileFd, &position, count);
+        if (sent <= 0) {
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        count -= static_cast<size_t>(sent);
+    }
+    return true;
+#else
+    std::vector<char> chunk(1 << 16);
+    while (count > 0) {
+        ssize_t got = pread(fileFd, chunk.data(), std::min(count, chunk.size()), static_cast<off_t>(offset));
+        if (got <= 0 || !sendAll(socketFd, chunk.data(), static_cast<size_t>(got))) {
+            return false;
+        }
+        offset += static_cast<size_t>(got);
+        count -= static_cast<size_t>(got);
+    }
+    return true;
+#endif
+}
+
+// Compares in time independent of where the strings differ.
+bool secretEquals(const std::string& given, const std::string& expected) {
+    unsigned char difference = given.size() == expected.size() ? 0 : 1;
+    for (size_t i = 0; i < given.size(); ++i) {
+        difference |= static_cast<unsigned char>(given[i] ^ expected[i % expected.size()]);
+    }
+    return difference == 0;
+}
+
+const char* statusText(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 416: return "Range Not Satisfiable";
+    default: return "Internal Server Error";
+    }
+}
+
+std::string responseHead(int status, const std::string& contentType, size_t contentLength,
+                         bool keepAlive, const std::string& extraHeaders = std::string()) {
+    std::string head = "HTTP/1.1 " + std::to_string(status) + " " + statusText(status) + "\r\n";
+    head += "Content-Type: " + contentType + "\r\n";
+    head += "Content-Length: " + std::to_string(contentLength) + "\r\n";
+    head += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    head += extraHeaders;
+    head += "\r\n";
+    return head;
+}
+
+bool sendResponse(int fd, int status, const std::string& contentType, const std::string& body,
+                  bool keepAlive, const std::string& extraHeaders = std::string()) {
+    std::string response = responseHead(status, contentType, body.size(), keepAlive, extraHeaders);
+    response += body;
+    return sendAll(fd, response.data(), response.size());
+}
+
+std::string percentDecode(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1]))
+            && std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+bool sendJsonError(int fd, int status, const std::string& message, bool keepAlive) {
+    return sendResponse(fd, status, "application/json", "{\"error\":\"" + jsonEscape(message) + "\"}", keepAlive);
+}
+
+// Extracts a top-level string field from a small JSON object. Enough for the
+// request bodies this service accepts; \u escapes are not decoded.
+bool jsonStringField(const std::string& json, const std::string& name, std::string& value) {
+    size_t pos = json.find("\"" + name + "\"");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = json.find(':', pos + name.size() + 2);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos = json.find('"', pos);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    value.clear();
+    for (++pos; pos < json.size(); ++pos) {
+        char c = json[pos];
+        if (c == '"') {
+            return true;
+        }
+        if (c == '\\' && pos + 1 < json.size()) {
+            char next = json[++pos];
+            value += next == 'n' ? '\n' : next == 't' ? '\t' : next;
+        } else {
+            value += c;
+        }
+    }
+    return false;
+}
+
+std::string queryValue(const std::string& query, const std::string& name) {
+    size_t start = 0;
+    while (start <= query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        std::string pair = query.substr(start, end - start);
+        size_t eq = pair.find('=');
+        if (pair.substr(0, eq) == name) {
+            return eq == std::string::npos ? std::string() : percentDecode(pair.substr(eq + 1));
+        }
+        start = end + 1;
+    }
+    return std::string();
+}
+
+// Parses a single "bytes=a-b" range against size; false if unsatisfiable.
+bool parseRange(const std::string& header, size_t size, size_t& first, size_t& last) {
+    if (header.compare(0, 6, "bytes=") != 0 || header.find(',') != std::string::npos) {
+        return false;
+    }
+    std::string spec = header.substr(6);
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos || size == 0) {
+        return false;
+    }
+    std::string from = spec.substr(0, dash);
+    std::string to = spec.substr(dash + 1);
+    if (from.empty()) {  // Suffix range: the last N bytes.
+        if (to.empty()) {
+            return false;
+        }
+        size_t suffix = std::min<size_t>(std::strtoull(to.c_str(), nullptr, 10), size);
+        first = size - suffix;
+        last = size - 1;
+        return suffix > 0;
+    }
+    first = std::strtoull(from.c_str(), nullptr, 10);
+    last = to.empty() ? size - 1 : std::min<size_t>(std::strtoull(to.c_str(), nullptr, 10), size - 1);
+    return first < size && first <= last;
+}
+
+} // namespace
+
+FileService::FileService(std::string rootDirectory, std::string secret) : secret(std::move(secret)) {
+    if (this->secret.empty()) {
+        throw std::invalid_argument("FileService: empty secret");
+    }
+    char resolved[PATH_MAX];
+    root = realpath(rootDirectory.c_str(), resolved) ? std::string(resolved) : rootDirectory;
+    writer = std::thread(&FileService::writerLoop, this);
+}
+
+FileService::~FileService() {
+    stop();
+    if (listenFd >= 0) {
+        close(listenFd);
+    }
+}
+
+bool FileService::listen(const std::string& address, uint16_t port) {
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1
+        || bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || ::listen(listenFd, SOMAXCONN) != 0) {
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    socklen_t length = sizeof(addr);
+    getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &length);
+    boundPort = ntohs(addr.sin_port);
+    return true;
+}
+
+void FileService::run() {
+    while (!stopping.load()) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            if (stopping.load()) {
+                close(fd);
+                break;
+            }
+            connections.insert(fd);
+        }
+        std::thread(&FileService::serveConnection, this, fd).detach();
+    }
+}
+
+void FileService::stop() {
+    stopping.store(true);
+    if (listenFd >= 0) {
+        shutdown(listenFd, SHUT_RDWR);
+    }
+    std::unique_lock<std::mutex> lock(connectionsMutex);
+    for (int fd : connections) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    connectionsDone.wait(lock, [this] { return connections.empty(); });
+    lock.unlock();
+
+    {
+        std::lock_guard<std::mutex> writerLock(writerMutex);
+        writerStopping = true;
+    }
+    writerWake.notify_all();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+void FileService::serveConnection(int fd) {
+    std::string pending;
+    Request request;
+    while (readRequest(fd, pending, request)) {
+        handle(fd, request);
+        if (!request.keepAlive) {
+            break;
+        }
+    }
+
+    close(fd);
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    connections.erase(fd);
+    connectionsDone.notify_all();
+}
+
+bool FileService::readRequest(int fd, std::string& pending, Request& request) {
+    char chunk[16 * 1024];
+    size_t headerEnd;
+    while ((headerEnd = pending.find("\r\n\r\n")) == std::string::npos) {
+        if (pending.size() > kMaxHeaderBytes) {
+            return false;
+        }
+        ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+        if (got <= 0) {
+            return false;
+        }
+        pending.append(chunk, static_cast<size_t>(got));
+    }
+
+    request = Request();
+    std::string head = pending.substr(0, headerEnd);
+    pending.erase(0, headerEnd + 4);
+
+    size_t lineEnd = head.find("\r\n");
+    std::string requestLine = head.substr(0, lineEnd);
+    size_t firstSpace = requestLine.find(' ');
+    size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+    if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+        return false;
+    }
+    request.method = requestLine.substr(0, firstSpace);
+    std::string target = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+    std::string version = requestLine.substr(secondSpace + 1);
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    request.query = question == std::string::npos ? std::string() : target.substr(question + 1);
+
+    for (size_t pos = lineEnd; pos != std::string::npos && pos < head.size();) {
+        size_t start = pos + 2;
+        size_t end = head.find("\r\n", start);
+        std::string line = head.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            std::string name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+            request.headers[name] = valueStart == std::string::npos ? std::string() : line.substr(valueStart);
+        }
+        pos = end;
+    }
+
+    std::string connection = request.headers["connection"];
+    std::transform(connection.begin(), connection.end(), connection.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    request.keepAlive = version == "HTTP/1.1" ? connection != "close" : connection == "keep-alive";
+
+    size_t contentLength = std::strtoull(request.headers["content-length"].c_str(), nullptr, 10);
+    if (contentLength > kMaxBodyBytes) {
+        sendJsonError(fd, 413, "body too large", false);
+        return false;
+    }
+    while (pending.size() < contentLength) {
+        ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+        if (got <= 0) {
+            return false;
+        }
+        pending.append(chunk, static_cast<size_t>(got));
+    }
+    request.body = pending.substr(0, contentLength);
+    pending.erase(0, contentLength);
+    return true;
+}
+
+void FileService::handle(int fd, const Request& request) {
+    static const std::string contentPrefix = "/content/";
+    static const std::string savePrefix = "/save/";
+
+    // Only the proxy may call. Browsers send Origin with cross-site and
+    // no-cors POSTs, and nobody else has the secret.
+    if (request.headers.count("origin")) {
+        sendJsonError(fd, 403, "browser requests are not accepted", request.keepAlive);
+        return;
+    }
+    auto given = request.headers.find("x-service-secret");
+    if (given == request.headers.end() || !secretEquals(given->second, secret)) {
+        sendJsonError(fd, 401, "a valid X-Service-Secret is required", request.keepAlive);
+        return;
+    }
+
+    if (request.path == "/load") {
+        if (request.method != "POST") {
+            sendJsonError(fd, 405, "use POST", request.keepAlive);
+            return;
+        }
+        handleLoad(fd, request);
+    } else if (request.path.compare(0, contentPrefix.size(), contentPrefix) == 0) {
+        if (request.method != "GET") {
+            sendJsonError(fd, 405, "use GET", request.keepAlive);
+            return;
+        }
+        handleContent(fd, request, percentDecode(request.path.substr(contentPrefix.size())));
+    } else if (request.path.compare(0, savePrefix.size(), savePrefix) == 0) {
+        if (request.method != "POST") {
+            sendJsonError(fd, 405, "use POST", request.keepAlive);
+            return;
+        }
+        handleSave(fd, request, percentDecode(request.path.substr(savePrefix.size())));
+    } else {
+        sendJsonError(fd, 404, "not found", request.keepAlive);
+    }
+}
+
+std::string FileService::resolve(const std::string& id) const {
+    if (id.empty() || id[0] == '/') {
+        return std::string();
+    }
+    char resolved[PATH_MAX];
+    if (!realpath((root + "/" + id).c_str(), resolved)) {
+        return std::string();
+    }
+    // realpath folds "..", and symlinks, so a prefix check keeps ids inside root.
+    std::string path(resolved);
+    const std::string prefix = root == "/" ? root : root + "/";
+    if (path.size() <= prefix.size() || path.compare(0, prefix.size(), prefix) != 0) {
+        return std::string();
+    }
+    return path;
+}
+
+std::shared_ptr<FileService::Document> FileService::document(const std::string& id) {
+    std::string path = resolve(id);
+    if (path.empty()) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(documentsMutex);
+    std::shared_ptr<Document>& entry = documents[path];
+    if (!entry) {
+        entry = std::make_shared<Document>();
+        entry->path = path;
+    }
+    return entry;
+}
+
+void FileService::writeBack(Document& doc) {
+    if (!doc.dirty) {
+        return;
+    }
+    // Replaced atomically: the new text is made durable under a temporary
+    // name with the file's mode, renamed over it, and the rename is made
+    // durable by syncing the directory.
+    struct stat original;
+    if (stat(doc.path.c_str(), &original) != 0) {
+        throw std::runtime_error(errorText("stat failed"));
+    }
+    const std::string temporary = doc.path + ".snsupear-save";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::runtime_error(errorText("cannot create " + temporary));
+    }
+    bool written = fchmod(fd, original.st_mode & 07777) == 0;
+    std::string chunk;
+    const TextBuffer& text = *doc.buffer;
+    for (size_t line = 0; written && line < text.getLineCount(); ++line) {
+        if (line > 0) {
+            chunk += '\n';
+        }
+        chunk += text.lineView(line);
+        if (chunk.size() >= kWriteChunkBytes || line + 1 == text.getLineCount()) {
+            written = writeAll(fd, chunk.data(), chunk.size());
+            chunk.clear();
+        }
+    }
+    written = written && fsync(fd) == 0;
+    std::string failure = written ? std::string() : errorText("cannot write " + temporary);
+    close(fd);
+    if (written && rename(temporary.c_str(), doc.path.c_str()) != 0) {
+        failure = errorText("rename failed");
+    }
+    if (!failure.empty()) {
+        unlink(temporary.c_str());
+        throw std::runtime_error(failure);
+    }
+    doc.dirty = false;
+
+    const std::string directory = doc.path.substr(0, doc.path.rfind('/') + 1);
+    int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+}
+
+void FileService::scheduleWriteBack(const std::shared_ptr<Document>& doc) {
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        unsaved.insert(doc);
+    }
+    writerWake.notify_all();
+}
+
+void FileService::writerLoop() {
+    std::unique_lock<std::mutex> lock(writerMutex);
+    for (;;) {
+        writerWake.wait(lock, [this] { return writerStopping || !unsaved.empty(); });
+        // Let a burst of keystroke-sized saves land before touching the disk.
+        writerWake.wait_for(lock, kWriteBackDelay, [this] { return writerStopping; });
+
+        std::set<std::shared_ptr<Document>> batch;
+        batch.swap(unsaved);
+        bool finalPass = writerStopping;
+        lock.unlock();
+        for (const std::shared_ptr<Document>& doc : batch) {
+            std::lock_guard<std::mutex> docLock(doc->mutex);
+            try {
+                writeBack(*doc);
+            } catch (const std::exception& e) {
+                std::cerr << "Write-back of " << doc->path << " failed: " << e.what() << std::endl;
+                if (!finalPass) {
+                    std::lock_guard<std::mutex> retryLock(writerMutex);
+                    unsaved.insert(doc);
+                }
+            }
+        }
+        lock.lock();
+        if (finalPass && unsaved.empty()) {
+            return;
+        }
+    }
+}
+
+void FileService::handleLoad(int fd, const Request& request) {
+    std::string id;
+    if (!jsonStringField(request.body, "path", id)) {
+        sendJsonError(fd, 400, "missing \"path\"", request.keepAlive);
+        return;
+    }
+    std::shared_ptr<Document> doc = document(id);
+    struct stat st;
+    if (!doc || stat(doc->path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        sendJsonError(fd, 404, "no such file", request.keepAlive);
+        return;
+    }
+
+    uint64_t revision;
+    {
+        std::lock_guard<std::mutex> lock(doc->mutex);
+        revision = doc->revision;
+    }
+    sendResponse(fd, 200, "application/json",
+                 "{\"id\":\"" + jsonEscape(id) + "\",\"size\":" + std::to_string(st.st_size)
+                     + ",\"revision\":" + std::to_string(revision) + "}",
+                 request.keepAlive);
+}
+
+void FileService::handleContent(int fd, const Request& request, const std::string& id) {
+    std::shared_ptr<Document> doc = document(id);
+    if (!doc) {
+        sendJsonError(fd, 404, "no such file", request.keepAlive);
+        return;
+    }
+
+    // Write-back replaces the file by rename, so a descriptor opened under
+    // the document lock and the revision read with it describe one version.
+    int fileFd;
+    uint64_t revision;
+    {
+        std::lock_guard<std::mutex> lock(doc->mutex);
+        try {
+            writeBack(*doc);
+        } catch (const std::exception& e) {
+            sendJsonError(fd, 500, e.what(), request.keepAlive);
+            return;
+        }
+        fileFd = open(doc->path.c_str(), O_RDONLY | O_CLOEXEC);
+        revision = doc->revision;
+    }
+    if (fileFd < 0) {
+        sendJsonError(fd, 404, "no such file", request.keepAlive);
+        return;
+    }
+    struct stat st;
+    fstat(fileFd, &st);
+    size_t size = static_cast<size_t>(st.st_size);
+
+    std::string headers = "Accept-Ranges: bytes\r\nX-Revision: " + std::to_string(revision) + "\r\n";
+    size_t first = 0;
+    size_t last = size == 0 ? 0 : size - 1;
+    int status = 200;
+    auto range = request.headers.find("range");
+    if (range != request.headers.end()) {
+        if (!parseRange(range->second, size, first, last)) {
+            sendResponse(fd, 416, "application/json", "{}", request.keepAlive,
+                         headers + "Content-Range: bytes */" + std::to_string(size) + "\r\n");
+            close(fileFd);
+            return;
+        }
+        status = 206;
+        headers += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) + "/"
+                   + std::to_string(size) + "\r\n";
+    }
+
+    size_t length = size == 0 ? 0 : last - first + 1;
+    std::string head = responseHead(status, "application/octet-stream", length, request.keepAlive, headers);
+    if (sendAll(fd, head.data(), head.size()) && length > 0) {
+        sendFileRange(fd, fileFd, first, length);
+    }
+    close(fileFd);
+}
+
+void FileService::handleSave(int fd, const Request& request, const std::string& id) {
+    auto contentType = request.headers.find("content-type");
+    if (contentType == request.headers.end() || contentType->second != "application/octet-stream") {
+        sendJsonError(fd, 415, "saves must be an application/octet-stream edit delta", request.keepAlive);
+        return;
+    }
+    std::shared_ptr<Document> doc = document(id);
+    if (!doc) {
+        sendJsonError(fd, 404, "no such file", request.keepAlive);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(doc->mutex);
+    std::string base = queryValue(request.query, "base");
+    if (base.empty() || std::strtoull(base.c_str(), nullptr, 10) != doc->revision) {
+        sendResponse(fd, 409, "application/json", "{\"revision\":" + std::to_string(doc->revision) + "}",
+                     request.keepAlive, "X-Revision: " + std::to_string(doc->revision) + "\r\n");
+        return;
+    }
+
+    try {
+        if (!doc->buffer) {
+            doc->buffer = std::make_unique<TextBuffer>();
+            Document* raw = doc.get();
+            doc->buffer->addChangeListener([raw](const DamageRegion& damage) {
+                raw->checksum.update(*raw->buffer, damage);
+            });
+            doc->checksum.reset(*doc->buffer);
+            doc->buffer->loadFile(doc->path);
+        }
+
+        // The history of a service-side buffer is of no use to anyone.
+        doc->buffer->applyExternalEdits(decodeEditDelta(request.body));
+    } catch (const std::invalid_argument& e) {
+        // Nothing was applied; the buffer is still at this revision.
+        sendJsonError(fd, 400, e.what(), request.keepAlive);
+        return;
+    } catch (const std::exception& e) {
+        if (!doc->dirty) {
+            doc->buffer.reset();  // Reload from disk on the next save.
+        }
+        sendJsonError(fd, 500, e.what(), request.keepAlive);
+        return;
+    }
+
+    ++doc->revision;
+    doc->dirty = true;
+    scheduleWriteBack(doc);
+    sendResponse(fd, 200, "application/json",
+                 "{\"revision\":" + std::to_string(doc->revision) + ",\"size\":"
+                     + std::to_string(doc->buffer->getLength()) + ",\"checksum\":"
+                     + std::to_string(doc->checksum.value()) + "}",
+                 request.keepAlive, "X-Revision: " + std::to_string(doc->revision) + "\r\n");
+}
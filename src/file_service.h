@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "line_checksum.h"
+#include "text_buffer.h"
+
+/**
+ * @brief Native HTTP/1.1 file service for the web client.
+ *
+ * Serves files under a root directory:
+ *   POST /load              {"path": "<relative path>"} -> {"id", "size", "revision"}
+ *   GET  /content/<id>      file bytes via sendfile; honours "Range: bytes=a-b"
+ *   POST /save/<id>?base=R  binary edit delta (see edit_delta.h) applied to the
+ *                           document's TextBuffer; acknowledged with
+ *                           {"revision", "size", "checksum"} (see
+ *                           line_checksum.h), or 409 if R is stale
+ *
+ * Only the web server's proxy may call it: every request must carry the
+ * shared secret in "X-Service-Secret", and requests with an Origin header,
+ * which browsers add to cross-site ones, are refused. Saves must be edit
+ * deltas; there is no whole-file upload.
+ *
+ * Documents are kept as TextBuffers once first saved, so a save costs the
+ * patch, not the file: the write-back to disk is deferred to a writer
+ * thread that coalesces bursts of saves, and a content read flushes first.
+ * Each connection gets its own thread and keep-alive is supported.
+ */
+class FileService {
+public:
+    /**
+     * @param secret Required in every request's X-Service-Secret header;
+     * throws std::invalid_argument if empty.
+     */
+    FileService(std::string rootDirectory, std::string secret);
+    ~FileService();
+
+    FileService(const FileService&) = delete;
+    FileService& operator=(const FileService&) = delete;
+
+    /**
+     * @brief Binds the listening socket; port 0 picks a free port.
+     * @return False if the socket cannot be bound.
+     */
+    bool listen(const std::string& address, uint16_t port);
+
+    uint16_t port() const { return boundPort; }
+
+    /**
+     * @brief Accepts connections until stop() is called.
+     */
+    void run();
+
+    /**
+     * @brief Stops accepting, closes open connections, waits for their
+     * threads and writes back unsaved documents. Safe to call from another
+     * thread.
+     */
+    void stop();
+
+private:
+    struct Document {
+        std::mutex mutex;
+        std::string path;
+        std::unique_ptr<TextBuffer> buffer;  ///< Loaded on first save.
+        LineChecksum checksum;               ///< Tracks buffer.
+        uint64_t revision = 0;
+        bool dirty = false;                  ///< Buffer is ahead of the file.
+    };
+
+    struct Request {
+        std::string method;
+        std::string path;
+        std::string query;
+        std::map<std::string, std::string> headers;  ///< Lower-case names.
+        std::string body;
+        bool keepAlive = true;
+    };
+
+    void serveConnection(int fd);
+    bool readRequest(int fd, std::string& pending, Request& request);
+    void handle(int fd, const Request& request);
+    void handleLoad(int fd, const Request& request);
+    void handleContent(int fd, const Request& request, const std::string& id);
+    void handleSave(int fd, const Request& request, const std::string& id);
+
+    std::string resolve(const std::string& id) const;
+    std::shared_ptr<Document> document(const std::string& id);
+    static void writeBack(Document& doc);
+    void scheduleWriteBack(const std::shared_ptr<Document>& doc);
+    void writerLoop();
+
+    std::string root;
+    std::string secret;
+    int listenFd = -1;
+    uint16_t boundPort = 0;
+    std::atomic<bool> stopping{false};
+
+    std::mutex documentsMutex;
+    std::map<std::string, std::shared_ptr<Document>> documents;
+
+    std::mutex connectionsMutex;
+    std::condition_variable connectionsDone;
+    std::set<int> connections;
+
+    std::mutex writerMutex;
+    std::condition_variable writerWake;
+    std::set<std::shared_ptr<Document>> unsaved;
+    bool writerStopping = false;
+    std::thread writer;
+};
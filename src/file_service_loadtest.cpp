@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "edit_delta.h"
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 3001;
+    std::string path;
+    std::string mode = "read";
+    int connections = 8;
+    int seconds = 10;
+    size_t chunk = 64 * 1024;
+};
+
+struct Response {
+    int status = 0;
+    std::string headers;
+    std::string body;
+};
+
+// Minimal keep-alive HTTP client; one request in flight per connection.
+class Connection {
+public:
+    bool open(const Options& options) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(options.port));
+        inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        return connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+
+    ~Connection() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    bool request(const std::string& head, const std::string& body, Response& response) {
+        std::string message = head + "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        for (size_t sent = 0; sent < message.size();) {
+            ssize_t n = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+
+        size_t headerEnd;
+        while ((headerEnd = pending.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        response.headers = pending.substr(0, headerEnd);
+        pending.erase(0, headerEnd + 4);
+        response.status = std::atoi(response.headers.c_str() + 9);
+        size_t length = std::strtoull(header(response.headers, "Content-Length").c_str(), nullptr, 10);
+        while (pending.size() < length) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        response.body = pending.substr(0, length);
+        pending.erase(0, length);
+        return true;
+    }
+
+    static std::string header(const std::string& headers, const std::string& name) {
+        size_t pos = headers.find(name + ": ");
+        if (pos == std::string::npos) {
+            return std::string();
+        }
+        pos += name.size() + 2;
+        return headers.substr(pos, headers.find("\r\n", pos) - pos);
+    }
+
+private:
+    bool fill() {
+        char chunk[64 * 1024];
+        ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+        if (got <= 0) {
+            return false;
+        }
+        pending.append(chunk, static_cast<size_t>(got));
+        return true;
+    }
+
+    int fd = -1;
+    std::string pending;
+};
+
+uint64_t jsonNumber(const std::string& json, const std::string& name) {
+    size_t pos = json.find("\"" + name + "\":");
+    return pos == std::string::npos ? 0 : std::strtoull(json.c_str() + pos + name.size() + 3, nullptr, 10);
+}
+
+} // namespace
+
+/**
+ * @brief Load generator for snsupear_fileserver.
+ *
+ * Usage: snsupear_fileserver_loadtest --path FILE [--host ADDR] [--port N]
+ *        [--mode read|save] [--connections N] [--seconds N] [--chunk BYTES]
+ *
+ * "read" issues random ranged GETs of --chunk bytes; "save" posts one-byte
+ * delta patches. Reports throughput and latency percentiles. Sends the
+ * secret from SNSUPEAR_SERVICE_SECRET, as the web server does.
+ */
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--host") options.host = value;
+        else if (flag == "--port") options.port = std::atoi(value.c_str());
+        else if (flag == "--path") options.path = value;
+        else if (flag == "--mode") options.mode = value;
+        else if (flag == "--connections") options.connections = std::max(1, std::atoi(value.c_str()));
+        else if (flag == "--seconds") options.seconds = std::max(1, std::atoi(value.c_str()));
+        else if (flag == "--chunk") options.chunk = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        else {
+            std::cerr << "Unknown option: " << flag << std::endl;
+            return 1;
+        }
+    }
+    if (options.path.empty()) {
+        std::cerr << "--path is required" << std::endl;
+        return 1;
+    }
+
+    const char* secret = std::getenv("SNSUPEAR_SERVICE_SECRET");
+    const std::string auth = std::string("X-Service-Secret: ") + (secret ? secret : "") + "\r\n";
+
+    Connection setup;
+    Response loaded;
+    if (!setup.open(options)
+        || !setup.request("POST /load HTTP/1.1\r\nHost: loadtest\r\nContent-Type: application/json\r\n" + auth,
+                          "{\"path\":\"" + options.path + "\"}", loaded)
+        || loaded.status != 200) {
+        std::cerr << "Failed to load " << options.path << ": " << loaded.body << std::endl;
+        return 1;
+    }
+    const size_t fileSize = jsonNumber(loaded.body, "size");
+    std::atomic<uint64_t> revision{jsonNumber(loaded.body, "revision")};
+    const std::string id = options.path;
+
+    std::mutex resultsMutex;
+    std::vector<double> latencies;
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> conflicts{0};
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.seconds);
+
+    std::vector<std::thread> workers;
+    for (int c = 0; c < options.connections; ++c) {
+        workers.emplace_back([&, c]() {
+            std::mt19937_64 rng(static_cast<uint64_t>(c) * 7919 + 1);
+            std::vector<double> local;
+            Connection connection;
+            if (!connection.open(options)) {
+                ++errors;
+                return;
+            }
+            Response response;
+            while (std::chrono::steady_clock::now() < deadline) {
+                auto start = std::chrono::steady_clock::now();
+                bool ok;
+                if (options.mode == "save") {
+                    size_t offset = fileSize > 0 ? rng() % fileSize : 0;
+                    std::string delta = encodeEditDelta({{offset, std::min(offset + 1, fileSize), "x"}});
+                    ok = connection.request("POST /save/" + id + "?base=" + std::to_string(revision.load())
+                                                + " HTTP/1.1\r\nHost: loadtest\r\nContent-Type: application/octet-stream\r\n" + auth,
+                                            delta, response);
+                    if (ok && response.status == 409) {
+                        ++conflicts;
+                    } else if (ok && response.status != 200) {
+                        ok = false;
+                    }
+                    if (ok) {
+                        revision.store(jsonNumber(response.body, "revision"));
+                    }
+                } else {
+                    size_t offset = fileSize > options.chunk ? rng() % (fileSize - options.chunk) : 0;
+                    ok = connection.request("GET /content/" + id + " HTTP/1.1\r\nHost: loadtest\r\nRange: bytes="
+                                                + std::to_string(offset) + "-" + std::to_string(offset + options.chunk - 1) + "\r\n" + auth,
+                                            std::string(), response)
+                         && (response.status == 206 || response.status == 200);
+                }
+                if (!ok) {
+                    ++errors;
+                    return;
+                }
+                bytes += response.body.size();
+                local.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            }
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+    std::cout << "mode:        " << options.mode << "\n"
+              << "connections: " << options.connections << "\n"
+              << "requests:    " << latencies.size() << " (" << latencies.size() / options.seconds << "/s)\n"
+              << "throughput:  " << (bytes.load() / double(options.seconds)) / (1 << 20) << " MiB/s\n"
+              << "latency us:  p50 " << percentile(0.50) << "  p99 " << percentile(0.99)
+              << "  max " << (latencies.empty() ? 0.0 : latencies.back()) << "\n"
+              << "errors:      " << errors.load() << "\n";
+    if (options.mode == "save") {
+        std::cout << "conflicts:   " << conflicts.load() << "\n";
+    }
+    return errors.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+
+#include "file_service.h"
+
+/**
+ * @brief Runs the native file service until SIGINT or SIGTERM.
+ *
+ * Usage: snsupear_fileserver [--root DIR] [--host ADDR] [--port N]
+ *
+ * SNSUPEAR_SERVICE_SECRET must be set, to the same value the web server
+ * is started with; it forwards it on every request.
+ */
+int main(int argc, char** argv) {
+    std::string root = ".";
+    std::string host = "127.0.0.1";
+    int port = 3001;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--root") == 0) {
+            root = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--host") == 0) {
+            host = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--port") == 0) {
+            port = std::atoi(argv[i + 1]);
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    const char* secret = std::getenv("SNSUPEAR_SERVICE_SECRET");
+    if (!secret || !*secret) {
+        std::cerr << "Set SNSUPEAR_SERVICE_SECRET to the secret the web server forwards" << std::endl;
+        return 1;
+    }
+
+    // Block the shutdown signals everywhere and take them on one thread, so
+    // stop() runs in a normal context rather than a signal handler.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    FileService service(root, secret);
+    if (!service.listen(host, static_cast<uint16_t>(port))) {
+        std::cerr << "Failed to listen on " << host << ":" << port << std::endl;
+        return 1;
+    }
+
+    std::thread signalWaiter([&]() {
+        int signal = 0;
+        sigwait(&signals, &signal);
+        service.stop();
+    });
+
+    std::cout << "File service on http://" << host << ":" << service.port() << " serving " << root << std::endl;
+    service.run();
+
+    pthread_kill(signalWaiter.native_handle(), SIGTERM);  // No-op if already woken.
+    signalWaiter.join();
+    return 0;
+}
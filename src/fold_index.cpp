@@ -0,0 +1,524 @@
+#include "fold_index.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr size_t kChunkLines = 512;
+constexpr size_t kNone = static_cast<size_t>(-1);
+
+template <typename Char>
+LineShape scanShape(const Char* text, size_t length) {
+    LineShape shape;
+    size_t i = 0;
+    int32_t column = 0;
+    for (; i < length && (text[i] == ' ' || text[i] == '\t'); ++i) {
+        column = text[i] == '\t' ? (column / FoldIndex::kTabWidth + 1) * FoldIndex::kTabWidth : column + 1;
+    }
+    if (i == length || (text[i] == '\r' && i + 1 == length)) {
+        return shape;  // Blank
+    }
+    shape.indent = column;
+
+    int32_t depth = 0;
+    Char quote = 0;
+    for (; i < length; ++i) {
+        const Char c = text[i];
+        if (quote) {
+            if (c == '\\') {
+                ++i;
+            } else if (c == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+        switch (c) {
+        case '"':
+        case '\'':
+        case '`':
+            quote = c;
+            break;
+        case '/':
+            if (i + 1 < length && text[i + 1] == '/') {
+                i = length;
+            } else if (i + 1 < length && text[i + 1] == '*') {
+                // Block comments are skipped within the line only.
+                for (i += 2; i + 1 < length && !(text[i] == '*' && text[i + 1] == '/'); ++i) {
+                }
+                ++i;
+            }
+            break;
+        case '{':
+        case '[':
+        case '(':
+            ++depth;
+            break;
+        case '}':
+        case ']':
+        case ')':
+            --depth;
+            shape.minPrefix = std::min(shape.minPrefix, depth);
+            break;
+        default:
+            break;
+        }
+    }
+    shape.net = depth;
+    return shape;
+}
+
+} // namespace
+
+FoldIndex::FoldIndex(Mode mode) : mode(mode) {
+    chunks.push_back({LineShape()});
+    rebuildTree();
+    hiddenBefore.push_back(0);
+}
+
+LineShape FoldIndex::shapeOf(std::string_view line) {
+    return scanShape(line.data(), line.size());
+}
+
+LineShape FoldIndex::shapeOf(std::u16string_view line) {
+    return scanShape(line.data(), line.size());
+}
+
+void FoldIndex::reset(const TextBuffer& buffer) {
+    std::vector<LineShape> shapes;
+    shapes.reserve(buffer.getLineCount());
+    for (size_t i = 0; i < buffer.getLineCount(); ++i) {
+        shapes.push_back(shapeOf(buffer.lineView(i)));
+    }
+    replaceLines(0, lineCount(), shapes);
+}
+
+void FoldIndex::update(const TextBuffer& buffer, const DamageRegion& damage) {
+    scratch.clear();
+    for (size_t i = damage.firstLine; i < damage.firstLine + damage.newLineCount; ++i) {
+        scratch.push_back(shapeOf(buffer.lineView(i)));
+    }
+    replaceLines(damage.firstLine, damage.oldLineCount, scratch);
+}
+
+void FoldIndex::replaceLines(size_t firstLine, size_t oldCount, const std::vector<LineShape>& shapes) {
+    const size_t total = lineCount();
+    if (firstLine == 0 && oldCount >= total) {
+        // A new document: its lines are not the ones that were folded.
+        folded.clear();
+        chunks.clear();
+        for (size_t i = 0; i < shapes.size(); i += kChunkLines) {
+            chunks.emplace_back(shapes.begin() + i, shapes.begin() + std::min(shapes.size(), i + kChunkLines));
+        }
+        if (chunks.empty()) {
+            chunks.push_back({LineShape()});
+        }
+        rebuildTree();
+    } else {
+        auto [first, offset] = locate(firstLine);
+        size_t last = first;
+        size_t at = offset;
+        for (size_t remaining = oldCount; remaining > 0;) {
+            std::vector<LineShape>& lines = chunks[last];
+            size_t take = std::min(remaining, lines.size() - at);
+            lines.erase(lines.begin() + at, lines.begin() + at + take);
+            remaining -= take;
+            if (remaining > 0) {
+                ++last;
+                at = 0;
+            }
+        }
+        chunks[first].insert(chunks[first].begin() + offset, shapes.begin(), shapes.end());
+
+        // Keep chunks between a quarter and twice the target size; any
+        // change in their number rebuilds the tree, which is O(chunks).
+        bool structural = false;
+        if (last > first) {
+            auto begin = chunks.begin() + first + 1;
+            auto end = std::remove_if(begin, chunks.begin() + last + 1,
+                                      [](const std::vector<LineShape>& lines) { return lines.empty(); });
+            if (end != chunks.begin() + last + 1) {
+                chunks.erase(end, chunks.begin() + last + 1);
+                structural = true;
+            }
+        }
+        if (chunks[first].size() < kChunkLines / 4 && chunks.size() > 1) {
+            size_t neighbour = first + 1 < chunks.size() ? first + 1 : first - 1;
+            size_t low = std::min(first, neighbour);
+            chunks[low].insert(chunks[low].end(), chunks[low + 1].begin(), chunks[low + 1].end());
+            chunks.erase(chunks.begin() + low + 1);
+            first = low;
+            structural = true;
+        }
+        if (chunks[first].size() > 2 * kChunkLines) {
+            std::vector<LineShape> lines = std::move(chunks[first]);
+            std::vector<std::vector<LineShape>> pieces;
+            for (size_t i = 0; i < lines.size(); i += kChunkLines) {
+                pieces.emplace_back(lines.begin() + i, lines.begin() + std::min(lines.size(), i + kChunkLines));
+            }
+            chunks.erase(chunks.begin() + first);
+            chunks.insert(chunks.begin() + first, std::make_move_iterator(pieces.begin()),
+                          std::make_move_iterator(pieces.end()));
+            structural = true;
+        }
+
+        if (structural) {
+            rebuildTree();
+        } else {
+            for (size_t c = first; c <= last && c < chunks.size(); ++c) {
+                updateChunk(c);
+            }
+        }
+    }
+
+    // Closed folds below the edit move with their lines; those whose line
+    // was removed are forgotten.
+    const size_t newCount = shapes.size();
+    size_t kept = 0;
+    for (size_t header : folded) {
+        if (header >= firstLine + oldCount) {
+            folded[kept++] = header + newCount - oldCount;
+        } else if (header < firstLine + newCount) {
+            folded[kept++] = header;
+        }
+    }
+    folded.resize(kept);
+    if (!folded.empty() || !hidden.empty()) {
+        rebuildHidden();
+    }
+}
+
+size_t FoldIndex::lineCount() const {
+    return tree[1].lines;
+}
+
+std::optional<FoldRange> FoldIndex::foldAt(size_t line) const {
+    if (line >= lineCount()) {
+        return std::nullopt;
+    }
+    const LineShape& header = shape(line);
+    size_t end;
+    if (mode == Mode::Brackets) {
+        // The region closes on the first later line that drops back to the
+        // depth of the header's outermost unmatched opener; that line stays
+        // visible. An unclosed region runs to the end.
+        const int64_t before = depthBefore(line);
+        const int64_t low = before + header.minPrefix;
+        if (before + header.net <= low) {
+            return std::nullopt;
+        }
+        end = findAfter(
+            line, [low](int64_t depth, const LineShape& shape) { return depth + shape.minPrefix <= low; },
+            [low](int64_t depth, const Summary& summary) { return depth + summary.minPrefix <= low; });
+    } else {
+        if (header.indent < 0) {
+            return std::nullopt;
+        }
+        const int32_t indent = header.indent;
+        end = findAfter(
+            line, [indent](int64_t, const LineShape& shape) { return shape.indent >= 0 && shape.indent <= indent; },
+            [indent](int64_t, const Summary& summary) { return summary.minIndent <= indent; });
+        // Blank lines before the next statement stay outside the region.
+        while (end - 1 > line && shape(end - 1).indent < 0) {
+            --end;
+        }
+    }
+    if (end - 1 <= line) {
+        return std::nullopt;
+    }
+    return FoldRange{line, end - 1};
+}
+
+std::optional<FoldRange> FoldIndex::enclosingFold(size_t line, size_t maxDistance) const {
+    if (line >= lineCount()) {
+        return std::nullopt;
+    }
+    if (std::optional<FoldRange> own = foldAt(line)) {
+        return own;
+    }
+    const size_t stop = line > maxDistance ? line - maxDistance : 0;
+    if (mode == Mode::Brackets) {
+        // Walking up, a header encloses `line` if its outermost unmatched
+        // opener is still open there: no line in between drops to its depth.
+        int64_t depth = depthBefore(line);
+        int64_t lowest = depth + shape(line).minPrefix;
+        for (size_t l = line; l-- > stop;) {
+            const LineShape& candidate = shape(l);
+            depth -= candidate.net;
+            const int64_t low = depth + candidate.minPrefix;
+            if (depth + candidate.net > low && lowest > low) {
+                return foldAt(l);
+            }
+            lowest = std::min(lowest, low);
+        }
+        return std::nullopt;
+    }
+
+    int32_t indent = shape(line).indent;
+    if (indent < 0) {
+        indent = std::numeric_limits<int32_t>::max();
+    }
+    for (size_t l = line; l-- > stop;) {
+        const int32_t candidate = shape(l).indent;
+        if (candidate < 0 || candidate >= indent) {
+            continue;
+        }
+        std::optional<FoldRange> range = foldAt(l);
+        if (range && range->lastHidden >= line) {
+            return range;
+        }
+        indent = candidate;
+    }
+    return std::nullopt;
+}
+
+std::vector<OutlineEntry> FoldIndex::outline(size_t maxDepth) const {
+    std::vector<OutlineEntry> entries;
+    std::vector<size_t> open;  ///< Last lines of the regions enclosing the walk.
+    size_t line = 0;
+    for (const std::vector<LineShape>& lines : chunks) {
+        for (const LineShape& shape : lines) {
+            while (!open.empty() && open.back() < line) {
+                open.pop_back();
+            }
+            bool candidate = mode == Mode::Brackets ? shape.net > shape.minPrefix : shape.indent >= 0;
+            if (candidate) {
+                if (std::optional<FoldRange> range = foldAt(line)) {
+                    if (open.size() < maxDepth) {
+                        entries.push_back({line, range->lastHidden, open.size()});
+                    }
+                    open.push_back(range->lastHidden);
+                }
+            }
+            ++line;
+        }
+    }
+    return entries;
+}
+
+bool FoldIndex::fold(size_t line) {
+    if (!foldAt(line)) {
+        return false;
+    }
+    auto it = std::lower_bound(folded.begin(), folded.end(), line);
+    if (it == folded.end() || *it != line) {
+        folded.insert(it, line);
+        rebuildHidden();
+    }
+    return true;
+}
+
+bool FoldIndex::unfold(size_t line) {
+    auto it = std::lower_bound(folded.begin(), folded.end(), line);
+    if (it == folded.end() || *it != line) {
+        return false;
+    }
+    folded.erase(it);
+    rebuildHidden();
+    return true;
+}
+
+void FoldIndex::unfoldAll() {
+    folded.clear();
+    rebuildHidden();
+}
+
+bool FoldIndex::isFolded(size_t line) const {
+    return std::binary_search(folded.begin(), folded.end(), line);
+}
+
+bool FoldIndex::isHidden(size_t line) const {
+    auto it = std::lower_bound(hidden.begin(), hidden.end(), line,
+                               [](const FoldRange& range, size_t l) { return range.lastHidden < l; });
+    return it != hidden.end() && it->header < line;
+}
+
+size_t FoldIndex::visibleLineCount() const {
+    return lineCount() - hiddenBefore.back();
+}
+
+size_t FoldIndex::documentLine(size_t row) const {
+    // Rows before range i's first hidden line: header + 1 - hiddenBefore[i],
+    // strictly increasing in i.
+    size_t lo = 0;
+    size_t hi = hidden.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (hidden[mid].header + 1 - hiddenBefore[mid] <= row) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return row + hiddenBefore[lo];
+}
+
+size_t FoldIndex::visibleRow(size_t line) const {
+    auto it = std::lower_bound(hidden.begin(), hidden.end(), line,
+                               [](const FoldRange& range, size_t l) { return range.lastHidden < l; });
+    size_t k = static_cast<size_t>(it - hidden.begin());
+    if (it != hidden.end() && it->header < line) {
+        return it->header - hiddenBefore[k];
+    }
+    return line - hiddenBefore[k];
+}
+
+FoldIndex::Summary FoldIndex::summarize(const LineShape& shape) {
+    Summary summary;
+    summary.lines = 1;
+    summary.net = shape.net;
+    summary.minPrefix = shape.minPrefix;
+    if (shape.indent >= 0) {
+        summary.minIndent = shape.indent;
+    }
+    return summary;
+}
+
+FoldIndex::Summary FoldIndex::combine(const Summary& a, const Summary& b) {
+    if (a.lines == 0) {
+        return b;
+    }
+    if (b.lines == 0) {
+        return a;
+    }
+    Summary summary;
+    summary.lines = a.lines + b.lines;
+    summary.net = a.net + b.net;
+    summary.minPrefix = std::min(a.minPrefix, a.net + b.minPrefix);
+    summary.minIndent = std::min(a.minIndent, b.minIndent);
+    return summary;
+}
+
+void FoldIndex::rebuildTree() {
+    leaves = 1;
+    while (leaves < chunks.size()) {
+        leaves *= 2;
+    }
+    tree.assign(2 * leaves, Summary());
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        for (const LineShape& shape : chunks[c]) {
+            tree[leaves + c] = combine(tree[leaves + c], summarize(shape));
+        }
+    }
+    for (size_t node = leaves - 1; node > 0; --node) {
+        tree[node] = combine(tree[2 * node], tree[2 * node + 1]);
+    }
+}
+
+void FoldIndex::updateChunk(size_t chunk) {
+    size_t node = leaves + chunk;
+    tree[node] = Summary();
+    for (const LineShape& shape : chunks[chunk]) {
+        tree[node] = combine(tree[node], summarize(shape));
+    }
+    for (node /= 2; node > 0; node /= 2) {
+        tree[node] = combine(tree[2 * node], tree[2 * node + 1]);
+    }
+}
+
+std::pair<size_t, size_t> FoldIndex::locate(size_t line) const {
+    size_t node = 1;
+    while (node < leaves) {
+        size_t left = 2 * node;
+        if (line < tree[left].lines) {
+            node = left;
+        } else {
+            line -= tree[left].lines;
+            node = left + 1;
+        }
+    }
+    return {node - leaves, line};
+}
+
+const LineShape& FoldIndex::shape(size_t line) const {
+    auto [chunk, offset] = locate(line);
+    return chunks[chunk][offset];
+}
+
+int64_t FoldIndex::depthBefore(size_t line) const {
+    int64_t depth = 0;
+    size_t node = 1;
+    while (node < leaves) {
+        size_t left = 2 * node;
+        if (line < tree[left].lines) {
+            node = left;
+        } else {
+            line -= tree[left].lines;
+            depth += tree[left].net;
+            node = left + 1;
+        }
+    }
+    const std::vector<LineShape>& lines = chunks[node - leaves];
+    for (size_t i = 0; i < line; ++i) {
+        depth += lines[i].net;
+    }
+    return depth;
+}
+
+template <typename LineHit, typename ChunkHit>
+size_t FoldIndex::findAfter(size_t line, LineHit hit, ChunkHit chunkMayHit) const {
+    auto [chunk, offset] = locate(line);
+    int64_t depth = depthBefore(line) + chunks[chunk][offset].net;
+    size_t start = line - offset;  ///< First line of the chunk being scanned.
+    for (size_t i = offset + 1; i < chunks[chunk].size(); ++i) {
+        if (hit(depth, chunks[chunk][i])) {
+            return start + i;
+        }
+        depth += chunks[chunk][i].net;
+    }
+
+    size_t found = findChunk(1, 0, leaves, chunk + 1, depth, chunkMayHit);
+    if (found == kNone) {
+        return lineCount();
+    }
+    // Lines before the found chunk: sum the left siblings on its path up.
+    start = 0;
+    for (size_t node = leaves + found; node > 1; node /= 2) {
+        if (node % 2 == 1) {
+            start += tree[node - 1].lines;
+        }
+    }
+    for (size_t i = 0; i < chunks[found].size(); ++i) {
+        if (hit(depth, chunks[found][i])) {
+            return start + i;
+        }
+        depth += chunks[found][i].net;
+    }
+    return lineCount();
+}
+
+template <typename ChunkHit>
+size_t FoldIndex::findChunk(size_t node, size_t lo, size_t hi, size_t from, int64_t& depth,
+                            ChunkHit& chunkMayHit) const {
+    if (hi <= from || tree[node].lines == 0) {
+        return kNone;
+    }
+    if (lo >= from && !chunkMayHit(depth, tree[node])) {
+        depth += tree[node].net;
+        return kNone;
+    }
+    if (hi - lo == 1) {
+        return lo;
+    }
+    size_t mid = (lo + hi) / 2;
+    size_t found = findChunk(2 * node, lo, mid, from, depth, chunkMayHit);
+    return found != kNone ? found : findChunk(2 * node + 1, mid, hi, from, depth, chunkMayHit);
+}
+
+void FoldIndex::rebuildHidden() {
+    hidden.clear();
+    hiddenBefore.assign(1, 0);
+    size_t kept = 0;
+    for (size_t header : folded) {
+        std::optional<FoldRange> range = foldAt(header);
+        if (!range) {
+            continue;  // The edit took the region away
+        }
+        folded[kept++] = header;
+        if (!hidden.empty() && header <= hidden.back().lastHidden) {
+            continue;  // Closed inside a closed fold
+        }
+        hidden.push_back(*range);
+        hiddenBefore.push_back(hiddenBefore.back() + range->lastHidden - range->header);
+    }
+    folded.resize(kept);
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "text_buffer.h"
+
+// Bracket and indentation profile of one line, all a FoldIndex keeps.
+struct LineShape {
+    int32_t net = 0;        ///< Opening minus closing brackets.
+    int32_t minPrefix = 0;  ///< Lowest bracket depth reached in the line, relative to its start (<= 0).
+    int32_t indent = -1;    ///< Leading whitespace in columns; -1 for a blank line.
+};
+
+// Lines (header, lastHidden] disappear when the fold at `header` is closed.
+struct FoldRange {
+    size_t header;
+    size_t lastHidden;
+
+    bool operator==(const FoldRange& other) const { return header == other.header && lastHidden == other.lastHidden; }
+};
+
+struct OutlineEntry {
+    size_t line;
+    size_t lastLine;  ///< Last line of the region it heads.
+    size_t depth;     ///< Number of enclosing regions.
+};
+
+/**
+ * @brief Fold regions and folded state for a document, kept current per
+ * edit.
+ *
+ * Regions come from bracket structure ({[( ... )]}, outside strings and
+ * // comments) or, in Indentation mode, from indentation. Each line is
+ * reduced to a LineShape; shapes sit in chunks of a few hundred lines
+ * under a segment tree of per-chunk summaries, so an edit rescans only the
+ * damaged lines and finding where a region ends is O(log n) whatever its
+ * size.
+ *
+ * Closed folds are kept as sorted, disjoint hidden ranges with prefix
+ * counts, so a renderer maps between visible rows and document lines by
+ * binary search: a collapsed million-line region costs one range, not a
+ * million skipped lines.
+ */
+class FoldIndex {
+public:
+    enum class Mode { Brackets, Indentation };
+
+    explicit FoldIndex(Mode mode = Mode::Brackets);
+
+    static constexpr int kTabWidth = 4;
+
+    static LineShape shapeOf(std::string_view line);
+    static LineShape shapeOf(std::u16string_view line);
+
+    void reset(const TextBuffer& buffer);
+    void update(const TextBuffer& buffer, const DamageRegion& damage);
+
+    /**
+     * @brief Replaces the shapes of lines [firstLine, firstLine + oldCount),
+     * for views that do not keep a TextBuffer. Replacing every line, as
+     * reset() and loading a new document do, opens all folds.
+     */
+    void replaceLines(size_t firstLine, size_t oldCount, const std::vector<LineShape>& shapes);
+
+    size_t lineCount() const;
+
+    /**
+     * @brief The region headed by @p line, if it heads one.
+     */
+    std::optional<FoldRange> foldAt(size_t line) const;
+
+    /**
+     * @brief The innermost region whose header is @p line or encloses it,
+     * looking back at most @p maxDistance lines.
+     */
+    std::optional<FoldRange> enclosingFold(size_t line, size_t maxDistance = 100000) const;
+
+    /**
+     * @brief Every region header in document order, up to @p maxDepth
+     * levels deep. Walks all lines.
+     */
+    std::vector<OutlineEntry> outline(size_t maxDepth = std::numeric_limits<size_t>::max()) const;
+
+    /**
+     * @brief Closes the fold headed by @p line.
+     * @return False if @p line heads no region.
+     */
+    bool fold(size_t line);
+    bool unfold(size_t line);
+    void unfoldAll();
+    bool isFolded(size_t line) const;
+
+    /**
+     * @brief Top-level hidden ranges: sorted and disjoint, nested closed
+     * folds folded inside them are not listed.
+     */
+    const std::vector<FoldRange>& hiddenRanges() const { return hidden; }
+
+    bool isHidden(size_t line) const;
+    size_t visibleLineCount() const;
+
+    /**
+     * @brief Document line shown at visible row @p row.
+     */
+    size_t documentLine(size_t row) const;
+
+    /**
+     * @brief Visible row of @p line; a hidden line gives its fold's header.
+     */
+    size_t visibleRow(size_t line) const;
+
+private:
+    struct Summary {
+        size_t lines = 0;
+        int64_t net = 0;
+        int64_t minPrefix = 0;
+        int32_t minIndent = std::numeric_limits<int32_t>::max();  ///< Over non-blank lines.
+    };
+
+    static Summary summarize(const LineShape& shape);
+    static Summary combine(const Summary& a, const Summary& b);
+
+    void rebuildTree();
+    void updateChunk(size_t chunk);
+    std::pair<size_t, size_t> locate(size_t line) const;
+    const LineShape& shape(size_t line) const;
+    int64_t depthBefore(size_t line) const;
+
+    /**
+     * @brief First line after @p line whose shape satisfies @p hit, given
+     * the bracket depth at its start. Chunks are skipped by @p chunkMayHit
+     * on their summary. Returns lineCount() if none.
+     */
+    template <typename LineHit, typename ChunkHit>
+    size_t findAfter(size_t line, LineHit hit, ChunkHit chunkMayHit) const;
+
+    template <typename ChunkHit>
+    size_t findChunk(size_t node, size_t lo, size_t hi, size_t from, int64_t& depth, ChunkHit& chunkMayHit) const;
+
+    void rebuildHidden();
+
+    Mode mode;
+    std::vector<std::vector<LineShape>> chunks;
+    std::vector<LineShape> scratch;  ///< Damaged lines' shapes, reused across edits.
+    std::vector<Summary> tree;  ///< Segment tree over chunks; leaves start at `leaves`.
+    size_t leaves = 1;
+
+    std::vector<size_t> folded;       ///< Headers of closed folds, sorted.
+    std::vector<FoldRange> hidden;
+    std::vector<size_t> hiddenBefore;  ///< Lines hidden by hidden[0, i); one longer than hidden.
+};
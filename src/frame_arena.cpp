@@ -0,0 +1,42 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t chunkSize, size_t retainLimit)
+    : chunkSize(chunkSize), retainLimit(std::max(chunkSize, retainLimit)) {}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+    if (!chunks.empty()) {
+        Chunk& chunk = chunks.back();
+        uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data.get());
+        size_t offset = static_cast<size_t>(((base + used + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base);
+        if (offset + bytes <= chunk.size) {
+            used = offset + bytes;
+            return chunk.data.get() + offset;
+        }
+    }
+
+    size_t size = std::max(chunkSize, bytes + alignment);
+    chunks.push_back({std::unique_ptr<char[]>(new char[size]), size});
+    used = 0;
+    return allocate(bytes, alignment);
+}
+
+void FrameArena::reset() {
+    size_t total = capacity();
+    if (chunks.size() > 1 || total > retainLimit) {
+        total = std::min(total, retainLimit);
+        chunks.clear();
+        chunks.push_back({std::unique_ptr<char[]>(new char[total]), total});
+    }
+    used = 0;
+}
+
+size_t FrameArena::capacity() const {
+    size_t total = 0;
+    for (const Chunk& chunk : chunks) {
+        total += chunk.size;
+    }
+    return total;
+}
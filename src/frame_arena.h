@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Bump allocator for scratch memory that lives for one edit or frame.
+ *
+ * allocate() hands out memory from the current chunk and reset() releases
+ * everything at once. When a frame needed more than one chunk, reset()
+ * replaces them with a single chunk of the combined size, so after the
+ * first few frames a steady workload allocates nothing. Memory past the
+ * retain limit is freed on reset() instead, so one oversized frame (a
+ * large paste) does not pin its peak for the arena's lifetime. Nothing
+ * allocated here is destroyed; use it for trivially destructible data
+ * only.
+ */
+class FrameArena {
+public:
+    /**
+     * @param chunkSize Size of the chunks allocated as needed.
+     * @param retainLimit Most chunk memory kept across reset(); at least
+     * one chunk.
+     */
+    explicit FrameArena(size_t chunkSize = 64 * 1024, size_t retainLimit = size_t(1) << 20);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /**
+     * @brief Returns @p bytes of uninitialised memory aligned to
+     * @p alignment (a power of two), valid until the next reset().
+     */
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * @brief Releases every allocation, keeping up to the retain limit of
+     * memory for reuse.
+     */
+    void reset();
+
+    /**
+     * @brief Bytes of chunk memory currently held.
+     */
+    size_t capacity() const;
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t chunkSize;
+    size_t retainLimit;
+    size_t used = 0;  ///< Bytes taken from chunks.back().
+};
@@ -4,14 +4,19 @@ import compression from 'compression';
 import rateLimit from 'express-rate-limit';
 import { fileURLToPath } from 'url';
 import { dirname, join } from 'path';
+import { attachCollabRelay } from './collabRelay.js';
+import { fileRouter } from './routes/file.js';
+import { fileToken, requireToken } from './middleware/requireToken.js';
 
 const __dirname = dirname(fileURLToPath(import.meta.url));
 const app = express();
 const port = process.env.PORT || 3000;
+// Loopback unless HOST says otherwise: the file routes and the collab relay
+// hand out the user's files to whoever holds the token.
+const host = process.env.HOST || '127.0.0.1';
 
 // Middleware
 app.use(express.json());
-app.use(cors());
 app.use(compression());
 
 // Rate limiting
@@ -19,6 +24,17 @@ const limiter = rateLimit({
   windowMs: 15 * 60 * 1000, // 15 minutes
   max: 100 // limit each IP to 100 requests per windowMs
 });
+// Delta sync posts once per burst of typing, so file I/O has its own budget.
+const fileLimiter = rateLimit({
+  windowMs: 60 * 1000,
+  max: 600
+});
+
+// File I/O is served by the native file service; see controllers/FileController.js.
+// Same-origin only (mounted ahead of cors()) and behind the token.
+app.use('/api/file', fileLimiter, requireToken, fileRouter);
+
+app.use(cors());
 app.use('/api', limiter);
 
 // Serve static files
@@ -40,7 +56,14 @@ app.use((err, req, res, next) => {
   res.status(500).json({ error: 'Something went wrong!' });
 });
 
-app.listen(port, '0.0.0.0', () => {
-  console.log(`Server running on http://localhost:${port}`);
-  console.log(`Access from other devices using your computer's IP address`);
+const server = app.listen(port, host, () => {
+  console.log(`Server running on http://${host}:${port}`);
+  console.log(`Open files with http://localhost:${port}/?token=${fileToken}&file=<path>`);
+  console.log(`Share a document with http://localhost:${port}/?token=${fileToken}&doc=<name>`);
+  if (host === '127.0.0.1') {
+    console.log('Set HOST=0.0.0.0 to accept other devices');
+  }
 });
+
+// Collaborative editing relay (ws://host/collab/<docId>)
+attachCollabRelay(server);
@@ -0,0 +1,233 @@
+#include "large_file_view.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+LargeFileView::~LargeFileView() {
+    close();
+}
+
+bool LargeFileView::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+    filePath = path;
+    watchSize();
+
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        blockFirstLine.clear();
+        blockFirstLine.reserve((file.size() >> kBlockShift) + 1);
+        lineCheckpoints.assign(1, 0);
+        linesSeen = 1;
+    }
+    cancelIndexing.store(false);
+    indexed.store(false);
+    indexedUpTo.store(0);
+    indexer = std::thread(&LargeFileView::buildIndex, this);
+    return true;
+}
+
+void LargeFileView::close() {
+    cancelIndexing.store(true);
+    if (indexer.joinable()) {
+        indexer.join();
+    }
+    file.close();
+    filePath.clear();
+#ifndef _WIN32
+    if (sizeFd >= 0) {
+        ::close(sizeFd);
+        sizeFd = -1;
+    }
+#endif
+    indexed.store(false);
+    indexedUpTo.store(0);
+}
+
+void LargeFileView::buildIndex() {
+    const size_t size = file.size();
+    const size_t step = size_t(1) << kBlockShift;
+    for (size_t start = 0; start < size; start += step) {
+        if (cancelIndexing.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (readableSize() < std::min(size, start + step)) {
+            return;  // Truncated: the index is rebuilt when the file is reopened
+        }
+        indexRange(start, std::min(size, start + step));
+    }
+    indexed.store(true, std::memory_order_release);
+}
+
+void LargeFileView::indexRange(size_t start, size_t end) {
+    const char* data = file.data();
+    size_t line = linesSeen - 1;  // Only this thread writes linesSeen.
+    std::vector<size_t> newBlocks;
+    std::vector<size_t> newCheckpoints;
+
+    size_t nextBlock = 0;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        nextBlock = blockFirstLine.size();
+    }
+    for (size_t p = start; p < end;) {
+        // Record the line number at each block start crossed along the way.
+        while ((nextBlock << kBlockShift) <= p) {
+            newBlocks.push_back(line);
+            ++nextBlock;
+        }
+        size_t blockEnd = std::min(end, nextBlock << kBlockShift);
+        const void* nl = std::memchr(data + p, '\n', blockEnd - p);
+        if (!nl) {
+            p = blockEnd;
+            continue;
+        }
+        p = static_cast<size_t>(static_cast<const char*>(nl) - data) + 1;
+        if (++line % kLinesPerCheckpoint == 0) {
+            newCheckpoints.push_back(p);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        blockFirstLine.insert(blockFirstLine.end(), newBlocks.begin(), newBlocks.end());
+        lineCheckpoints.insert(lineCheckpoints.end(), newCheckpoints.begin(), newCheckpoints.end());
+        linesSeen = line + 1;
+    }
+    indexedUpTo.store(end, std::memory_order_release);
+}
+
+bool LargeFileView::extend() {
+    if (!isIndexed()) {
+        return false;  // The initial scan will see the new bytes anyway.
+    }
+
+    const size_t oldSize = file.size();
+    MappedFile grown;
+    if (!grown.open(filePath) || grown.size() == oldSize) {
+        return false;
+    }
+    if (grown.size() < oldSize) {
+        std::string reopenPath = filePath;
+        return open(reopenPath);
+    }
+
+    file = std::move(grown);
+    watchSize();
+    if (readableSize() < file.size()) {
+        return true;  // Truncated again meanwhile; the next extend() reopens it
+    }
+    indexRange(oldSize, file.size());
+    return true;
+}
+
+size_t LargeFileView::readableSize() const {
+#ifndef _WIN32
+    struct stat st;
+    if (sizeFd >= 0 && ::fstat(sizeFd, &st) == 0) {
+        return std::min(file.size(), static_cast<size_t>(st.st_size));
+    }
+#endif
+    return file.size();  // Read into memory, or unknown
+}
+
+void LargeFileView::watchSize() {
+#ifndef _WIN32
+    if (sizeFd >= 0) {
+        ::close(sizeFd);
+    }
+    sizeFd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+size_t LargeFileView::lineCount() const {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    return linesSeen;
+}
+
+size_t LargeFileView::lineOfOffset(size_t offset) const {
+    offset = std::min(offset, indexedBytes());
+    size_t block = offset >> kBlockShift;
+    size_t line = 0;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        if (blockFirstLine.empty()) {
+            return 0;
+        }
+        block = std::min(block, blockFirstLine.size() - 1);
+        line = blockFirstLine[block];
+    }
+
+    const char* data = file.data();
+    const char* p = data + (block << kBlockShift);
+    const char* end = data + std::max(block << kBlockShift, std::min(offset, readableSize()));
+    while (p < end) {
+        const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        if (!nl) {
+            break;
+        }
+        p = static_cast<const char*>(nl) + 1;
+        ++line;
+    }
+    return line;
+}
+
+size_t LargeFileView::offsetOfLine(size_t line) const {
+    size_t offset = 0;
+    size_t skip = 0;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        line = std::min(line, linesSeen - 1);
+        offset = lineCheckpoints[std::min(line / kLinesPerCheckpoint, lineCheckpoints.size() - 1)];
+        skip = line - (line / kLinesPerCheckpoint) * kLinesPerCheckpoint;
+    }
+
+    const char* data = file.data();
+    const size_t size = readableSize();
+    offset = std::min(offset, size);
+    for (; skip > 0 && offset < size; --skip) {
+        const void* nl = std::memchr(data + offset, '\n', size - offset);
+        if (!nl) {
+            return size;
+        }
+        offset = static_cast<size_t>(static_cast<const char*>(nl) - data) + 1;
+    }
+    return offset;
+}
+
+size_t LargeFileView::lineStartAtOrBefore(size_t offset) const {
+    const char* data = file.data();
+    offset = std::min(offset, readableSize());
+    while (offset > 0 && data[offset - 1] != '\n') {
+        --offset;
+    }
+    return offset;
+}
+
+std::vector<std::string_view> LargeFileView::linesFrom(size_t offset, size_t count) const {
+    std::vector<std::string_view> result;
+    const char* data = file.data();
+    const size_t size = readableSize();
+    while (result.size() < count && offset <= size) {
+        const void* nl = offset < size ? std::memchr(data + offset, '\n', size - offset) : nullptr;
+        size_t end = nl ? static_cast<size_t>(static_cast<const char*>(nl) - data) : size;
+        result.emplace_back(data + offset, end - offset);
+        if (!nl) {
+            break;
+        }
+        offset = end + 1;
+    }
+    return result;
+}
+
+std::vector<std::string_view> LargeFileView::lines(size_t firstLine, size_t count) const {
+    return linesFrom(offsetOfLine(firstLine), count);
+}
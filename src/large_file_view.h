@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+
+/**
+ * @brief Read-only, streaming window over a file too large to load.
+ *
+ * The file is mmap'd and never copied. A background thread scans it once and
+ * records a sparse checkpoint index: the line number at the start of every
+ * fixed-size byte block and the byte offset of every Nth line. Translating
+ * between offsets and line numbers then costs one table lookup plus a scan
+ * bounded by the checkpoint spacing, independent of file size.
+ *
+ * A file truncated in place, as copytruncate log rotation does, leaves
+ * the mapping longer than the file, and touching the pages past its new
+ * end raises SIGBUS. Every read is therefore clamped to readableSize()
+ * until open() or extend() maps the file again.
+ */
+class LargeFileView {
+public:
+    static constexpr size_t kBlockShift = 16;         ///< 64 KiB byte blocks.
+    static constexpr size_t kLinesPerCheckpoint = 1024;
+
+    LargeFileView() = default;
+    ~LargeFileView();
+
+    LargeFileView(const LargeFileView&) = delete;
+    LargeFileView& operator=(const LargeFileView&) = delete;
+
+    /**
+     * @brief Maps the file and starts indexing it in the background.
+     * @return False if the file cannot be mapped.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Stops indexing and unmaps the file.
+     */
+    void close();
+
+    size_t size() const { return file.size(); }
+
+    /**
+     * @brief Bytes of the mapping the file still holds: size(), or less
+     * once the file has been truncated since it was mapped.
+     */
+    size_t readableSize() const;
+    const std::string& path() const { return filePath; }
+
+    /**
+     * @brief Picks up bytes appended since the file was mapped: remaps it and
+     * indexes only the new range. Call from the thread that reads the view,
+     * since remapping invalidates earlier line views. A file that shrank is
+     * reopened from scratch.
+     * @return True if the file changed.
+     */
+    bool extend();
+
+    /**
+     * @brief True once the whole file has been indexed.
+     */
+    bool isIndexed() const { return indexed.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Bytes indexed so far; offsets below this have known line numbers.
+     */
+    size_t indexedBytes() const { return indexedUpTo.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Number of lines seen so far (the final count once indexed).
+     */
+    size_t lineCount() const;
+
+    /**
+     * @brief Line containing @p offset; offsets past the indexed range clamp
+     * to the last indexed line.
+     */
+    size_t lineOfOffset(size_t offset) const;
+
+    /**
+     * @brief Byte offset where @p line starts, clamped to the indexed range.
+     */
+    size_t offsetOfLine(size_t line) const;
+
+    /**
+     * @brief Start of the line containing @p offset, found by scanning
+     * backwards; usable before the index reaches @p offset.
+     */
+    size_t lineStartAtOrBefore(size_t offset) const;
+
+    /**
+     * @brief Up to @p count lines starting at byte offset @p offset, which
+     * should be a line start. Views point into the mapping.
+     */
+    std::vector<std::string_view> linesFrom(size_t offset, size_t count) const;
+
+    /**
+     * @brief Up to @p count lines starting at line @p firstLine.
+     */
+    std::vector<std::string_view> lines(size_t firstLine, size_t count) const;
+
+private:
+    void buildIndex();
+    void indexRange(size_t start, size_t end);
+
+    /**
+     * @brief Opens the descriptor readableSize() checks on filePath.
+     */
+    void watchSize();
+
+    MappedFile file;
+    std::string filePath;
+    int sizeFd = -1;  ///< The mapped file, for readableSize().
+    std::thread indexer;
+    std::atomic<bool> cancelIndexing{false};
+    std::atomic<bool> indexed{false};
+    std::atomic<size_t> indexedUpTo{0};
+
+    mutable std::mutex indexMutex;
+    std::vector<size_t> blockFirstLine;   ///< Line number at the start of each byte block.
+    std::vector<size_t> lineCheckpoints;  ///< Offset of every kLinesPerCheckpoint-th line.
+    size_t linesSeen = 0;
+};
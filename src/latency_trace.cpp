@@ -0,0 +1,279 @@
+#include "latency_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define SNSUPEAR_TRACE_TSC 1
+#endif
+
+namespace {
+
+constexpr size_t kRingCapacity = size_t(1) << 13;
+constexpr size_t kLatencySamples = 1024;
+
+struct TraceRing {
+    uint32_t thread = 0;
+    std::atomic<bool> inUse{true};
+    std::atomic<uint64_t> head{0};  ///< Events ever written.
+    TraceEvent slots[kRingCapacity];
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceRing>> rings;
+    uint32_t nextThread = 1;
+    uint32_t uiThread = 0;
+
+    std::mutex latencyMutex;
+    uint64_t latencies[kLatencySamples] = {};  ///< Ticks, rolling.
+    size_t latencyCount = 0;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();  // Outlives thread_local owners at exit.
+    return *instance;
+}
+
+// Hands the ring back for reuse when its thread exits; the events stay
+// readable until another thread takes it over.
+struct RingOwner {
+    TraceRing* ring = nullptr;
+    ~RingOwner() {
+        if (ring) {
+            ring->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local RingOwner localRing;
+thread_local uint64_t currentKeystroke = 0;
+thread_local uint64_t keystrokeStart = 0;
+std::atomic<uint64_t> nextKeystroke{1};
+
+TraceRing& ringForThisThread() {
+    if (localRing.ring) {
+        return *localRing.ring;
+    }
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const std::unique_ptr<TraceRing>& ring : reg.rings) {
+        if (!ring->inUse.load(std::memory_order_acquire)) {
+            ring->inUse.store(true, std::memory_order_relaxed);
+            ring->head.store(0, std::memory_order_relaxed);
+            localRing.ring = ring.get();
+            break;
+        }
+    }
+    if (!localRing.ring) {
+        reg.rings.push_back(std::make_unique<TraceRing>());
+        localRing.ring = reg.rings.back().get();
+    }
+    localRing.ring->thread = reg.nextThread++;
+    return *localRing.ring;
+}
+
+struct ClockAnchor {
+    uint64_t ticks;
+    std::chrono::steady_clock::time_point time;
+};
+
+const ClockAnchor& anchor() {
+    static const ClockAnchor value{LatencyTrace::now(), std::chrono::steady_clock::now()};
+    return value;
+}
+
+// Forces the anchor at static-init time so calibration spans the session.
+const ClockAnchor& anchorAtStartup = anchor();
+
+double ticksPerMicrosecond() {
+#ifdef SNSUPEAR_TRACE_TSC
+    static std::atomic<double> calibrated{0.0};
+    double rate = calibrated.load(std::memory_order_relaxed);
+    if (rate > 0) {
+        return rate;
+    }
+    // The TSC rate is measured against steady_clock over everything since
+    // startup; once that baseline is long enough the figure is kept.
+    uint64_t ticks = LatencyTrace::now();
+    auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - anchor().time).count();
+    if (elapsed <= 0) {
+        return 1000.0;
+    }
+    rate = static_cast<double>(ticks - anchor().ticks) / elapsed;
+    if (elapsed > 200000) {
+        calibrated.store(rate, std::memory_order_relaxed);
+    }
+    return rate;
+#else
+    return 1000.0;  // steady_clock nanoseconds
+#endif
+}
+
+} // namespace
+
+const char* traceStageName(TraceStage stage) {
+    switch (stage) {
+    case TraceStage::Keystroke: return "keystroke";
+    case TraceStage::Edit: return "edit";
+    case TraceStage::Highlight: return "highlight";
+    case TraceStage::Layout: return "layout";
+    case TraceStage::Paint: return "paint";
+    case TraceStage::Completion: return "completion";
+    case TraceStage::Network: return "network";
+    }
+    return "unknown";
+}
+
+uint64_t LatencyTrace::now() {
+#ifdef SNSUPEAR_TRACE_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+#endif
+}
+
+double LatencyTrace::toMicroseconds(uint64_t ticks) {
+    return static_cast<double>(ticks) / ticksPerMicrosecond();
+}
+
+void LatencyTrace::record(TraceStage stage, const char* name, uint64_t start, uint64_t end) {
+    TraceRing& ring = ringForThisThread();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    TraceEvent& slot = ring.slots[head & (kRingCapacity - 1)];
+    slot.name = name;
+    slot.stage = stage;
+    slot.thread = ring.thread;
+    slot.keystroke = currentKeystroke;
+    slot.start = start;
+    slot.end = end;
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void LatencyTrace::beginKeystroke() {
+    if (currentKeystroke != 0) {
+        return;
+    }
+    keystrokeStart = now();
+    currentKeystroke = nextKeystroke.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyTrace::endKeystroke() {
+    if (currentKeystroke == 0) {
+        return;
+    }
+    uint64_t end = now();
+    record(TraceStage::Keystroke, "keystroke", keystrokeStart, end);
+    currentKeystroke = 0;
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.latencyMutex);
+    reg.latencies[reg.latencyCount++ % kLatencySamples] = end - keystrokeStart;
+    reg.uiThread = localRing.ring->thread;
+}
+
+bool LatencyTrace::keystrokePending() {
+    return currentKeystroke != 0;
+}
+
+LatencyPercentiles LatencyTrace::keystrokeLatency() {
+    std::vector<uint64_t> samples;
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.latencyMutex);
+        size_t count = std::min(reg.latencyCount, kLatencySamples);
+        samples.assign(reg.latencies, reg.latencies + count);
+    }
+    LatencyPercentiles result;
+    result.samples = samples.size();
+    if (samples.empty()) {
+        return result;
+    }
+    auto percentile = [&samples](double p) {
+        auto nth = samples.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(samples.size() - 1));
+        std::nth_element(samples.begin(), nth, samples.end());
+        return toMicroseconds(*nth) / 1000.0;
+    };
+    result.p50Ms = percentile(0.50);
+    result.p99Ms = percentile(0.99);
+    return result;
+}
+
+std::vector<TraceEvent> LatencyTrace::snapshot() {
+    std::vector<TraceEvent> events;
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const std::unique_ptr<TraceRing>& ring : reg.rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t first = head > kRingCapacity ? head - kRingCapacity : 0;
+        size_t copied = events.size();
+        for (uint64_t i = first; i < head; ++i) {
+            events.push_back(ring->slots[i & (kRingCapacity - 1)]);
+        }
+        // The writer kept going while we copied: slots it lapped, plus the
+        // one it may be writing right now, are garbage and go.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t reusable = ring->head.load(std::memory_order_relaxed) + 1;
+        if (reusable > first + kRingCapacity) {
+            size_t lapped = static_cast<size_t>(std::min(reusable - kRingCapacity - first, head - first));
+            events.erase(events.begin() + static_cast<std::ptrdiff_t>(copied),
+                         events.begin() + static_cast<std::ptrdiff_t>(copied + lapped));
+        }
+    }
+    return events;
+}
+
+bool LatencyTrace::exportChromeTrace(const std::string& path) {
+    std::vector<TraceEvent> events = snapshot();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    uint32_t uiThread;
+    {
+        std::lock_guard<std::mutex> lock(registry().latencyMutex);
+        uiThread = registry().uiThread;
+    }
+    std::vector<uint32_t> threads;
+    for (const TraceEvent& event : events) {
+        threads.push_back(event.thread);
+    }
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+    const uint64_t origin = anchor().ticks;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (uint32_t thread : threads) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+            << ",\"args\":{\"name\":\"" << (thread == uiThread ? std::string("UI") : "thread " + std::to_string(thread))
+            << "\"}}";
+        first = false;
+    }
+    out.precision(3);
+    out << std::fixed;
+    for (const TraceEvent& event : events) {
+        out << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"" << traceStageName(event.stage)
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << toMicroseconds(event.start > origin ? event.start - origin : 0)
+            << ",\"dur\":" << toMicroseconds(event.end - event.start);
+        if (event.keystroke != 0) {
+            out << ",\"args\":{\"keystroke\":" << event.keystroke << "}";
+        }
+        out << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
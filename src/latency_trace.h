@@ -0,0 +1,129 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Where a keystroke's time goes, in the order it is spent.
+enum class TraceStage : uint8_t {
+    Keystroke,   ///< Whole key press to the end of the next paint.
+    Edit,        ///< Key event dispatch, including the stages it triggers.
+    Highlight,
+    Layout,
+    Paint,
+    Completion,  ///< Debounce wait before a completion request.
+    Network,
+};
+
+const char* traceStageName(TraceStage stage);
+
+// One finished span. `name` must be a string literal or otherwise outlive
+// the trace.
+struct TraceEvent {
+    const char* name;
+    TraceStage stage;
+    uint32_t thread;
+    uint64_t keystroke;  ///< Keystroke the span belongs to, 0 if none.
+    uint64_t start;      ///< LatencyTrace::now() ticks.
+    uint64_t end;
+};
+
+struct LatencyPercentiles {
+    double p50Ms = 0;
+    double p99Ms = 0;
+    size_t samples = 0;
+};
+
+/**
+ * @brief Process-wide span recorder for keystroke-to-paint latency.
+ *
+ * Each thread appends to its own fixed-size ring, so recording is a couple
+ * of timestamp reads and a store with no locks or allocation; old events
+ * are overwritten. Readers (export, HUD) copy the rings without stopping
+ * writers and drop any slot that was overwritten while being copied.
+ *
+ * Timestamps are TSC ticks on x86-64 and steady_clock nanoseconds
+ * elsewhere. Build with SNSUPEAR_TRACE_DISABLED to compile every
+ * SNSUPEAR_TRACE_* macro out.
+ */
+class LatencyTrace {
+public:
+    static uint64_t now();
+
+    /**
+     * @brief Converts a tick difference to microseconds.
+     */
+    static double toMicroseconds(uint64_t ticks);
+
+    static void record(TraceStage stage, const char* name, uint64_t start, uint64_t end);
+
+    /**
+     * @brief Starts timing a keystroke on the calling (UI) thread; spans
+     * recorded on that thread until endKeystroke() are tagged with it.
+     * A keystroke already in progress is kept, so key repeat measures from
+     * the first press that has not been painted yet.
+     */
+    static void beginKeystroke();
+
+    /**
+     * @brief Ends the current keystroke, if any, recording its span and
+     * adding its latency to the rolling percentiles.
+     */
+    static void endKeystroke();
+
+    static bool keystrokePending();
+
+    /**
+     * @brief p50/p99 over the most recent keystrokes.
+     */
+    static LatencyPercentiles keystrokeLatency();
+
+    /**
+     * @brief Copies every ring, oldest event first per thread.
+     */
+    static std::vector<TraceEvent> snapshot();
+
+    /**
+     * @brief Writes the recorded spans as Chrome trace event JSON, which
+     * chrome://tracing and ui.perfetto.dev both open.
+     * @return False if the file cannot be written.
+     */
+    static bool exportChromeTrace(const std::string& path);
+};
+
+/**
+ * @brief Records a span from construction to destruction.
+ */
+class TraceScope {
+public:
+    TraceScope(TraceStage stage, const char* name) : stage(stage), name(name), start(LatencyTrace::now()) {}
+    ~TraceScope() { LatencyTrace::record(stage, name, start, LatencyTrace::now()); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TraceStage stage;
+    const char* name;
+    uint64_t start;
+};
+
+#define SNSUPEAR_TRACE_CONCAT_(a, b) a##b
+#define SNSUPEAR_TRACE_CONCAT(a, b) SNSUPEAR_TRACE_CONCAT_(a, b)
+
+#ifndef SNSUPEAR_TRACE_DISABLED
+#define SNSUPEAR_TRACE_SCOPE(stage, name) \
+    TraceScope SNSUPEAR_TRACE_CONCAT(traceScope_, __LINE__)(TraceStage::stage, name)
+#define SNSUPEAR_TRACE_NOW() LatencyTrace::now()
+#define SNSUPEAR_TRACE_RECORD(stage, name, start) \
+    LatencyTrace::record(TraceStage::stage, name, start, LatencyTrace::now())
+#define SNSUPEAR_TRACE_KEYSTROKE_BEGIN() LatencyTrace::beginKeystroke()
+#define SNSUPEAR_TRACE_KEYSTROKE_END() LatencyTrace::endKeystroke()
+#else
+#define SNSUPEAR_TRACE_SCOPE(stage, name) ((void)0)
+#define SNSUPEAR_TRACE_NOW() uint64_t(0)
+#define SNSUPEAR_TRACE_RECORD(stage, name, start) ((void)(start))
+#define SNSUPEAR_TRACE_KEYSTROKE_BEGIN() ((void)0)
+#define SNSUPEAR_TRACE_KEYSTROKE_END() ((void)0)
+#endif
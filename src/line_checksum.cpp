@@ -0,0 +1,104 @@
+#include "line_checksum.h"
+
+#include <algorithm>
+
+uint32_t hashLine(std::string_view line) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : line) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
+
+void LineChecksum::reset(const TextBuffer& buffer) {
+    chunks.assign(1, Chunk());
+    total = 0;
+    sum = 0;
+    for (size_t i = 0; i < buffer.getLineCount(); ++i) {
+        if (chunks.back().hashes.size() == kChunkLines) {
+            chunks.emplace_back();
+        }
+        const uint32_t hash = hashLine(buffer.lineView(i));
+        chunks.back().hashes.push_back(hash);
+        chunks.back().total += hash;
+        total += hash;
+        sum += static_cast<uint32_t>(i + 1) * hash;
+    }
+}
+
+void LineChecksum::update(const TextBuffer& buffer, const DamageRegion& damage) {
+    const size_t first = damage.firstLine;
+
+    // Chunk holding the first damaged line, and the hashes before it.
+    size_t chunk = 0;
+    size_t at = first;
+    uint32_t before = 0;
+    while (chunk + 1 < chunks.size() && at >= chunks[chunk].hashes.size()) {
+        at -= chunks[chunk].hashes.size();
+        before += chunks[chunk].total;
+        ++chunk;
+    }
+    for (size_t k = 0; k < at; ++k) {
+        before += chunks[chunk].hashes[k];
+    }
+
+    // The replaced lines leave the sum; chunks they emptied are dropped,
+    // except the first, which takes the new lines.
+    size_t line = first;
+    size_t remaining = damage.oldLineCount;
+    for (size_t c = chunk, from = at; remaining > 0 && c < chunks.size(); ++c, from = 0) {
+        std::vector<uint32_t>& hashes = chunks[c].hashes;
+        const size_t taken = std::min(remaining, hashes.size() - from);
+        for (size_t k = from; k < from + taken; ++k, ++line) {
+            sum -= static_cast<uint32_t>(line + 1) * hashes[k];
+            chunks[c].total -= hashes[k];
+            total -= hashes[k];
+        }
+        hashes.erase(hashes.begin() + static_cast<std::ptrdiff_t>(from),
+                     hashes.begin() + static_cast<std::ptrdiff_t>(from + taken));
+        remaining -= taken;
+    }
+    chunks.erase(std::remove_if(chunks.begin() + static_cast<std::ptrdiff_t>(chunk) + 1, chunks.end(),
+                                [](const Chunk& c) { return c.hashes.empty(); }),
+                 chunks.end());
+
+    // Lines after the damage keep their hashes but move by the line delta,
+    // which changes their weight by exactly delta * hash (mod 2^32).
+    const uint32_t tail = total - before;
+    sum += static_cast<uint32_t>(damage.newLineCount - damage.oldLineCount) * tail;
+
+    std::vector<uint32_t>& hashes = chunks[chunk].hashes;
+    hashes.insert(hashes.begin() + static_cast<std::ptrdiff_t>(at), damage.newLineCount, 0);
+    for (size_t k = 0; k < damage.newLineCount; ++k) {
+        const uint32_t hash = hashLine(buffer.lineView(first + k));
+        hashes[at + k] = hash;
+        chunks[chunk].total += hash;
+        total += hash;
+        sum += static_cast<uint32_t>(first + k + 1) * hash;
+    }
+    rebalance(chunk);
+}
+
+// Splits a chunk grown past twice the target size and merges one shrunk
+// below half of it into its successor.
+void LineChecksum::rebalance(size_t chunk) {
+    if (chunks[chunk].hashes.size() < kChunkLines / 2 && chunk + 1 < chunks.size()) {
+        Chunk& next = chunks[chunk + 1];
+        chunks[chunk].hashes.insert(chunks[chunk].hashes.end(), next.hashes.begin(), next.hashes.end());
+        chunks[chunk].total += next.total;
+        chunks.erase(chunks.begin() + static_cast<std::ptrdiff_t>(chunk) + 1);
+    }
+    if (chunks[chunk].hashes.size() <= 2 * kChunkLines) {
+        return;
+    }
+    std::vector<uint32_t> all = std::move(chunks[chunk].hashes);
+    std::vector<Chunk> pieces((all.size() + kChunkLines - 1) / kChunkLines);
+    for (size_t k = 0; k < all.size(); ++k) {
+        Chunk& piece = pieces[k / kChunkLines];
+        piece.hashes.push_back(all[k]);
+        piece.total += all[k];
+    }
+    chunks.erase(chunks.begin() + static_cast<std::ptrdiff_t>(chunk));
+    chunks.insert(chunks.begin() + static_cast<std::ptrdiff_t>(chunk), std::make_move_iterator(pieces.begin()),
+                  std::make_move_iterator(pieces.end()));
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "text_buffer.h"
+
+/**
+ * @brief FNV-1a over one line's bytes, without the '\n'.
+ */
+uint32_t hashLine(std::string_view line);
+
+/**
+ * @brief Document checksum kept current from TextBuffer damage.
+ *
+ * The value is sum((i + 1) * hashLine(line i)) mod 2^32 over all lines, so
+ * it is position sensitive yet cheap to maintain: an edit rehashes only the
+ * lines it replaced and shifts the weight of the lines after it by the
+ * change in line count times their hash sum. Hashes are kept in chunks
+ * with per-chunk sums, so an edit costs one step per chunk plus the lines
+ * it touched, not one per line of the document. The web client computes
+ * the same value to confirm a delta landed intact.
+ */
+class LineChecksum {
+public:
+    /**
+     * @brief Rehashes every line of the buffer.
+     */
+    void reset(const TextBuffer& buffer);
+
+    /**
+     * @brief Folds in one change; call from the buffer's change listener.
+     */
+    void update(const TextBuffer& buffer, const DamageRegion& damage);
+
+    uint32_t value() const { return sum; }
+
+private:
+    static constexpr size_t kChunkLines = 512;
+
+    struct Chunk {
+        std::vector<uint32_t> hashes;
+        uint32_t total = 0;  ///< Sum of hashes, mod 2^32.
+    };
+
+    void rebalance(size_t chunk);
+
+    std::vector<Chunk> chunks = std::vector<Chunk>(1);  ///< Never empty.
+    uint32_t total = 0;         ///< Sum of all hashes.
+    uint32_t sum = 0;
+};
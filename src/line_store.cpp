@@ -0,0 +1,129 @@
+#include "line_store.h"
+
+namespace {
+
+// Compaction waits for this much garbage so that small documents are not
+// rebuilt on every few keystrokes.
+constexpr size_t kMinCompactGarbage = 64 * 1024;
+
+template <typename Visit>
+void forEachLine(std::string_view text, Visit visit) {
+    size_t start = 0;
+    for (size_t nl = text.find('\n'); nl != std::string_view::npos; nl = text.find('\n', start)) {
+        visit(text.substr(start, nl - start));
+        start = nl + 1;
+    }
+    visit(text.substr(start));
+}
+
+} // namespace
+
+LineStore::LineStore() {
+    refs.push_back(0);
+    starts.push_back(0);
+}
+
+void LineStore::load(std::string_view text) {
+    size_t lineCount = 0;
+    size_t slabBytes = 0;
+    forEachLine(text, [&](std::string_view line) {
+        ++lineCount;
+        if (line.size() > kInlineCapacity) {
+            slabBytes += line.size();
+        }
+    });
+
+    std::vector<uint64_t>().swap(refs);
+    std::vector<size_t>().swap(starts);
+    std::string().swap(slab);
+    garbage = 0;
+    refs.reserve(lineCount);
+    starts.reserve(lineCount);
+    slab.reserve(slabBytes);
+    forEachLine(text, [this, &text](std::string_view line) {
+        starts.push_back(static_cast<size_t>(line.data() - text.data()));
+        refs.push_back(store(line));
+    });
+    total = text.size();
+}
+
+void LineStore::replace(size_t first, size_t count, std::string_view text) {
+    const size_t oldLength = starts[first + count - 1] + length(first + count - 1) - starts[first];
+
+    // Old lines go first: a line at the end of the slab is truncated away,
+    // and its replacement is then appended at the same place.
+    for (size_t i = first; i < first + count; ++i) {
+        release(i);
+    }
+
+    const size_t newCount = 1 + static_cast<size_t>(std::count(text.begin(), text.end(), '\n'));
+    if (newCount > count) {
+        refs.insert(refs.begin() + first + count, newCount - count, 0);
+        starts.insert(starts.begin() + first + count, newCount - count, 0);
+    } else if (count > newCount) {
+        refs.erase(refs.begin() + first + newCount, refs.begin() + first + count);
+        starts.erase(starts.begin() + first + newCount, starts.begin() + first + count);
+    }
+    size_t line = first;
+    size_t offset = starts[first];
+    forEachLine(text, [&](std::string_view lineText) {
+        starts[line] = offset;
+        refs[line++] = store(lineText);
+        offset += lineText.size() + 1;
+    });
+
+    // Everything after the span moves by the same amount.
+    const size_t delta = text.size() - oldLength;  // Modular; may wrap
+    for (size_t i = first + newCount; i < starts.size(); ++i) {
+        starts[i] += delta;
+    }
+    total += delta;
+
+    if (garbage > kMinCompactGarbage && garbage > slab.size() - garbage) {
+        compact();
+    }
+}
+
+size_t LineStore::memoryUsage() const {
+    return refs.capacity() * sizeof(uint64_t) + starts.capacity() * sizeof(size_t) + slab.capacity();
+}
+
+uint64_t LineStore::store(std::string_view text) {
+    uint64_t ref = 0;
+    if (text.size() <= kInlineCapacity) {
+        if (!text.empty()) {
+            std::memcpy(&ref, text.data(), text.size());
+        }
+    } else {
+        ref = slab.size();
+        slab.append(text.data(), text.size());
+    }
+    return ref;
+}
+
+void LineStore::release(size_t line) {
+    size_t length = this->length(line);
+    if (length <= kInlineCapacity) {
+        return;
+    }
+    if (refs[line] + length == slab.size()) {
+        slab.resize(refs[line]);
+    } else {
+        garbage += length;
+    }
+}
+
+void LineStore::compact() {
+    std::string packed;
+    packed.reserve(slab.size() - garbage);
+    for (size_t i = 0; i < refs.size(); ++i) {
+        size_t length = this->length(i);
+        if (length > kInlineCapacity) {
+            uint64_t offset = packed.size();
+            packed.append(slab, refs[i], length);
+            refs[i] = offset;
+        }
+    }
+    slab.swap(packed);
+    garbage = 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Compact storage and offset index for a document's lines.
+ *
+ * Per line there is a start offset and an 8-byte reference: lines of up to
+ * kInlineCapacity bytes (blank lines, braces, short statements) are stored
+ * in the reference itself, longer ones as an offset into a single slab.
+ * Lengths come from the start offsets, so 16 bytes per line is all the
+ * bookkeeping. Loading puts every long line into the slab in order, so
+ * walking the lines reads memory sequentially.
+ *
+ * Replacing lines appends their new text to the slab and leaves the old
+ * bytes as garbage, except that a line already at the end of the slab is
+ * rewritten in place, so typing on one line does not accumulate garbage.
+ * Once garbage outweighs live text the slab is rebuilt in line order.
+ */
+class LineStore {
+public:
+    static constexpr size_t kInlineCapacity = sizeof(uint64_t);
+
+    /**
+     * @brief Starts with one empty line.
+     */
+    LineStore();
+
+    size_t size() const { return refs.size(); }
+
+    /**
+     * @brief Text of @p line without its '\n'. Invalidated by any change.
+     */
+    std::string_view operator[](size_t line) const {
+        size_t length = this->length(line);
+        const char* data = length <= kInlineCapacity ? reinterpret_cast<const char*>(&refs[line]) : slab.data() + refs[line];
+        return std::string_view(data, length);
+    }
+
+    size_t length(size_t line) const {
+        return (line + 1 < starts.size() ? starts[line + 1] - 1 : total) - starts[line];
+    }
+
+    size_t offsetOf(size_t line) const { return starts[line]; }
+
+    /**
+     * @brief Line containing byte @p offset; offsets at or past the end
+     * give the last line.
+     */
+    size_t lineAt(size_t offset) const {
+        return static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+    }
+
+    /**
+     * @brief Length of the lines joined by '\n'.
+     */
+    size_t totalLength() const { return total; }
+
+    /**
+     * @brief Replaces every line with @p text split on '\n'.
+     */
+    void load(std::string_view text);
+
+    /**
+     * @brief Replaces lines [first, first + count) with @p text split on
+     * '\n'. @p text must not point into this store.
+     */
+    void replace(size_t first, size_t count, std::string_view text);
+
+    /**
+     * @brief Bytes held for the index and the slab, including spare
+     * capacity.
+     */
+    size_t memoryUsage() const;
+
+private:
+    uint64_t store(std::string_view text);
+    void release(size_t line);
+    void compact();
+
+    std::vector<uint64_t> refs;    ///< Inline text, or slab offset if longer.
+    std::vector<size_t> starts;    ///< Offset of each line in the document.
+    std::string slab;
+    size_t total = 0;
+    size_t garbage = 0;  ///< Slab bytes no line refers to.
+};
@@ -0,0 +1,93 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        bytes = std::exchange(other.bytes, nullptr);
+        length = std::exchange(other.length, 0);
+        opened = std::exchange(other.opened, false);
+        mapped = std::exchange(other.mapped, false);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+        void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        madvise(addr, length, MADV_SEQUENTIAL);
+        bytes = static_cast<const char*>(addr);
+        mapped = true;
+    }
+    ::close(fd);
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return false;
+    }
+    length = static_cast<size_t>(in.tellg());
+    if (length > 0) {
+        char* buffer = new char[length];
+        in.seekg(0);
+        in.read(buffer, static_cast<std::streamsize>(length));
+        bytes = buffer;
+    }
+#endif
+
+    opened = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes) {
+#ifndef _WIN32
+        if (mapped) {
+            munmap(const_cast<char*>(bytes), length);
+        } else {
+            delete[] bytes;
+        }
+#else
+        delete[] bytes;
+#endif
+    }
+    bytes = nullptr;
+    length = 0;
+    opened = false;
+    mapped = false;
+}
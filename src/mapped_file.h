@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Read-only view of a file's bytes.
+ *
+ * Uses mmap on POSIX systems so large files are paged in on demand; other
+ * platforms fall back to reading the file into memory.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Maps the given file, replacing any previous mapping.
+     * @param path Path of the file to map.
+     * @return True on success; an empty file maps successfully with size 0.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Releases the mapping.
+     */
+    void close();
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return opened; }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+    bool mapped = false;  ///< True when bytes came from mmap rather than new[].
+};
@@ -0,0 +1,24 @@
+import { randomBytes, timingSafeEqual } from 'crypto';
+
+// Bearer token guarding the file routes. Set SNSUPEAR_TOKEN to fix it;
+// otherwise a random one is made at startup and printed with the URL to
+// open, which hands it to the browser as ?token=.
+export const fileToken = process.env.SNSUPEAR_TOKEN || randomBytes(24).toString('base64url');
+
+const expected = Buffer.from(fileToken);
+
+// Also checked by the collab relay, which gets it as ?token= because
+// browsers cannot set headers on a WebSocket.
+export function tokenMatches(token) {
+  const given = Buffer.from(typeof token === 'string' ? token : '');
+  return given.length === expected.length && timingSafeEqual(given, expected);
+}
+
+export function requireToken(req, res, next) {
+  const match = /^Bearer (.+)$/.exec(req.headers.authorization || '');
+  if (!tokenMatches(match ? match[1] : '')) {
+    res.status(401).json({ error: 'A valid bearer token is required' });
+    return;
+  }
+  next();
+}
@@ -0,0 +1,145 @@
+#include "minimap_tiles.h"
+
+#include <algorithm>
+
+namespace {
+
+uint32_t blend(uint32_t background, uint32_t color, size_t weight, size_t total) {
+    uint32_t result = 0xff000000;
+    for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t b = (background >> shift) & 0xff;
+        uint32_t c = (color >> shift) & 0xff;
+        uint32_t mixed = static_cast<uint32_t>((b * (total - weight) + c * weight) / total);
+        result |= mixed << shift;
+    }
+    return result;
+}
+
+} // namespace
+
+MinimapTiles::MinimapTiles(size_t maxCachedTiles) : maxSlots(std::max<size_t>(1, maxCachedTiles)) {
+    setColors({0xffc0c0c0}, 0xff1e1e1e);
+}
+
+void MinimapTiles::summarize(std::u16string_view text, const MinimapSpan* spans, size_t spanCount,
+                             MinimapCells& cells) {
+    constexpr size_t kColumns = kCells * kCharsPerCell;
+    // A column is at least one character, so only the first kColumns
+    // characters can be drawn.
+    const size_t length = std::min(text.size(), kColumns);
+    uint8_t colors[kColumns] = {};
+    for (size_t i = 0; i < spanCount; ++i) {
+        size_t start = static_cast<size_t>(std::max(0, spans[i].start));
+        size_t end = std::min(length, static_cast<size_t>(std::max(0, spans[i].start + spans[i].length)));
+        for (size_t c = start; c < end; ++c) {
+            colors[c] = spans[i].color;
+        }
+    }
+
+    uint8_t inked[kCells][kCharsPerCell];
+    uint8_t density[kCells] = {};
+    size_t column = 0;
+    for (size_t i = 0; i < length && column < kColumns; ++i) {
+        char16_t c = text[i];
+        if (c == u'\t') {
+            column = (column / kCharsPerCell + 1) * kCharsPerCell;
+            continue;
+        }
+        if (c != u' ' && c != u'\r') {
+            size_t cell = column / kCharsPerCell;
+            inked[cell][density[cell]++] = colors[i];
+        }
+        ++column;
+    }
+
+    for (size_t cell = 0; cell < kCells; ++cell) {
+        // The colour most of the cell's characters have; ties go to the
+        // rightmost, which is usually the token the cell ends in.
+        uint8_t color = 0;
+        size_t best = 0;
+        for (size_t i = 0; i < density[cell]; ++i) {
+            size_t count = static_cast<size_t>(std::count(inked[cell], inked[cell] + density[cell], inked[cell][i]));
+            if (count >= best) {
+                best = count;
+                color = inked[cell][i];
+            }
+        }
+        cells[cell] = static_cast<uint8_t>((color % kColors) << 3 | density[cell]);
+    }
+}
+
+void MinimapTiles::setColors(const std::vector<uint32_t>& palette, uint32_t backgroundColor) {
+    background = backgroundColor | 0xff000000;
+    for (size_t color = 0; color < kColors; ++color) {
+        uint32_t ink = color < palette.size() ? palette[color] : (palette.empty() ? 0xffc0c0c0 : palette[0]);
+        for (size_t density = 0; density <= kCharsPerCell; ++density) {
+            shades[color][density] = blend(background, ink, density, kCharsPerCell);
+        }
+    }
+    invalidateAll();
+}
+
+void MinimapTiles::linesChanged(size_t firstLine, size_t oldCount, size_t newCount) {
+    const size_t firstTile = firstLine / kTileLines;
+    size_t lastTile = kNoTile;  // Lines moved: everything below is stale
+    if (oldCount == newCount) {
+        if (newCount == 0) {
+            return;
+        }
+        lastTile = (firstLine + newCount - 1) / kTileLines;
+    }
+    for (Slot& slot : slots) {
+        if (slot.tile != kNoTile && slot.tile >= firstTile && slot.tile <= lastTile) {
+            slot.tile = kNoTile;
+        }
+    }
+}
+
+void MinimapTiles::invalidateAll() {
+    for (Slot& slot : slots) {
+        slot.tile = kNoTile;
+    }
+}
+
+MinimapTiles::Slot* MinimapTiles::find(size_t index) {
+    for (Slot& slot : slots) {
+        if (slot.tile == index) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+MinimapTiles::Slot& MinimapTiles::claim(size_t index) {
+    Slot* slot = nullptr;
+    if (slots.size() < maxSlots) {
+        slots.emplace_back();
+        slot = &slots.back();
+        slot->pixels.resize(static_cast<size_t>(kTileWidth) * kTileHeight);
+    } else {
+        // Invalidated slots first, then the least recently used.
+        slot = &*std::min_element(slots.begin(), slots.end(), [](const Slot& a, const Slot& b) {
+            return (a.tile == kNoTile ? 0 : a.lastUse) < (b.tile == kNoTile ? 0 : b.lastUse);
+        });
+    }
+    slot->tile = index;
+    slot->lastUse = ++useClock;
+    slot->complete = false;
+    return *slot;
+}
+
+void MinimapTiles::drawLine(uint32_t* pixels, size_t row, const MinimapCells* cells) const {
+    uint32_t* ink = pixels + row * kLinePixels * kTileWidth;
+    if (!cells) {
+        std::fill(ink, ink + kLinePixels * kTileWidth, background);
+        return;
+    }
+    for (size_t cell = 0; cell < kCells; ++cell) {
+        uint8_t value = (*cells)[cell];
+        uint32_t shade = shades[value >> 3][std::min<size_t>(value & 7, kCharsPerCell)];
+        std::fill(ink + cell * kCellPixels, ink + (cell + 1) * kCellPixels, shade);
+    }
+    for (int gap = 1; gap < kLinePixels; ++gap) {
+        std::fill(ink + gap * kTileWidth, ink + (gap + 1) * kTileWidth, background);
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// A highlighted token: [start, start + length) in UTF-16 units of its line.
+struct MinimapSpan {
+    int32_t start;
+    int32_t length;
+    uint8_t color;  ///< Palette index; 0 is plain text.
+};
+
+// One line downsampled to MinimapTiles::kCells cells of kCharsPerCell
+// columns. Each byte is (palette index << 3) | non-blank columns in the cell.
+using MinimapCells = std::array<uint8_t, 32>;
+
+/**
+ * @brief Rasterized minimap tiles over per-line cell summaries.
+ *
+ * The highlighter reduces each line to a MinimapCells as it colours it, so
+ * the minimap never rescans text. Lines are drawn in tiles of kTileLines
+ * lines, kept in a small LRU cache of pixel buffers. A frame only looks up
+ * the few tiles on screen; an edit drops the cached tiles it touched, or
+ * every tile from the edit down if it added or removed lines, and they are
+ * redrawn from the summaries when next shown.
+ */
+class MinimapTiles {
+public:
+    static constexpr size_t kCells = std::tuple_size<MinimapCells>::value;
+    static constexpr size_t kCharsPerCell = 4;
+    static constexpr size_t kColors = 32;
+    static constexpr size_t kTileLines = 128;
+    static constexpr int kLinePixels = 2;  ///< A row of ink and a row of gap.
+    static constexpr int kCellPixels = 2;
+    static constexpr int kTileWidth = static_cast<int>(kCells) * kCellPixels;
+    static constexpr int kTileHeight = static_cast<int>(kTileLines) * kLinePixels;
+
+    explicit MinimapTiles(size_t maxCachedTiles = 32);
+
+    /**
+     * @brief Summarizes a line from its text and the spans it was coloured
+     * with; later spans win where they overlap, as with setFormat. Tabs
+     * advance to the next multiple of kCharsPerCell columns.
+     */
+    static void summarize(std::u16string_view text, const MinimapSpan* spans, size_t spanCount,
+                          MinimapCells& cells);
+
+    /**
+     * @brief Sets the 0xAARRGGBB colour of each palette index and the
+     * background; drops every cached tile.
+     */
+    void setColors(const std::vector<uint32_t>& palette, uint32_t background);
+
+    /**
+     * @brief Lines [firstLine, firstLine + oldCount) became newCount lines.
+     */
+    void linesChanged(size_t firstLine, size_t oldCount, size_t newCount);
+
+    void invalidateAll();
+
+    /**
+     * @brief Pixels of tile @p index, kTileWidth by kTileHeight, row-major.
+     * Drawn on a cache miss by calling @p lineCells(line) for each of its
+     * lines in order; it returns the line's summary or nullptr if there is
+     * none yet. A tile drawn with missing summaries is drawn again on the
+     * next call. Valid until the next call.
+     */
+    template <typename LineCells>
+    const uint32_t* tile(size_t index, size_t lineCount, LineCells&& lineCells);
+
+private:
+    static constexpr size_t kNoTile = static_cast<size_t>(-1);
+
+    struct Slot {
+        size_t tile = kNoTile;
+        uint64_t lastUse = 0;
+        bool complete = false;
+        std::vector<uint32_t> pixels;
+    };
+
+    Slot* find(size_t index);
+    Slot& claim(size_t index);
+    void drawLine(uint32_t* pixels, size_t row, const MinimapCells* cells) const;
+
+    std::vector<Slot> slots;
+    size_t maxSlots;
+    uint64_t useClock = 0;
+    uint32_t background = 0xff000000;
+    uint32_t shades[kColors][kCharsPerCell + 1];  ///< Palette colour at each density over the background.
+};
+
+template <typename LineCells>
+const uint32_t* MinimapTiles::tile(size_t index, size_t lineCount, LineCells&& lineCells) {
+    Slot* slot = find(index);
+    if (slot && slot->complete) {
+        slot->lastUse = ++useClock;
+        return slot->pixels.data();
+    }
+    if (!slot) {
+        slot = &claim(index);
+    }
+    slot->complete = true;
+    const size_t first = index * kTileLines;
+    for (size_t row = 0; row < kTileLines; ++row) {
+        const MinimapCells* cells = nullptr;
+        if (first + row < lineCount) {
+            cells = lineCells(first + row);
+            slot->complete = slot->complete && cells != nullptr;
+        }
+        drawLine(slot->pixels.data(), row, cells);
+    }
+    return slot->pixels.data();
+}
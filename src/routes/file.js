@@ -5,7 +5,7 @@ const router = express.Router();
 const fileController = new FileController();
 
 router.post('/load', fileController.loadFile);
-router.post('/save', fileController.saveFile);
+router.post('/save/:id', express.raw({ type: '*/*', limit: '256mb' }), fileController.saveFile);
 router.get('/content/:id', fileController.getFileContent);
 
-export const fileRouter = router;
\ No newline at end of file
+export const fileRouter = router;
@@ -0,0 +1,526 @@
+#include "search_engine.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "mapped_file.h"
+#include "work_stealing_pool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bytes inspected for a NUL when deciding whether a file is binary.
+constexpr size_t kBinaryProbeBytes = 8192;
+// How much text a worker scans between cancellation checks.
+constexpr size_t kCancelCheckBytes = 1 << 20;
+
+unsigned char lowerAscii(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+
+unsigned char upperAscii(unsigned char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<unsigned char>(c - ('a' - 'A')) : c;
+}
+
+bool isWordChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool looksBinary(const char* data, size_t size) {
+    return std::memchr(data, '\0', std::min(size, kBinaryProbeBytes)) != nullptr;
+}
+
+// Index just past the group or class opening at pattern[open], or npos if
+// it is never closed.
+size_t skipBracketed(const std::string& pattern, size_t open) {
+    int depth = 0;
+    bool inClass = false;
+    for (size_t i = open; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '\\') {
+            ++i;
+        } else if (inClass) {
+            inClass = c != ']';
+            if (!inClass && depth == 0) {
+                return i + 1;
+            }
+        } else if (c == '[') {
+            inClass = true;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')' && --depth == 0) {
+            return i + 1;
+        }
+    }
+    return std::string::npos;
+}
+
+// The longest run of plain characters every match of an ECMAScript pattern
+// must contain, or "" if there is none worth looking for. Conservative:
+// groups, classes and escapes other than escaped punctuation end a run, a
+// quantifier that can repeat zero times takes its character back out, and
+// a top-level alternation means nothing is required at all.
+std::string requiredLiteral(const std::string& pattern, bool caseSensitive) {
+    std::string best;
+    std::string run;
+    auto endRun = [&] {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+    for (size_t i = 0; i < pattern.size();) {
+        char c = pattern[i];
+        if (c == '|') {
+            return std::string();
+        }
+        if (c == '(' || c == '[') {
+            endRun();
+            i = skipBracketed(pattern, i);
+            if (i == std::string::npos) {
+                return std::string();
+            }
+            // A quantifier on the group applies to nothing we kept.
+            continue;
+        }
+        if (c == '*' || c == '?' || c == '{') {
+            if (!run.empty()) {
+                run.pop_back();  // Its character may not be there at all
+            }
+            endRun();
+            if (c == '{') {
+                size_t close = pattern.find('}', i);
+                i = close == std::string::npos ? pattern.size() : close + 1;
+            } else {
+                ++i;
+            }
+            if (i < pattern.size() && pattern[i] == '?') {
+                ++i;  // Lazy
+            }
+            continue;
+        }
+        if (c == '+') {
+            endRun();  // Its character is still required, once
+            ++i;
+            if (i < pattern.size() && pattern[i] == '?') {
+                ++i;
+            }
+            continue;
+        }
+        if (c == '\\') {
+            char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+            if (next != '\0' && !std::isalnum(static_cast<unsigned char>(next))) {
+                run.push_back(next);
+            } else {
+                endRun();  // \d, \b, \1, \x41, ...
+            }
+            i += 2;
+            continue;
+        }
+        if (c == '.' || c == '^' || c == '$' || c == ')' || c == ']' || c == '}') {
+            endRun();
+            ++i;
+            continue;
+        }
+        run.push_back(c);
+        ++i;
+    }
+    endRun();
+    // std::regex folds case through the locale; the matcher folds ASCII only.
+    if (!caseSensitive && std::any_of(best.begin(), best.end(), [](char c) { return (c & 0x80) != 0; })) {
+        return std::string();
+    }
+    return best;
+}
+
+} // namespace
+
+LiteralMatcher::LiteralMatcher(std::string text, bool caseSensitive)
+    : needle(std::move(text)), caseSensitive(caseSensitive)
+{
+    if (!caseSensitive) {
+        for (char& c : needle) {
+            c = static_cast<char>(lowerAscii(static_cast<unsigned char>(c)));
+        }
+    }
+    unsigned char first = needle.empty() ? 0 : static_cast<unsigned char>(needle.front());
+    unsigned char last = needle.empty() ? 0 : static_cast<unsigned char>(needle.back());
+    firstLower = first;
+    lastLower = last;
+    firstUpper = caseSensitive ? first : upperAscii(first);
+    lastUpper = caseSensitive ? last : upperAscii(last);
+}
+
+bool LiteralMatcher::matchesAt(const char* candidate) const {
+    if (caseSensitive) {
+        return std::memcmp(candidate, needle.data(), needle.size()) == 0;
+    }
+    for (size_t i = 0; i < needle.size(); ++i) {
+        if (lowerAscii(static_cast<unsigned char>(candidate[i])) != static_cast<unsigned char>(needle[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t LiteralMatcher::find(std::string_view haystack, size_t from) const {
+    const size_t n = needle.size();
+    if (n == 0 || haystack.size() < n || from > haystack.size() - n) {
+        return std::string_view::npos;
+    }
+
+    const char* base = haystack.data();
+    const size_t lastStart = haystack.size() - n;
+    size_t i = from;
+
+#if defined(__SSE2__)
+    const __m128i first1 = _mm_set1_epi8(static_cast<char>(firstLower));
+    const __m128i first2 = _mm_set1_epi8(static_cast<char>(firstUpper));
+    const __m128i last1 = _mm_set1_epi8(static_cast<char>(lastLower));
+    const __m128i last2 = _mm_set1_epi8(static_cast<char>(lastUpper));
+
+    for (; i + 15 <= lastStart; i += 16) {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + i));
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base + i + n - 1));
+        __m128i headHit = _mm_or_si128(_mm_cmpeq_epi8(head, first1), _mm_cmpeq_epi8(head, first2));
+        __m128i tailHit = _mm_or_si128(_mm_cmpeq_epi8(tail, last1), _mm_cmpeq_epi8(tail, last2));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(headHit, tailHit)));
+        while (mask != 0) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+            if (matchesAt(base + i + bit)) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#else
+    if (caseSensitive) {
+        while (i <= lastStart) {
+            const void* hit = std::memchr(base + i, firstLower, lastStart - i + 1);
+            if (!hit) {
+                return std::string_view::npos;
+            }
+            i = static_cast<size_t>(static_cast<const char*>(hit) - base);
+            if (matchesAt(base + i)) {
+                return i;
+            }
+            ++i;
+        }
+        return std::string_view::npos;
+    }
+#endif
+
+    for (; i <= lastStart; ++i) {
+        unsigned char c = static_cast<unsigned char>(base[i]);
+        if ((c == firstLower || c == firstUpper) && matchesAt(base + i)) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+SearchPattern::SearchPattern(const std::string& pattern, const SearchOptions& options)
+    : options(options), empty(pattern.empty())
+{
+    if (empty) {
+        return;
+    }
+    if (options.regex) {
+        auto flags = std::regex::ECMAScript | std::regex::optimize;
+        if (!options.caseSensitive) {
+            flags |= std::regex::icase;
+        }
+        // Throws std::regex_error for an invalid expression.
+        expression = std::make_unique<std::regex>(pattern, flags);
+        std::string required = requiredLiteral(pattern, options.caseSensitive);
+        if (!required.empty()) {
+            prefilter = std::make_unique<LiteralMatcher>(std::move(required), options.caseSensitive);
+        }
+    } else {
+        if (pattern.find('\n') != std::string::npos) {
+            throw std::invalid_argument("Search text cannot contain a line break");
+        }
+        literal = std::make_unique<LiteralMatcher>(pattern, options.caseSensitive);
+    }
+}
+
+bool SearchPattern::isWordBoundary(std::string_view line, size_t start, size_t length) const {
+    if (!options.wholeWord) {
+        return true;
+    }
+    bool before = start == 0 || !isWordChar(line[start - 1]);
+    bool after = start + length >= line.size() || !isWordChar(line[start + length]);
+    return before && after;
+}
+
+void SearchPattern::findInLine(std::string_view line, size_t lineNumber, std::vector<SearchMatch>& out) const {
+    if (empty) {
+        return;
+    }
+
+    if (literal) {
+        for (size_t pos = literal->find(line); pos != std::string_view::npos;
+             pos = literal->find(line, pos + literal->length())) {
+            if (isWordBoundary(line, pos, literal->length())) {
+                out.push_back({lineNumber, pos, literal->length()});
+            }
+        }
+        return;
+    }
+
+    if (prefilter && prefilter->find(line) == std::string_view::npos) {
+        return;
+    }
+    using Iterator = std::cregex_iterator;
+    for (Iterator it(line.data(), line.data() + line.size(), *expression), end; it != end; ++it) {
+        size_t start = static_cast<size_t>(it->position());
+        size_t length = static_cast<size_t>(it->length());
+        if (length > 0 && isWordBoundary(line, start, length)) {
+            out.push_back({lineNumber, start, length});
+        }
+    }
+}
+
+void SearchPattern::findInText(std::string_view text, std::vector<SearchMatch>& out,
+                               const std::atomic<bool>* cancelled) const {
+    if (empty) {
+        return;
+    }
+
+    if (prefilter) {
+        // Only lines holding the required literal reach the regex.
+        size_t lineNumber = 0;
+        size_t lineStart = 0;
+        size_t nextCheck = kCancelCheckBytes;
+        for (size_t pos = prefilter->find(text); pos != std::string_view::npos;) {
+            while (const void* nl = std::memchr(text.data() + lineStart, '\n', pos - lineStart)) {
+                lineStart = static_cast<size_t>(static_cast<const char*>(nl) - text.data()) + 1;
+                ++lineNumber;
+            }
+            size_t lineEnd = text.find('\n', pos);
+            if (lineEnd == std::string_view::npos) {
+                lineEnd = text.size();
+            }
+            findInLine(text.substr(lineStart, lineEnd - lineStart), lineNumber, out);
+            if (lineEnd >= text.size()) {
+                return;
+            }
+            lineStart = lineEnd + 1;
+            ++lineNumber;
+            if (lineStart >= nextCheck) {
+                if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+                    return;
+                }
+                nextCheck = lineStart + kCancelCheckBytes;
+            }
+            pos = prefilter->find(text, lineStart);
+        }
+        return;
+    }
+
+    if (!literal) {
+        size_t lineNumber = 0;
+        size_t lineStart = 0;
+        size_t nextCheck = kCancelCheckBytes;
+        while (lineStart <= text.size()) {
+            size_t lineEnd = text.find('\n', lineStart);
+            if (lineEnd == std::string_view::npos) {
+                lineEnd = text.size();
+            }
+            findInLine(text.substr(lineStart, lineEnd - lineStart), lineNumber, out);
+            lineStart = lineEnd + 1;
+            ++lineNumber;
+            if (lineStart >= nextCheck) {
+                if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+                    return;
+                }
+                nextCheck = lineStart + kCancelCheckBytes;
+            }
+        }
+        return;
+    }
+
+    // A literal needle is located in the whole image at once; only the
+    // newlines between consecutive candidates are counted.
+    size_t lineNumber = 0;
+    size_t lineStart = 0;
+    size_t counted = 0;
+    size_t nextCheck = kCancelCheckBytes;
+    for (size_t pos = literal->find(text); pos != std::string_view::npos;
+         pos = literal->find(text, pos + literal->length())) {
+        while (counted < pos) {
+            const void* nl = std::memchr(text.data() + counted, '\n', pos - counted);
+            if (!nl) {
+                break;
+            }
+            counted = static_cast<size_t>(static_cast<const char*>(nl) - text.data()) + 1;
+            lineStart = counted;
+            ++lineNumber;
+        }
+        counted = pos;
+
+        size_t lineEnd = text.find('\n', pos);
+        std::string_view line = text.substr(lineStart, (lineEnd == std::string_view::npos ? text.size() : lineEnd) - lineStart);
+        if (isWordBoundary(line, pos - lineStart, literal->length())) {
+            out.push_back({lineNumber, pos - lineStart, literal->length()});
+        }
+
+        if (pos >= nextCheck) {
+            if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+                return;
+            }
+            nextCheck = pos + kCancelCheckBytes;
+        }
+    }
+}
+
+std::vector<SearchMatch> findInBuffer(const TextBuffer& buffer, const std::string& pattern,
+                                      const SearchOptions& options) {
+    std::vector<SearchMatch> matches;
+    SearchPattern compiled(pattern, options);
+    const size_t lineCount = buffer.getLineCount();
+    for (size_t line = 0; line < lineCount; ++line) {
+        compiled.findInLine(buffer.lineView(line), line, matches);
+    }
+    return matches;
+}
+
+size_t replaceAllInBuffer(TextBuffer& buffer, const std::string& pattern, const std::string& replacement,
+                          const SearchOptions& options) {
+    std::vector<SearchMatch> matches = findInBuffer(buffer, pattern, options);
+    if (matches.empty()) {
+        return 0;
+    }
+
+    std::vector<TextEdit> edits;
+    edits.reserve(matches.size());
+    for (const SearchMatch& match : matches) {
+        size_t start = buffer.offsetOfLine(match.line) + match.column;
+        edits.push_back({start, start + match.length, replacement});
+    }
+    buffer.applyEdits(edits);
+    return edits.size();
+}
+
+struct ProjectSearch::Run {
+    Run(const std::string& pattern, const SearchOptions& options)
+        : pattern(pattern, options) {}
+
+    SearchPattern pattern;
+    ProjectSearch::ResultCallback onResult;
+    ProjectSearch::FinishedCallback onFinished;
+    std::atomic<bool> cancelled{false};
+    std::atomic<size_t> outstanding{0};
+    std::mutex resultMutex;  ///< Serialises callbacks so consumers need no locking.
+};
+
+ProjectSearch::ProjectSearch(size_t threadCount)
+    : pool(std::make_unique<WorkStealingPool>(threadCount)) {}
+
+ProjectSearch::~ProjectSearch() {
+    cancel();
+    wait();
+}
+
+void ProjectSearch::start(const std::string& root, const std::string& pattern, const SearchOptions& options,
+                          ResultCallback onResult, FinishedCallback onFinished) {
+    cancel();
+
+    auto run = std::make_shared<Run>(pattern, options);
+    run->onResult = std::move(onResult);
+    run->onFinished = std::move(onFinished);
+    current = run;
+
+    std::error_code ec;
+    bool directory = fs::is_directory(root, ec);
+    run->outstanding.fetch_add(1);
+    pool->submit([this, run, root, directory] {
+        if (directory) {
+            searchDirectory(run, root);
+        } else {
+            searchFile(run, root);
+        }
+        release(run);
+    });
+}
+
+void ProjectSearch::cancel() {
+    if (current) {
+        current->cancelled.store(true, std::memory_order_relaxed);
+    }
+}
+
+void ProjectSearch::wait() {
+    pool->waitIdle();
+}
+
+void ProjectSearch::release(const std::shared_ptr<Run>& run) {
+    if (run->outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1 && run->onFinished) {
+        std::lock_guard<std::mutex> lock(run->resultMutex);
+        run->onFinished(run->cancelled.load());
+    }
+}
+
+void ProjectSearch::searchDirectory(const std::shared_ptr<Run>& run, const std::string& directory) {
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, fs::directory_options::skip_permission_denied, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        if (run->cancelled.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        const fs::path& path = it->path();
+        std::string name = path.filename().string();
+        // Hidden entries (.git and friends) and dependency trees are noise.
+        if (name.empty() || name[0] == '.' || name == "node_modules") {
+            continue;
+        }
+
+        std::error_code statError;
+        bool isDirectory = it->is_directory(statError) && !it->is_symlink(statError);
+        if (!isDirectory && !it->is_regular_file(statError)) {
+            continue;
+        }
+
+        run->outstanding.fetch_add(1, std::memory_order_relaxed);
+        std::string child = path.string();
+        pool->submit([this, run, child, isDirectory] {
+            if (isDirectory) {
+                searchDirectory(run, child);
+            } else {
+                searchFile(run, child);
+            }
+            release(run);
+        });
+    }
+}
+
+void ProjectSearch::searchFile(const std::shared_ptr<Run>& run, const std::string& path) {
+    if (run->cancelled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    MappedFile file;
+    if (!file.open(path) || file.size() == 0 || looksBinary(file.data(), file.size())) {
+        return;
+    }
+
+    FileSearchResult result;
+    run->pattern.findInText(std::string_view(file.data(), file.size()), result.matches, &run->cancelled);
+    if (result.matches.empty() || run->cancelled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    result.path = path;
+    std::lock_guard<std::mutex> lock(run->resultMutex);
+    run->onResult(result);
+}
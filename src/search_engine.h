@@ -0,0 +1,160 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_buffer.h"
+
+class WorkStealingPool;
+
+struct SearchOptions {
+    bool regex = false;
+    bool caseSensitive = true;
+    bool wholeWord = false;
+};
+
+struct SearchMatch {
+    size_t line;    ///< Zero-based line number.
+    size_t column;  ///< Byte offset of the match within the line.
+    size_t length;  ///< Match length in bytes.
+};
+
+struct FileSearchResult {
+    std::string path;
+    std::vector<SearchMatch> matches;
+};
+
+/**
+ * @brief Finds a fixed string using a vectorised first/last byte prefilter.
+ *
+ * Candidate positions are those where both the first and the last byte of
+ * the needle line up; SSE2 tests 16 of them per step and only candidates go
+ * on to a full comparison. Without SSE2 this degrades to memchr on the first
+ * byte.
+ */
+class LiteralMatcher {
+public:
+    LiteralMatcher(std::string needle, bool caseSensitive);
+
+    /**
+     * @brief Returns the offset of the first match at or after @p from, or
+     * std::string_view::npos.
+     */
+    size_t find(std::string_view haystack, size_t from = 0) const;
+
+    size_t length() const { return needle.size(); }
+
+private:
+    bool matchesAt(const char* candidate) const;
+
+    std::string needle;
+    bool caseSensitive;
+    unsigned char firstLower, firstUpper;
+    unsigned char lastLower, lastUpper;
+};
+
+/**
+ * @brief Compiled search query shared by buffer and project search.
+ *
+ * Matches never span a newline; regular expressions are evaluated one line
+ * at a time, and only on lines containing the longest literal the
+ * expression requires, if it has one. Throws std::invalid_argument for
+ * literal text containing a newline and std::regex_error for an invalid
+ * expression.
+ */
+class SearchPattern {
+public:
+    SearchPattern(const std::string& pattern, const SearchOptions& options);
+
+    /**
+     * @brief Appends every match in @p line to @p out.
+     */
+    void findInLine(std::string_view line, size_t lineNumber, std::vector<SearchMatch>& out) const;
+
+    /**
+     * @brief Scans a whole file image, tracking line numbers incrementally so
+     * literal searches skip straight from candidate to candidate.
+     */
+    void findInText(std::string_view text, std::vector<SearchMatch>& out,
+                    const std::atomic<bool>* cancelled = nullptr) const;
+
+    bool isEmpty() const { return empty; }
+
+private:
+    bool isWordBoundary(std::string_view line, size_t start, size_t length) const;
+
+    SearchOptions options;
+    bool empty;
+    std::unique_ptr<LiteralMatcher> literal;
+    std::unique_ptr<std::regex> expression;
+    /// A literal every regex match contains; lines without it are skipped.
+    std::unique_ptr<LiteralMatcher> prefilter;
+};
+
+/**
+ * @brief Searches a TextBuffer line by line through lineView(), without
+ * flattening it via getBuffer().
+ */
+std::vector<SearchMatch> findInBuffer(const TextBuffer& buffer, const std::string& pattern,
+                                      const SearchOptions& options = SearchOptions());
+
+/**
+ * @brief Replaces every match in @p buffer as one TextBuffer::applyEdits
+ * batch, so replace-all is a single splice and a single undo step.
+ * @return Number of replacements made.
+ */
+size_t replaceAllInBuffer(TextBuffer& buffer, const std::string& pattern, const std::string& replacement,
+                          const SearchOptions& options = SearchOptions());
+
+/**
+ * @brief Find-in-files over a directory tree.
+ *
+ * Directories are walked and files scanned as tasks on a work-stealing pool;
+ * files are mmap'd and each file's matches are reported through the result
+ * callback as soon as the file is done. Callbacks run on worker threads, so a
+ * UI should marshal them back to its own thread.
+ */
+class ProjectSearch {
+public:
+    using ResultCallback = std::function<void(const FileSearchResult&)>;
+    using FinishedCallback = std::function<void(bool cancelled)>;
+
+    explicit ProjectSearch(size_t threadCount = 0);
+    ~ProjectSearch();
+
+    /**
+     * @brief Starts a search, cancelling any search still in progress.
+     * @param root Directory (or single file) to search.
+     * @param pattern Literal text or regular expression.
+     * @param options Search options.
+     * @param onResult Called once per file with at least one match.
+     * @param onFinished Called once when the search completes or is cancelled.
+     */
+    void start(const std::string& root, const std::string& pattern, const SearchOptions& options,
+               ResultCallback onResult, FinishedCallback onFinished = nullptr);
+
+    /**
+     * @brief Requests cancellation; workers stop at the next file or chunk.
+     */
+    void cancel();
+
+    /**
+     * @brief Blocks until the current search has finished.
+     */
+    void wait();
+
+private:
+    struct Run;
+
+    void searchDirectory(const std::shared_ptr<Run>& run, const std::string& directory);
+    void searchFile(const std::shared_ptr<Run>& run, const std::string& path);
+    void release(const std::shared_ptr<Run>& run);
+
+    std::unique_ptr<WorkStealingPool> pool;
+    std::shared_ptr<Run> current;
+};
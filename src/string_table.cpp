@@ -0,0 +1,51 @@
+#include "string_table.h"
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+StringTable& StringTable::global() {
+    static StringTable* instance = new StringTable();  // Used from static destructors too.
+    return *instance;
+}
+
+StringTable::StringTable() : storage(64 * 1024) {}
+
+uint32_t StringTable::intern(std::string_view text) {
+    uint32_t id = find(text);
+    if (id != kNotFound) {
+        return id;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(text);
+    if (it != ids.end()) {
+        return it->second;  // Interned by another thread meanwhile
+    }
+    if (strings.size() >= kNotFound) {
+        throw std::length_error("StringTable: out of IDs");
+    }
+    char* copy = storage.allocateArray<char>(text.size());
+    std::memcpy(copy, text.data(), text.size());
+    std::string_view stored(copy, text.size());
+    id = static_cast<uint32_t>(strings.size());
+    strings.push_back(stored);
+    ids.emplace(stored, id);
+    return id;
+}
+
+uint32_t StringTable::find(std::string_view text) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(text);
+    return it != ids.end() ? it->second : kNotFound;
+}
+
+std::string_view StringTable::text(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return id < strings.size() ? strings[id] : std::string_view();
+}
+
+size_t StringTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return strings.size();
+}
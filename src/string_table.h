@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "frame_arena.h"
+
+/**
+ * @brief Process-wide interning table: each distinct string is stored once
+ * and gets a stable 32-bit ID.
+ *
+ * For tokens that repeat across lines and documents (keywords, identifiers,
+ * format keys), so they can be kept and compared as IDs instead of strings.
+ * Interned text is never freed and views from text() stay valid for the
+ * life of the process. Thread-safe; lookups take a shared lock.
+ */
+class StringTable {
+public:
+    static constexpr uint32_t kNotFound = UINT32_MAX;
+
+    static StringTable& global();
+
+    StringTable();
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+    /**
+     * @brief ID of @p text, adding it if new.
+     */
+    uint32_t intern(std::string_view text);
+
+    /**
+     * @brief ID of @p text, or kNotFound; never adds.
+     */
+    uint32_t find(std::string_view text) const;
+
+    std::string_view text(uint32_t id) const;
+
+    size_t size() const;
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string_view, uint32_t> ids;  ///< Keys view into storage.
+    std::vector<std::string_view> strings;               ///< Indexed by ID.
+    FrameArena storage;                                  ///< Never reset.
+};
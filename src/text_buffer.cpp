@@ -0,0 +1,360 @@
+#include "text_buffer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "latency_trace.h"
+
+TextBuffer::TextBuffer() : spliceArena(4096) {}
+
+void TextBuffer::loadFile(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to open file: " + filename);
+    }
+
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    loadText(contents.str());
+}
+
+void TextBuffer::loadText(std::string_view text) {
+    // A trailing newline yields a trailing empty line, so getBuffer()
+    // round-trips the file byte for byte.
+    size_t oldLineCount = lines.size();
+    size_t oldLength = getLength();
+    lines.load(text);
+    undoHistory.clear();
+    redoHistory.clear();
+    typing = false;
+    notify({0, oldLineCount, lines.size(), 0, oldLength, getLength()});
+}
+
+void TextBuffer::saveFile(const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Failed to write file: " + filename);
+    }
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (i > 0) {
+            out.put('\n');
+        }
+        std::string_view line = lines[i];
+        out.write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+}
+
+void TextBuffer::insertText(const std::string& text, size_t position) {
+    position = std::min(position, getLength());
+    applyEdits(single(position, position, text));
+}
+
+void TextBuffer::deleteText(size_t start, size_t end) {
+    end = std::min(end, getLength());
+    if (end <= start) {
+        return;
+    }
+    applyEdits(single(start, end, std::string_view()));
+}
+
+std::string TextBuffer::getBuffer() const {
+    std::string result;
+    result.reserve(getLength());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (i > 0) {
+            result += '\n';
+        }
+        result += lines[i];
+    }
+    return result;
+}
+
+std::string TextBuffer::getLine(size_t lineNumber) const {
+    return lineNumber < lines.size() ? std::string(lines[lineNumber]) : std::string();
+}
+
+size_t TextBuffer::getLineCount() const {
+    return lines.size();
+}
+
+std::string_view TextBuffer::lineView(size_t lineNumber) const {
+    return lineNumber < lines.size() ? lines[lineNumber] : std::string_view();
+}
+
+void TextBuffer::applyEdits(const std::vector<TextEdit>& edits) {
+    if (edits.empty()) {
+        return;
+    }
+    SNSUPEAR_TRACE_SCOPE(Edit, "TextBuffer::applyEdits");
+    const TextEdit& first = edits.front();
+    const bool typed = edits.size() == 1 && first.start == first.end && first.replacement.size() == 1
+                       && !std::isspace(static_cast<unsigned char>(first.replacement[0]));
+    if (typed && typing && undoHistory.extendInsertion(first.start, 1)) {
+        splice(edits, nullptr);
+    } else {
+        splice(edits, &undoHistory);
+    }
+    typing = typed;
+    redoHistory.clear();
+}
+
+void TextBuffer::applyExternalEdits(const std::vector<TextEdit>& edits) {
+    if (edits.empty()) {
+        return;
+    }
+    splice(edits, nullptr);
+    // Back to front, each edit's offsets hold in the text it is applied to.
+    for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+        undoHistory.rebase(it->start, it->end, it->replacement.size());
+        redoHistory.rebase(it->start, it->end, it->replacement.size());
+    }
+    typing = false;
+}
+
+void TextBuffer::appendText(const std::string& text) {
+    if (text.empty()) {
+        return;
+    }
+    size_t end = getLength();
+    splice(single(end, end, text), nullptr);
+}
+
+bool TextBuffer::undo() {
+    if (undoHistory.empty()) {
+        return false;
+    }
+    undoHistory.popBatch(historyBatch);
+    splice(historyBatch, &redoHistory);
+    typing = false;
+    return true;
+}
+
+bool TextBuffer::redo() {
+    if (redoHistory.empty()) {
+        return false;
+    }
+    redoHistory.popBatch(historyBatch);
+    splice(historyBatch, &undoHistory);
+    typing = false;
+    return true;
+}
+
+void TextBuffer::setUndoLimit(size_t bytes, size_t steps) {
+    undoHistory.setLimit(bytes, steps);
+    redoHistory.setLimit(bytes, steps);
+}
+
+size_t TextBuffer::getLength() const {
+    return lines.totalLength();
+}
+
+size_t TextBuffer::offsetOfLine(size_t lineNumber) const {
+    return lineNumber < lines.size() ? lines.offsetOf(lineNumber) : getLength();
+}
+
+size_t TextBuffer::lineOfOffset(size_t position) const {
+    return lines.lineAt(position);
+}
+
+void TextBuffer::addChangeListener(ChangeListener listener) {
+    listeners.push_back(std::move(listener));
+}
+
+void TextBuffer::splice(const std::vector<TextEdit>& edits, EditHistory* inverse) {
+    const size_t length = getLength();
+    size_t previousEnd = 0;
+    size_t updatedLength = 0;
+    for (const TextEdit& edit : edits) {
+        if (edit.start > edit.end || edit.start < previousEnd || edit.end > length) {
+            throw std::invalid_argument("TextBuffer::applyEdits: edits must be sorted, disjoint and in range");
+        }
+        previousEnd = edit.end;
+        updatedLength += edit.replacement.size() - (edit.end - edit.start);  // Wraps back below
+    }
+
+    // Everything between the first and last touched line is rebuilt in one
+    // pass; lines outside that span are left alone.
+    const size_t firstLine = lineOfOffset(edits.front().start);
+    const size_t lastLine = lineOfOffset(edits.back().end);
+    const size_t spanStart = lines.offsetOf(firstLine);
+    const size_t spanEnd = lines.offsetOf(lastLine) + lines.length(lastLine);
+    updatedLength += spanEnd - spanStart;
+
+    // The old and new text of the span are per-edit scratch.
+    spliceArena.reset();
+    char* originalData = spliceArena.allocateArray<char>(spanEnd - spanStart);
+    char* updatedData = spliceArena.allocateArray<char>(updatedLength);
+    size_t written = 0;
+    for (size_t i = firstLine; i <= lastLine; ++i) {
+        if (i > firstLine) {
+            originalData[written++] = '\n';
+        }
+        std::memcpy(originalData + written, lines[i].data(), lines[i].size());
+        written += lines[i].size();
+    }
+    const std::string_view original(originalData, spanEnd - spanStart);
+
+    if (inverse) {
+        inverse->beginBatch();
+    }
+    size_t cursor = spanStart;
+    size_t shifted = spanStart;  ///< Position in the updated text matching cursor.
+    written = 0;
+    for (const TextEdit& edit : edits) {
+        std::memcpy(updatedData + written, original.data() + (cursor - spanStart), edit.start - cursor);
+        written += edit.start - cursor;
+        shifted += edit.start - cursor;
+        if (inverse) {
+            inverse->add(shifted, shifted + edit.replacement.size(),
+                         original.substr(edit.start - spanStart, edit.end - edit.start));
+        }
+        std::memcpy(updatedData + written, edit.replacement.data(), edit.replacement.size());
+        written += edit.replacement.size();
+        shifted += edit.replacement.size();
+        cursor = edit.end;
+    }
+    std::memcpy(updatedData + written, original.data() + (cursor - spanStart), spanEnd - cursor);
+    const std::string_view updated(updatedData, updatedLength);
+
+    const size_t oldCount = lastLine - firstLine + 1;
+    const size_t untouched = lines.size() - oldCount;
+    lines.replace(firstLine, oldCount, updated);
+    const size_t newCount = lines.size() - untouched;
+
+    notify({firstLine, oldCount, newCount, spanStart, original.size(), updated.size()});
+}
+
+const std::vector<TextEdit>& TextBuffer::single(size_t start, size_t end, std::string_view replacement) {
+    singleEdit.resize(1);
+    singleEdit[0].start = start;
+    singleEdit[0].end = end;
+    singleEdit[0].replacement.assign(replacement.data(), replacement.size());
+    return singleEdit;
+}
+
+void TextBuffer::notify(const DamageRegion& damage) {
+    for (const ChangeListener& listener : listeners) {
+        listener(damage);
+    }
+}
+
+void TextBuffer::EditHistory::clear() {
+    entries.clear();
+    batches.clear();
+    text.clear();
+}
+
+void TextBuffer::EditHistory::setLimit(size_t bytes, size_t steps) {
+    maxBytes = bytes;
+    maxSteps = std::max<size_t>(steps, 1);
+    trim();
+}
+
+void TextBuffer::EditHistory::beginBatch() {
+    trim();
+    batches.push_back(entries.size());
+}
+
+bool TextBuffer::EditHistory::extendInsertion(size_t position, size_t length) {
+    if (batches.empty() || batches.back() + 1 != entries.size()) {
+        return false;
+    }
+    Entry& last = entries.back();
+    if (last.textLength != 0 || last.end != position) {
+        return false;
+    }
+    last.end += length;
+    return true;
+}
+
+size_t TextBuffer::EditHistory::bytes() const {
+    return text.size() + entries.size() * sizeof(Entry) + batches.size() * sizeof(size_t);
+}
+
+// Drops the oldest batches once the history is over a limit, down to three
+// quarters of it, so the compaction below runs once per many batches.
+void TextBuffer::EditHistory::trim() {
+    size_t remaining = bytes();
+    if (batches.size() < maxSteps && remaining <= maxBytes) {
+        return;
+    }
+    const size_t keepSteps = maxSteps - maxSteps / 4;
+    const size_t keepBytes = maxBytes - maxBytes / 4;
+    size_t dropped = 0;
+    while (dropped < batches.size() && (batches.size() - dropped > keepSteps || remaining > keepBytes)) {
+        const size_t end = dropped + 1 < batches.size() ? batches[dropped + 1] : entries.size();
+        for (size_t i = batches[dropped]; i < end; ++i) {
+            remaining -= entries[i].textLength + sizeof(Entry);
+        }
+        remaining -= sizeof(size_t);
+        ++dropped;
+    }
+
+    dropOldest(dropped);
+}
+
+void TextBuffer::EditHistory::dropOldest(size_t count) {
+    const size_t firstEntry = count < batches.size() ? batches[count] : entries.size();
+    const size_t firstText = firstEntry < entries.size() ? entries[firstEntry].textOffset : text.size();
+    batches.erase(batches.begin(), batches.begin() + static_cast<std::ptrdiff_t>(count));
+    entries.erase(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(firstEntry));
+    text.erase(0, firstText);
+    for (size_t& batch : batches) {
+        batch -= firstEntry;
+    }
+    for (Entry& entry : entries) {
+        entry.textOffset -= firstText;
+    }
+}
+
+void TextBuffer::EditHistory::add(size_t start, size_t end, std::string_view replacement) {
+    entries.push_back({start, end, text.size(), replacement.size()});
+    text.append(replacement.data(), replacement.size());
+}
+
+void TextBuffer::EditHistory::popBatch(std::vector<TextEdit>& out) {
+    const size_t first = batches.back();
+    batches.pop_back();
+    out.resize(entries.size() - first);
+    for (size_t i = first; i < entries.size(); ++i) {
+        TextEdit& edit = out[i - first];
+        edit.start = entries[i].start;
+        edit.end = entries[i].end;
+        edit.replacement.assign(text, entries[i].textOffset, entries[i].textLength);
+    }
+    if (first < entries.size()) {
+        text.resize(entries[first].textOffset);
+        entries.resize(first);
+    }
+}
+
+void TextBuffer::EditHistory::rebase(size_t start, size_t end, size_t length) {
+    // Newest first: each batch applies to the text the one after it leaves,
+    // so the edit is carried back through every batch it passes.
+    for (size_t batch = batches.size(); batch-- > 0;) {
+        const size_t last = batch + 1 < batches.size() ? batches[batch + 1] : entries.size();
+        size_t shiftedStart = start;
+        for (size_t i = batches[batch]; i < last; ++i) {
+            Entry& entry = entries[i];
+            if (end <= entry.start) {
+                // Entries are sorted, so this and the rest lie past the edit.
+                for (size_t j = i; j < last; ++j) {
+                    entries[j].start = entries[j].start + length - (end - start);
+                    entries[j].end = entries[j].end + length - (end - start);
+                }
+                break;
+            }
+            if (start < entry.end) {
+                dropOldest(batch + 1);  // Reverting it would undo the edit too
+                return;
+            }
+            shiftedStart += entry.textLength - (entry.end - entry.start);
+        }
+        end = shiftedStart + (end - start);
+        start = shiftedStart;
+    }
+}
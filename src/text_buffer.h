@@ -1,10 +1,41 @@
 #pragma once
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "frame_arena.h"
+#include "line_store.h"
+
+// One replacement in a batch: bytes [start, end) of the current text become
+// `replacement`. Offsets count lines joined by '\n'.
+struct TextEdit {
+    size_t start;
+    size_t end;
+    std::string replacement;
+};
+
+// Coalesced change notification: lines [firstLine, firstLine + oldLineCount)
+// were replaced by newLineCount lines, and bytes [startOffset,
+// startOffset + oldLength) by newLength bytes.
+struct DamageRegion {
+    size_t firstLine;
+    size_t oldLineCount;
+    size_t newLineCount;
+    size_t startOffset;
+    size_t oldLength;
+    size_t newLength;
+};
+
 class TextBuffer {
 public:
+    using ChangeListener = std::function<void(const DamageRegion&)>;
+
+    TextBuffer();
+
     void loadFile(const std::string& filename);
+    /// Replaces the whole text, clearing undo history, like loadFile().
+    void loadText(std::string_view text);
     void saveFile(const std::string& filename);
     void insertText(const std::string& text, size_t position);
     void deleteText(size_t start, size_t end);
@@ -12,6 +43,108 @@ public:
     std::string getLine(size_t lineNumber) const;
     size_t getLineCount() const;
 
+    // Borrowed view of a line without its terminating '\n'. Invalidated by
+    // any edit; lets readers walk the buffer without copying it.
+    std::string_view lineView(size_t lineNumber) const;
+
+    // Applies edits sorted by start, non-overlapping, with offsets relative
+    // to the text before the batch. The whole batch is one splice, one
+    // line-index update, one undo step and one DamageRegion; a typed
+    // character (a one-byte insertion other than whitespace) right after
+    // the previous one joins its step instead, so typing undoes a word at a
+    // time. Throws std::invalid_argument for unsorted, overlapping or
+    // out-of-range edits.
+    void applyEdits(const std::vector<TextEdit>& edits);
+
+    // Applies edits made elsewhere, e.g. by a collaborator. No undo step is
+    // recorded; the existing history is moved onto the new text so undo
+    // still reverts only local steps. Steps that overlap an external edit,
+    // and all older ones, cannot be reverted and are dropped.
+    void applyExternalEdits(const std::vector<TextEdit>& edits);
+
+    // Appends without recording undo history, for followed log files whose
+    // growth is not a user edit. Only the new lines are reported as damage.
+    void appendText(const std::string& text);
+
+    bool undo();
+    bool redo();
+
+    // Bounds the undo and redo histories. Once either holds more bytes or
+    // steps than this, its oldest steps are dropped; the newest step is
+    // always kept, however large.
+    void setUndoLimit(size_t bytes, size_t steps);
+    bool canUndo() const { return !undoHistory.empty(); }
+    bool canRedo() const { return !redoHistory.empty(); }
+
+    size_t getLength() const;
+
+    // Bytes held for the text, line index and edit scratch, excluding undo
+    // history.
+    size_t memoryUsage() const { return lines.memoryUsage() + spliceArena.capacity(); }
+    size_t offsetOfLine(size_t lineNumber) const;
+    size_t lineOfOffset(size_t position) const;
+
+    // Listeners run synchronously after every change with its damage.
+    void addChangeListener(ChangeListener listener);
+
 private:
-    std::vector<std::string> lines;
-};
\ No newline at end of file
+    // Undo or redo history. Batches are stored flat, their replacement
+    // bytes in one log, so recording a keystroke appends to capacity that
+    // is already there instead of allocating a vector and strings.
+    class EditHistory {
+    public:
+        bool empty() const { return batches.empty(); }
+        void clear();
+        void setLimit(size_t bytes, size_t steps);
+        void beginBatch();
+        void add(size_t start, size_t end, std::string_view replacement);
+
+        // Widens the newest batch to also undo an insertion of `length`
+        // bytes at `position`, if that batch undoes a single insertion
+        // ending there.
+        bool extendInsertion(size_t position, size_t length);
+
+        // Moves the newest batch into `out`, reusing its strings' capacity.
+        void popBatch(std::vector<TextEdit>& out);
+
+        // Shifts the batches past an edit of [start, end) into `length`
+        // bytes, made to the text the newest batch applies to. The first
+        // batch that overlaps it is dropped with all older ones.
+        void rebase(size_t start, size_t end, size_t length);
+
+    private:
+        size_t bytes() const;
+        void trim();
+        void dropOldest(size_t count);
+
+        struct Entry {
+            size_t start;
+            size_t end;
+            size_t textOffset;
+            size_t textLength;
+        };
+        std::vector<Entry> entries;
+        std::vector<size_t> batches;  ///< Index of each batch's first entry.
+        std::string text;
+        size_t maxBytes = size_t(16) << 20;
+        size_t maxSteps = 10000;
+    };
+
+    LineStore lines;
+    EditHistory undoHistory;
+    EditHistory redoHistory;
+    bool typing = false;  ///< The newest undo step is a run of typed characters.
+    std::vector<ChangeListener> listeners;
+
+    // Scratch reused across edits so that steady typing does not allocate:
+    // the text of the span being rebuilt and the batches passed to splice().
+    FrameArena spliceArena;
+    std::vector<TextEdit> singleEdit;
+    std::vector<TextEdit> historyBatch;
+
+    // Splices the batch in and, given a history, records its inverse there
+    // (in post-edit offsets) as one batch.
+    void splice(const std::vector<TextEdit>& edits, EditHistory* inverse);
+    const std::vector<TextEdit>& single(size_t start, size_t end, std::string_view replacement);
+    void notify(const DamageRegion& damage);
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// LEB128 helpers shared by the binary wire formats.
+
+inline void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Bytes appendVarint() writes for `value`.
+inline size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+// Reads a varint at `pos` and advances it; throws std::invalid_argument on
+// truncated or overlong input.
+inline uint64_t readVarint(std::string_view in, size_t& pos) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) {
+            throw std::invalid_argument("truncated varint");
+        }
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::invalid_argument("varint too long");
+}
+
+inline std::string_view readBytes(std::string_view in, size_t& pos, size_t length) {
+    if (length > in.size() - pos) {
+        throw std::invalid_argument("truncated payload");
+    }
+    std::string_view bytes = in.substr(pos, length);
+    pos += length;
+    return bytes;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size thread pool where idle workers steal queued tasks.
+ *
+ * Each worker owns a deque: it pushes and pops its own work at the back and
+ * steals from the front of other workers' deques, so tasks spawned while
+ * walking a directory tree stay local until someone runs dry.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * @brief Starts the workers.
+     * @param threadCount Number of workers; 0 uses the hardware concurrency.
+     */
+    explicit WorkStealingPool(size_t threadCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Queues a task. Called from a worker, the task goes to that
+     * worker's own deque; otherwise queues are filled round-robin.
+     */
+    void submit(Task task);
+
+    /**
+     * @brief Blocks until every submitted task, including tasks submitted by
+     * other tasks, has finished.
+     */
+    void waitIdle();
+
+    size_t threadCount() const { return workers.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> nextQueue{0};
+    bool stopping = false;
+};
@@ -0,0 +1,377 @@
+#include "workspace.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+
+#include "work_stealing_pool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// What a file costs once loaded, before it is: the text plus LineStore's
+// 16 bytes per line, with source lines averaging a few dozen bytes.
+size_t estimatedBytes(uintmax_t fileBytes) {
+    return static_cast<size_t>(fileBytes + fileBytes / 2);
+}
+
+bool changedOnDisk(const WorkspaceDocument& document) {
+    std::error_code ec;
+    fs::file_time_type writeTime = fs::last_write_time(document.path, ec);
+    if (ec) {
+        return false;  // Gone or unreadable; keep what was loaded
+    }
+    uintmax_t size = fs::file_size(document.path, ec);
+    return writeTime != document.writeTime || (!ec && size != document.original->size());
+}
+
+} // namespace
+
+Workspace::Workspace(const WorkspaceOptions& options)
+    : options(options), pool(std::make_unique<WorkStealingPool>(options.threadCount)) {}
+
+Workspace::~Workspace() {
+    pool->waitIdle();
+    pool.reset();  // Workers go before the cache they load into
+}
+
+void Workspace::openAll(const std::vector<std::string>& paths, LoadedCallback onLoaded) {
+    for (const std::string& path : paths) {
+        pool->submit([this, path, onLoaded] {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto it = entries.find(path);
+            if (it != entries.end() && !it->second.document) {
+                // Loading: the loader reports it, so this worker never waits.
+                if (onLoaded) {
+                    it->second.waiting.push_back(onLoaded);
+                }
+                return;
+            }
+            std::string error;
+            try {
+                fetch(path, lock);  // Cached, or loaded here
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            lock.unlock();
+            report(onLoaded, path, error);
+        });
+    }
+}
+
+std::shared_ptr<WorkspaceDocument> Workspace::acquire(const std::string& path) {
+    std::shared_ptr<WorkspaceDocument> document;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        document = fetch(path, lock);
+        if (!document->modified && document.use_count() == 2 && changedOnDisk(*document)) {
+            document.reset();
+            drop(entries.find(path));
+            // Views still holding the old mapping keep it; the reload maps
+            // the file as it is now.
+            originals.erase(path);
+            document = fetch(path, lock);
+        }
+
+        // The caller owns the buffer from here on; this is the workspace's
+        // chance to see what its edits have cost so far.
+        Entry& entry = entries.at(path);
+        size_t bytes = document->buffer.memoryUsage();
+        cachedBytes = cachedBytes - entry.bytes + bytes;
+        entry.bytes = bytes;
+
+        recent.erase(std::remove(recent.begin(), recent.end(), path), recent.end());
+        recent.push_front(path);
+        if (recent.size() > options.recentFiles) {
+            recent.pop_back();
+        }
+    }
+    prefetchAround(path);
+    return document;
+}
+
+std::shared_ptr<WorkspaceDocument> Workspace::take(const std::string& path) {
+    std::shared_ptr<WorkspaceDocument> document;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it == entries.end() || !it->second.document) {
+            return nullptr;  // Not loaded, or still loading
+        }
+        document = it->second.document;
+        const bool stale = !document->modified && document.use_count() == 2 && changedOnDisk(*document);
+        drop(it);
+        if (stale) {
+            originals.erase(path);  // The next load maps the file as it is now
+            return nullptr;
+        }
+        taken.insert(path);
+    }
+    prefetchAround(path);
+    return document;
+}
+
+void Workspace::prefetch(const std::vector<std::string>& paths) {
+    for (const std::string& path : paths) {
+        startPrefetch(path);
+    }
+}
+
+void Workspace::release(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    recent.erase(std::remove(recent.begin(), recent.end(), path), recent.end());
+    taken.erase(path);
+    auto it = entries.find(path);
+    if (it == entries.end()) {
+        return;
+    }
+    const std::shared_ptr<WorkspaceDocument>& document = it->second.document;
+    if (document && document.use_count() == 1 && !document->modified.load(std::memory_order_relaxed)) {
+        drop(it);
+    }
+}
+
+std::shared_ptr<const MappedFile> Workspace::original(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = originals.find(path);
+        if (it != originals.end()) {
+            if (std::shared_ptr<const MappedFile> mapping = it->second.lock()) {
+                return mapping;
+            }
+        }
+    }
+    // Mapped outside the lock; if another thread won the race, its mapping
+    // is the one shared.
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(path)) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    std::weak_ptr<const MappedFile>& slot = originals[path];
+    if (std::shared_ptr<const MappedFile> existing = slot.lock()) {
+        return existing;
+    }
+    slot = mapping;
+    return mapping;
+}
+
+bool Workspace::isCached(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    return it != entries.end() && it->second.document;
+}
+
+size_t Workspace::cachedCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<size_t>(std::count_if(entries.begin(), entries.end(),
+                                              [](const auto& item) { return item.second.document != nullptr; }));
+}
+
+size_t Workspace::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cachedBytes;
+}
+
+void Workspace::waitIdle() {
+    pool->waitIdle();
+}
+
+std::shared_ptr<WorkspaceDocument> Workspace::load(const std::string& path) {
+    // Stamped before mapping, so a write racing the load shows as a change.
+    std::error_code ec;
+    fs::file_time_type writeTime = fs::last_write_time(path, ec);
+    std::shared_ptr<const MappedFile> mapping = original(path);
+    if (!mapping) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    auto document = std::make_shared<WorkspaceDocument>();
+    document->path = path;
+    document->original = mapping;
+    document->writeTime = writeTime;
+    document->buffer.loadText(std::string_view(mapping->data(), mapping->size()));
+    return document;
+}
+
+std::shared_ptr<WorkspaceDocument> Workspace::fetch(const std::string& path, std::unique_lock<std::mutex>& lock) {
+    for (;;) {
+        auto it = entries.find(path);
+        if (it == entries.end()) {
+            break;
+        }
+        if (it->second.document) {
+            touch(it->second);
+            return it->second.document;
+        }
+        // Someone else is loading it; if that fails the entry goes and the
+        // load is retried here, which reports the error. Only acquire()
+        // waits here: openAll() tasks never call this for a loading entry.
+        loaded.wait(lock);
+    }
+
+    lru.push_front(path);
+    entries[path].position = lru.begin();
+    lock.unlock();
+
+    std::shared_ptr<WorkspaceDocument> document;
+    try {
+        document = load(path);
+    } catch (const std::exception& e) {
+        lock.lock();
+        finishLoad(path, nullptr, e.what(), lock);
+        throw;
+    }
+
+    lock.lock();
+    finishLoad(path, document, std::string(), lock);  // `document` pins it through evict()
+    return document;
+}
+
+void Workspace::finishLoad(const std::string& path, std::shared_ptr<WorkspaceDocument> document,
+                           const std::string& error, std::unique_lock<std::mutex>& lock) {
+    auto it = entries.find(path);
+    std::vector<LoadedCallback> waiting = std::move(it->second.waiting);
+    if (document) {
+        it->second.document = std::move(document);
+        it->second.bytes = it->second.document->buffer.memoryUsage();
+        cachedBytes += it->second.bytes;
+    } else {
+        lru.erase(it->second.position);
+        entries.erase(it);
+    }
+    loaded.notify_all();
+    evict();
+    if (waiting.empty()) {
+        return;
+    }
+    lock.unlock();
+    for (const LoadedCallback& onLoaded : waiting) {
+        report(onLoaded, path, error);
+    }
+    lock.lock();
+}
+
+void Workspace::report(const LoadedCallback& onLoaded, const std::string& path, const std::string& error) {
+    if (onLoaded) {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        onLoaded(path, error);
+    }
+}
+
+void Workspace::startPrefetch(const std::string& path) {
+    std::error_code ec;
+    if (!fs::is_regular_file(path, ec)) {
+        return;
+    }
+    uintmax_t size = fs::file_size(path, ec);
+    if (ec || size > options.maxPrefetchBytes) {
+        return;
+    }
+    const size_t estimate = estimatedBytes(size);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (entries.count(path) || taken.count(path)
+            || cachedBytes + reservedBytes + estimate > options.memoryBudget) {
+            return;
+        }
+        // The cold end: a prefetch is the first thing evicted.
+        lru.push_back(path);
+        entries[path].position = std::prev(lru.end());
+        reservedBytes += estimate;
+    }
+
+    pool->submit([this, path, estimate] {
+        std::shared_ptr<WorkspaceDocument> document;
+        std::string error;
+        try {
+            document = load(path);
+        } catch (const std::exception& e) {
+            // Unreadable now; acquire() will report it if it is ever opened.
+            error = e.what();
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        reservedBytes -= estimate;
+        finishLoad(path, std::move(document), error, lock);
+    });
+}
+
+void Workspace::prefetchAround(const std::string& path) {
+    if (options.prefetchNeighbours == 0 && options.recentFiles == 0) {
+        return;
+    }
+    std::vector<std::string> recentPaths;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        recentPaths.assign(recent.begin(), recent.end());
+    }
+    pool->submit([this, path, recentPaths] {
+        const fs::path file(path);
+        const fs::path directory = file.parent_path();
+        std::vector<std::string> names;
+        std::error_code ec;
+        for (fs::directory_iterator it(directory.empty() ? fs::path(".") : directory, ec), end; !ec && it != end;
+             it.increment(ec)) {
+            std::error_code typeError;
+            if (it->is_regular_file(typeError)) {
+                names.push_back(it->path().filename().string());
+            }
+        }
+        std::sort(names.begin(), names.end());
+
+        // Next and previous files alternately, nearest first: the order a
+        // user stepping through a directory opens them in.
+        std::vector<std::string> candidates;
+        const std::string name = file.filename().string();
+        auto at = std::lower_bound(names.begin(), names.end(), name);
+        const size_t index = static_cast<size_t>(at - names.begin());
+        const size_t after = at != names.end() && *at == name ? index + 1 : index;
+        for (size_t step = 0; step < options.prefetchNeighbours; ++step) {
+            if (after + step < names.size()) {
+                candidates.push_back((directory / names[after + step]).string());
+            }
+            if (step < index) {
+                candidates.push_back((directory / names[index - 1 - step]).string());
+            }
+        }
+        candidates.insert(candidates.end(), recentPaths.begin(), recentPaths.end());
+
+        for (const std::string& candidate : candidates) {
+            if (candidate != path) {
+                startPrefetch(candidate);
+            }
+        }
+    });
+}
+
+void Workspace::touch(Entry& entry) {
+    lru.splice(lru.begin(), lru, entry.position);
+}
+
+// Requires the lock. Walks from the least recently used end, skipping
+// documents that are loading, held by a caller or modified.
+void Workspace::evict() {
+    for (auto it = lru.end(); cachedBytes > options.memoryBudget && it != lru.begin();) {
+        --it;
+        auto entry = entries.find(*it);
+        const std::shared_ptr<WorkspaceDocument>& document = entry->second.document;
+        if (!document || document.use_count() > 1 || document->modified.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        ++it;  // Past the node drop() erases
+        drop(entry);
+    }
+}
+
+// Requires the lock.
+void Workspace::drop(std::unordered_map<std::string, Entry>::iterator entry) {
+    const std::string path = entry->first;
+    cachedBytes -= entry->second.bytes;
+    lru.erase(entry->second.position);
+    entries.erase(entry);  // Unmaps the original unless another view holds it
+    auto original = originals.find(path);
+    if (original != originals.end() && original->second.expired()) {
+        originals.erase(original);
+    }
+}
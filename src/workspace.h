@@ -0,0 +1,179 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+#include "text_buffer.h"
+
+class WorkStealingPool;
+
+struct WorkspaceOptions {
+    /// Bytes of cached documents (TextBuffer::memoryUsage) kept in memory.
+    /// Documents in use or modified are kept regardless.
+    size_t memoryBudget = size_t(512) << 20;
+    /// Files on each side of an acquired file, in directory order, that are
+    /// loaded ahead.
+    size_t prefetchNeighbours = 4;
+    /// Recently acquired files that are loaded again if evicted.
+    size_t recentFiles = 16;
+    /// Larger files are never prefetched.
+    size_t maxPrefetchBytes = size_t(16) << 20;
+    /// Loader threads; 0 uses the hardware concurrency.
+    size_t threadCount = 0;
+};
+
+/**
+ * @brief A file loaded into the workspace.
+ *
+ * The buffer belongs to whichever thread acquired the document (the UI);
+ * the workspace only reads it while nobody holds the document.
+ */
+struct WorkspaceDocument {
+    std::string path;
+    /// The file's bytes when loaded, shared by every view of the path.
+    std::shared_ptr<const MappedFile> original;
+    std::filesystem::file_time_type writeTime;  ///< The file's when loaded.
+    TextBuffer buffer;
+    /// Set by the owner while the buffer has unsaved changes; modified
+    /// documents are never evicted.
+    std::atomic<bool> modified{false};
+};
+
+/**
+ * @brief Set of open files behind a shared, memory-budgeted buffer cache.
+ *
+ * Files are loaded on a work-stealing pool straight from a shared mmap of
+ * the file, and acquiring one that is cached is a lookup. Pool tasks never
+ * wait for a load another task started: the pool runs its own queue last
+ * in, first out, so that load could be queued behind the waiter. Acquiring
+ * a file also queues
+ * background loads of its neighbours in the directory and of recently used
+ * files that were evicted; these go to the cold end of the LRU and are only
+ * started while the budget has room, so prefetching never pushes out a file
+ * that was actually used.
+ *
+ * Cached documents are evicted least recently used first once their total
+ * size passes the budget; a document is pinned while a caller holds its
+ * shared_ptr or while it is marked modified. Sizes are measured when a
+ * document is loaded and each time acquire() hands it out.
+ */
+class Workspace {
+public:
+    /// Called once per file from a worker thread; @p error is empty on
+    /// success. Calls are serialised.
+    using LoadedCallback = std::function<void(const std::string& path, const std::string& error)>;
+
+    explicit Workspace(const WorkspaceOptions& options = WorkspaceOptions());
+
+    /**
+     * @brief Waits for loads in progress.
+     */
+    ~Workspace();
+
+    Workspace(const Workspace&) = delete;
+    Workspace& operator=(const Workspace&) = delete;
+
+    /**
+     * @brief Loads the files in parallel into the cache, as recently used.
+     * A file already loading is reported when that load finishes.
+     */
+    void openAll(const std::vector<std::string>& paths, LoadedCallback onLoaded = nullptr);
+
+    /**
+     * @brief The document for @p path: from the cache, after waiting for a
+     * load in progress, or loaded on the calling thread. A cached document
+     * nobody holds is reloaded if the file changed since and it is not
+     * modified. Prefetches around it. Throws std::runtime_error if the
+     * file cannot be read.
+     */
+    std::shared_ptr<WorkspaceDocument> acquire(const std::string& path);
+
+    /**
+     * @brief Hands the cached document for @p path over to the caller, for
+     * a view that copies the text into a document of its own: the cache
+     * drops it and prefetches no longer load the path until release(). Null
+     * if it is not loaded yet, or the file changed since; never waits or
+     * reads the file. Prefetches around it.
+     */
+    std::shared_ptr<WorkspaceDocument> take(const std::string& path);
+
+    /**
+     * @brief Queues background loads of files not cached yet, if the
+     * budget has room for them.
+     */
+    void prefetch(const std::vector<std::string>& paths);
+
+    /**
+     * @brief Drops @p path from the cache and the recent files, as when its
+     * tab is closed, unless it is loading, held or modified. A path given
+     * to take() may be prefetched again.
+     */
+    void release(const std::string& path);
+
+    /**
+     * @brief Read-only mapping of @p path, shared with every other caller
+     * and document that maps it while it is alive; null if unreadable.
+     */
+    std::shared_ptr<const MappedFile> original(const std::string& path);
+
+    bool isCached(const std::string& path) const;
+    size_t cachedCount() const;
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Blocks until every queued load and prefetch has finished.
+     */
+    void waitIdle();
+
+private:
+    struct Entry {
+        std::shared_ptr<WorkspaceDocument> document;  ///< Null while loading.
+        std::list<std::string>::iterator position;    ///< In lru.
+        size_t bytes = 0;
+        std::vector<LoadedCallback> waiting;          ///< openAll() callbacks for the load in progress.
+    };
+
+    std::shared_ptr<WorkspaceDocument> load(const std::string& path);
+    std::shared_ptr<WorkspaceDocument> fetch(const std::string& path, std::unique_lock<std::mutex>& lock);
+
+    /**
+     * @brief Stores the outcome of the load of @p path, null on failure,
+     * and reports it to the openAll() callbacks waiting for it, which run
+     * with @p lock released.
+     */
+    void finishLoad(const std::string& path, std::shared_ptr<WorkspaceDocument> document,
+                    const std::string& error, std::unique_lock<std::mutex>& lock);
+    void report(const LoadedCallback& onLoaded, const std::string& path, const std::string& error);
+    void startPrefetch(const std::string& path);
+    void prefetchAround(const std::string& path);
+    void touch(Entry& entry);
+    void drop(std::unordered_map<std::string, Entry>::iterator entry);
+    void evict();
+
+    WorkspaceOptions options;
+    std::unique_ptr<WorkStealingPool> pool;
+
+    mutable std::mutex mutex;
+    std::condition_variable loaded;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;            ///< Most recently used first.
+    std::deque<std::string> recent;        ///< Acquired paths, most recent first.
+    size_t cachedBytes = 0;
+    size_t reservedBytes = 0;              ///< Estimated size of prefetches in flight.
+    std::map<std::string, std::weak_ptr<const MappedFile>> originals;
+    std::set<std::string> taken;           ///< Handed over by take(); not prefetched.
+
+    std::mutex callbackMutex;
+};
@@ -1,7 +1,26 @@
 // syntax_highlighter.cpp
 #include "syntax_highlighter.h"
 #include "config_manager.h"
+#include "latency_trace.h"
+#include "string_table.h"
 #include <QDebug>
+#include <QHash>
+#include <QTextLayout>
+#include <algorithm>
+
+namespace {
+
+// PCRE's \w without UseUnicodePropertiesOption, which is what the word
+// lists and their \b anchors are compiled with.
+bool isWordChar(QChar c) {
+    const ushort u = c.unicode();
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '_';
+}
+
+// Word-list entries longer than this are left to the regex.
+constexpr int kMaxWordBytes = 64;
+
+} // namespace
 
 /**
  * @brief Constructs a syntax highlighter for the given text document.
@@ -28,7 +47,10 @@ void SyntaxHighlighter::setLanguage(const QString &language) {
  * @param theme The theme configuration as a QJsonObject.
  */
 void SyntaxHighlighter::setHighlightingRules(const QJsonObject& theme) {
+    ++generation;
     highlightingRules.clear();
+    longestWord = 0;
+    minimapColors.resize(1);
 
     if (currentLanguage.isEmpty()) {
         return;
@@ -46,6 +68,8 @@ void SyntaxHighlighter::setHighlightingRules(const QJsonObject& theme) {
             HighlightingRule rule;
             rule.pattern = QRegularExpression(key); // Assuming keys are the patterns
             rule.format = createTextFormat(theme[colorName].toString());
+            rule.minimapColor = minimapColorOf(rule.format);
+            compileRule(rule);
             highlightingRules.append(rule);
         } else {
             qWarning() << "Color not found in theme:" << colorName;
@@ -55,16 +79,125 @@ void SyntaxHighlighter::setHighlightingRules(const QJsonObject& theme) {
 
 /**
  * @brief Highlights a single block of text.
+ *
+ * Runs once per edited block, so it avoids heap allocation where it can:
+ * the block's words are looked up once in the StringTable and word-list
+ * rules compare IDs, and regex rules are skipped on blocks that lack their
+ * leading literal. Only blocks a regex can actually match pay for Qt's
+ * match objects. Blocks inside a closed fold are skipped; the editor
+ * re-highlights them when the fold opens.
+ *
+ * The coloured spans are also downsampled into the block's
+ * MinimapBlockData, so the minimap is fed without scanning text itself.
+ * Hidden blocks, and every block while the minimap is off, only have
+ * their summary marked out of date; the minimap calls summarizeBlock()
+ * for those it draws.
+ *
  * @param text The text block to highlight.
  */
 void SyntaxHighlighter::highlightBlock(const QString &text) {
+    if (!currentBlock().isVisible()) {
+        markSummaryStale();
+        return;
+    }
+    SNSUPEAR_TRACE_SCOPE(Highlight, "SyntaxHighlighter::highlightBlock");
+    blockSpans.clear();
+    bool wordsScanned = false;
     for (const HighlightingRule &rule : qAsConst(highlightingRules)) {
+        if (!rule.wordIds.isEmpty()) {
+            if (!wordsScanned) {
+                scanWords(text);
+                wordsScanned = true;
+            }
+            for (const BlockWord& word : qAsConst(blockWords)) {
+                if (std::binary_search(rule.wordIds.cbegin(), rule.wordIds.cend(), word.id)) {
+                    applyRule(rule, word.start, word.length);
+                }
+            }
+            continue;
+        }
+        if (!rule.requiredLiteral.isEmpty() && !text.contains(rule.requiredLiteral)) {
+            continue;
+        }
         QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
         while (matchIterator.hasNext()) {
             QRegularExpressionMatch match = matchIterator.next();
-            setFormat(match.capturedStart(), match.capturedLength(), rule.format);
+            applyRule(rule, match.capturedStart(), match.capturedLength());
         }
     }
+
+    if (!minimapEnabled) {
+        markSummaryStale();
+        return;
+    }
+    MinimapBlockData* summary = static_cast<MinimapBlockData*>(currentBlockUserData());
+    if (!summary) {
+        summary = new MinimapBlockData();
+        setCurrentBlockUserData(summary);  // Owned by the block
+    }
+    MinimapTiles::summarize(std::u16string_view(reinterpret_cast<const char16_t*>(text.utf16()),
+                                                 static_cast<size_t>(text.size())),
+                            blockSpans.constData(), static_cast<size_t>(blockSpans.size()), summary->cells);
+    summary->current = true;
+}
+
+/**
+ * @brief Marks the current block's summary, if any, out of date.
+ */
+void SyntaxHighlighter::markSummaryStale() {
+    if (MinimapBlockData* summary = static_cast<MinimapBlockData*>(currentBlockUserData()))
+        summary->current = false;
+}
+
+/**
+ * @brief Summarizes a block highlightBlock() did not, because a fold hid it
+ * or the minimap was off, from its text and current formats.
+ *
+ * A block folded away before it was ever highlighted has no formats and is
+ * summarized as plain text; it is highlighted when the fold opens.
+ *
+ * @return The block's summary, now current.
+ */
+const MinimapCells& SyntaxHighlighter::summarizeBlock(QTextBlock block) {
+    MinimapBlockData* summary = static_cast<MinimapBlockData*>(block.userData());
+    if (!summary) {
+        summary = new MinimapBlockData();
+        block.setUserData(summary);  // Owned by the block
+    }
+    blockSpans.clear();
+    for (const QTextLayout::FormatRange& range : block.layout()->formats())
+        blockSpans.append({range.start, range.length, minimapColorOf(range.format)});
+    const QString text = block.text();
+    MinimapTiles::summarize(std::u16string_view(reinterpret_cast<const char16_t*>(text.utf16()),
+                                                 static_cast<size_t>(text.size())),
+                            blockSpans.constData(), static_cast<size_t>(blockSpans.size()), summary->cells);
+    summary->current = true;
+    return summary->cells;
+}
+
+/**
+ * @brief Applies a rule's format and records the span for the minimap.
+ */
+void SyntaxHighlighter::applyRule(const HighlightingRule& rule, int start, int length) {
+    setFormat(start, length, rule.format);
+    blockSpans.append({start, length, rule.minimapColor});
+}
+
+/**
+ * @brief Minimap palette index for a format's colour, added if new.
+ *
+ * Colours past the palette's size share the plain-text entry.
+ */
+quint8 SyntaxHighlighter::minimapColorOf(const QTextCharFormat& format) {
+    QRgb color = format.foreground().color().rgb();
+    int index = minimapColors.indexOf(color, 1);
+    if (index < 0) {
+        if (minimapColors.size() >= static_cast<int>(MinimapTiles::kColors))
+            return 0;
+        index = minimapColors.size();
+        minimapColors.append(color);
+    }
+    return static_cast<quint8>(index);
 }
 
 /**
@@ -72,7 +205,10 @@ void SyntaxHighlighter::highlightBlock(const QString &text) {
  * @param language The language identifier.
  */
 void SyntaxHighlighter::loadLanguageRules(const QString &language) {
+    ++generation;
     highlightingRules.clear();
+    longestWord = 0;
+    minimapColors.resize(1);
 
     QJsonObject syntaxRules = ConfigManager::getInstance().getSyntaxRules(language);
     if (syntaxRules.isEmpty()) {
@@ -84,10 +220,120 @@ void SyntaxHighlighter::loadLanguageRules(const QString &language) {
         HighlightingRule highlightingRule;
         highlightingRule.pattern = QRegularExpression(rule["pattern"].toString());
         highlightingRule.format = createTextFormat(rule["color"].toString(), rule["bold"].toBool(false), rule["italic"].toBool(false));
+        highlightingRule.minimapColor = minimapColorOf(highlightingRule.format);
+        compileRule(highlightingRule);
         highlightingRules.append(highlightingRule);
     }
 }
 
+/**
+ * @brief Prepares the non-allocating fast paths for a rule.
+ *
+ * A pattern of the form \b(a|b|...)\b made only of word characters
+ * becomes a sorted list of interned word IDs. Otherwise the literal text every match must
+ * start with is recorded, when the pattern has one.
+ *
+ * @param rule The rule, with its pattern set.
+ */
+void SyntaxHighlighter::compileRule(HighlightingRule& rule) {
+    rule.wordIds.clear();
+    rule.requiredLiteral.clear();
+    const QString pattern = rule.pattern.pattern();
+
+    static const QRegularExpression wordList("^\\\\b\\((?:\\?:)?(\\w+(?:\\|\\w+)*)\\)\\\\b$");
+    QRegularExpressionMatch words = wordList.match(pattern);
+    if (words.hasMatch() && rule.pattern.patternOptions() == QRegularExpression::NoPatternOption) {
+        QVector<quint32> ids;
+        int longest = 0;
+        for (const QString& word : words.captured(1).split('|')) {
+            QByteArray utf8 = word.toUtf8();
+            ids.append(StringTable::global().intern(std::string_view(utf8.constData(), utf8.size())));
+            longest = std::max(longest, utf8.size());
+        }
+        if (longest <= kMaxWordBytes) {
+            std::sort(ids.begin(), ids.end());
+            rule.wordIds = ids;
+            longestWord = std::max(longestWord, longest);
+            return;
+        }
+    }
+
+    // A top-level alternation can start with anything.
+    int depth = 0;
+    for (int i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] == '\\') {
+            ++i;
+        } else if (pattern[i] == '(') {
+            ++depth;
+        } else if (pattern[i] == ')') {
+            --depth;
+        } else if (pattern[i] == '|' && depth == 0) {
+            return;
+        } else if (pattern[i] == '[') {
+            while (i + 1 < pattern.size() && pattern[i + 1] != ']') {
+                i += pattern[i + 1] == '\\' ? 2 : 1;
+            }
+            ++i;
+        }
+    }
+
+    static const QString special = QStringLiteral("\\^$.|?*+()[]{}");
+    int end = 0;
+    while (end < pattern.size() && !special.contains(pattern[end])) {
+        ++end;
+    }
+    // A quantifier can make the last literal character optional.
+    if (end < pattern.size() && QStringLiteral("?*{").contains(pattern[end])) {
+        --end;
+    }
+    // Extended syntax ignores whitespace and treats '#' as a comment, so the
+    // leading characters are not necessarily literal.
+    const auto literalBreaking = QRegularExpression::CaseInsensitiveOption
+                                 | QRegularExpression::ExtendedPatternSyntaxOption;
+    if (end > 0 && !(rule.pattern.patternOptions() & literalBreaking)) {
+        rule.requiredLiteral = pattern.left(end);
+    }
+}
+
+/**
+ * @brief Collects the interned words of a block into blockWords.
+ *
+ * Each maximal run of word characters, ASCII as for PCRE's \w, is copied
+ * to the stack and looked up (never added) in the StringTable; words that are not interned
+ * cannot be in any word list and are dropped.
+ *
+ * @param text The text block to scan.
+ */
+void SyntaxHighlighter::scanWords(const QString& text) {
+    blockWords.resize(0);  // Keeps the capacity
+    char word[kMaxWordBytes];
+    const int length = text.size();
+    int i = 0;
+    while (i < length) {
+        if (!isWordChar(text[i])) {
+            ++i;
+            continue;
+        }
+        const int start = i;
+        int bytes = 0;
+        for (; i < length && isWordChar(text[i]); ++i) {
+            if (bytes >= longestWord) {
+                bytes = -1;  // Too long for any word list
+            }
+            if (bytes >= 0) {
+                word[bytes++] = static_cast<char>(text[i].unicode());
+            }
+        }
+        if (bytes <= 0) {
+            continue;
+        }
+        quint32 id = StringTable::global().find(std::string_view(word, static_cast<size_t>(bytes)));
+        if (id != StringTable::kNotFound) {
+            blockWords.append({start, i - start, id});
+        }
+    }
+}
+
 /**
  * @brief Creates a QTextCharFormat with the specified color, bold and italic settings.
  * @param color The color to use for the format.
@@ -96,6 +342,15 @@ void SyntaxHighlighter::loadLanguageRules(const QString &language) {
  * @return The created QTextCharFormat.
  */
 QTextCharFormat SyntaxHighlighter::createTextFormat(const QString &color, bool bold, bool italic) {
+    // Rules with the same style share one format, keyed by an interned ID.
+    static QHash<quint32, QTextCharFormat> formats;
+    const QByteArray key = QString("%1|%2|%3").arg(color).arg(int(bold)).arg(int(italic)).toUtf8();
+    const quint32 id = StringTable::global().intern(std::string_view(key.constData(), key.size()));
+    auto cached = formats.constFind(id);
+    if (cached != formats.constEnd()) {
+        return *cached;
+    }
+
     QTextCharFormat format;
     format.setForeground(QColor(color));
     if (bold) {
@@ -104,5 +359,6 @@ QTextCharFormat SyntaxHighlighter::createTextFormat(const QString &color, bool b
     if (italic) {
         format.setFontItalic(true);
     }
+    formats.insert(id, format);
     return format;
 }
@@ -5,6 +5,18 @@
 #include <QTextCharFormat>
 #include <QRegularExpression>
 #include <QJsonObject>
+#include <QTextBlock>
+#include <QTextBlockUserData>
+
+#include "minimap_tiles.h"
+
+/**
+ * @brief Minimap summary the highlighter leaves on each block it colours.
+ */
+struct MinimapBlockData : public QTextBlockUserData {
+    MinimapCells cells;
+    bool current = false;  ///< False once the block was coloured without being summarized.
+};
 
 /**
  * @brief Syntax highlighter class for the code editor.
@@ -34,6 +46,31 @@ public:
      */
     void setHighlightingRules(const QJsonObject& theme);
 
+    /**
+     * @brief Token colours the MinimapBlockData cells index; entry 0 is
+     * plain text and left for the view to fill in.
+     */
+    const QVector<QRgb>& minimapPalette() const { return minimapColors; }
+
+    /**
+     * @brief Bumped whenever the rules are reloaded, after which blocks
+     * highlighted again may take other colours.
+     */
+    quint64 rulesGeneration() const { return generation; }
+
+    /**
+     * @brief Turns the per-block minimap summaries on or off; while off,
+     * highlighting only marks them out of date.
+     */
+    void setMinimapEnabled(bool enabled) { minimapEnabled = enabled; }
+
+    /**
+     * @brief Summarizes a block highlightBlock() did not, because a fold
+     * hid it or the minimap was off, from its text and current formats.
+     * @return The block's summary, now current.
+     */
+    const MinimapCells& summarizeBlock(QTextBlock block);
+
 protected:
     /**
      * @brief Highlights a single block of text.
@@ -59,8 +96,50 @@ private:
     struct HighlightingRule {
         QRegularExpression pattern;  ///< Regular expression pattern to match.
         QTextCharFormat format;      ///< Text format to apply when the pattern matches.
+        QVector<quint32> wordIds;    ///< Sorted StringTable IDs for \b(a|b|...)\b patterns, matched without the regex.
+        QString requiredLiteral;     ///< Text every match starts with; blocks without it are skipped.
+        quint8 minimapColor = 0;     ///< Minimap palette index of the rule's colour.
+    };
+
+    /**
+     * @brief Prepares the non-allocating fast paths for a rule.
+     * @param rule The rule, with its pattern set.
+     */
+    void compileRule(HighlightingRule& rule);
+
+    /**
+     * @brief Collects the interned words of a block into blockWords.
+     * @param text The text block to scan.
+     */
+    void scanWords(const QString& text);
+
+    /**
+     * @brief Applies a rule's format and records the span for the minimap.
+     */
+    void applyRule(const HighlightingRule& rule, int start, int length);
+
+    /**
+     * @brief Minimap palette index for a format's colour, added if new.
+     */
+    quint8 minimapColorOf(const QTextCharFormat& format);
+
+    /**
+     * @brief Marks the current block's summary, if any, out of date.
+     */
+    void markSummaryStale();
+
+    struct BlockWord {
+        int start;
+        int length;
+        quint32 id;  ///< StringTable ID of the word.
     };
 
     QVector<HighlightingRule> highlightingRules;  ///< Collection of active highlighting rules.
     QString currentLanguage;                       ///< Currently active language.
+    int longestWord = 0;                           ///< Longest word-list entry, in UTF-8 bytes.
+    QVector<BlockWord> blockWords;                 ///< Scratch for highlightBlock, reused across blocks.
+    QVector<MinimapSpan> blockSpans;               ///< Spans coloured in the current block.
+    QVector<QRgb> minimapColors{0};                ///< Minimap palette; see minimapPalette().
+    bool minimapEnabled = true;                    ///< Whether highlightBlock() summarizes.
+    quint64 generation = 0;                        ///< See rulesGeneration().
 };
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "collaborative_buffer.h"
+
+namespace {
+
+// A buffer opened on the same file as its peers, with a relay-assigned id.
+struct Replica {
+    Replica(const std::string& text, uint32_t clientId) : collab(loaded(buffer, text)) {
+        collab.setClientId(clientId);
+    }
+
+    static TextBuffer& loaded(TextBuffer& buffer, const std::string& text) {
+        buffer.loadText(text);
+        return buffer;
+    }
+
+    TextBuffer buffer;
+    CollaborativeBuffer collab;
+};
+
+} // namespace
+
+TEST(CollaborativeBuffer, ReplicasShareTheBaseText) {
+    Replica a("shared text", 1);
+    Replica b("shared text", 2);
+    EXPECT_TRUE(a.collab.takePendingOps().empty());  // The base is not an op
+    a.collab.applyLocalEdits({{0, 0, "A "}});
+    b.collab.applyRemote(a.collab.takePendingOps());
+    EXPECT_EQ(b.buffer.getBuffer(), "A shared text");
+}
+
+TEST(CollaborativeBuffer, ConcurrentEditsConverge) {
+    Replica a("one two three", 1);
+    Replica b("one two three", 2);
+    a.collab.applyLocalEdits({{3, 7, ""}, {13, 13, "!"}});
+    a.buffer.insertText("X", 0);  // Picked up from the damage
+    b.collab.applyLocalEdits({{4, 7, "2"}, {8, 8, "3:"}});
+    b.collab.applyLocalEdits({{0, 0, "Y"}});
+
+    const std::string fromA = a.collab.takePendingOps();
+    const std::string fromB = b.collab.takePendingOps();
+    a.collab.applyRemote(fromB);
+    b.collab.applyRemote(fromA);
+    EXPECT_EQ(a.buffer.getBuffer(), b.buffer.getBuffer());
+    EXPECT_EQ(a.buffer.getBuffer(), a.collab.crdt().toString());
+}
+
+TEST(CollaborativeBuffer, LateReplicaLoadsTheBase) {
+    Replica a("base", 1);
+    a.collab.applyLocalEdits({{4, 4, "!"}});
+    TextBuffer buffer;
+    buffer.loadText("stale copy");
+    CollaborativeBuffer late(buffer);
+    late.setClientId(2);
+    late.loadBase("base");
+    late.applyRemote(a.collab.takePendingOps());
+    EXPECT_EQ(buffer.getBuffer(), "base!");
+}
+
+TEST(CollaborativeBuffer, RemoteEditsKeepLocalUndo) {
+    Replica a("abc", 1);
+    Replica b("abc", 2);
+    a.collab.applyLocalEdits({{3, 3, " def"}});
+    b.collab.applyLocalEdits({{0, 0, "> "}});
+    a.collab.applyRemote(b.collab.takePendingOps());
+    ASSERT_EQ(a.buffer.getBuffer(), "> abc def");
+    ASSERT_TRUE(a.buffer.undo());
+    EXPECT_EQ(a.buffer.getBuffer(), "> abc");
+    b.collab.applyRemote(a.collab.takePendingOps());
+    EXPECT_EQ(b.buffer.getBuffer(), "> abc");
+}
+
+TEST(CollaborativeBuffer, MalformedRemoteOpsLeaveLocalEditingWorking) {
+    Replica a("abc", 1);
+    CrdtOp orphan{CrdtOp::Kind::Insert, 7, 1, {7, 99}, "x", 0};
+    EXPECT_THROW(a.collab.applyRemote(encodeCrdtOps({orphan})), std::invalid_argument);
+    a.buffer.insertText("d", 3);
+    EXPECT_FALSE(a.collab.takePendingOps().empty());
+}
+
+TEST(CollaborativeBuffer, LocalEditsNeedAClientId) {
+    TextBuffer buffer;
+    CollaborativeBuffer collab(buffer);
+    EXPECT_THROW(collab.applyLocalEdits({{0, 0, "x"}}), std::logic_error);
+    EXPECT_EQ(buffer.getBuffer(), "");
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "diagnostics.h"
+
+namespace {
+
+Diagnostic at(size_t start, size_t end, const std::string& message) {
+    return {start, end, DiagnosticSeverity::Warning, message};
+}
+
+std::vector<std::pair<size_t, size_t>> positions(const DocumentDiagnostics& document) {
+    std::vector<std::pair<size_t, size_t>> result;
+    for (const Diagnostic& diagnostic : document.diagnostics()) {
+        result.emplace_back(diagnostic.start, diagnostic.end);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(DocumentDiagnostics, OldResultsAreMappedThroughLaterEdits) {
+    DocumentDiagnostics document;
+    std::vector<ByteRange> damaged;
+    const uint64_t revision = document.snapshotTaken();
+    document.applyEdits({{0, 0, "abc"}}, damaged);  // Everything moves right by 3
+    document.applyEdits({{20, 22, ""}}, damaged);   // Cuts into the second diagnostic
+
+    ASSERT_TRUE(document.accept(revision, {at(10, 12, "a"), at(17, 19, "b"), at(30, 31, "c")}, damaged));
+    EXPECT_EQ(positions(document), (std::vector<std::pair<size_t, size_t>>{{13, 15}, {31, 32}}));
+}
+
+TEST(DocumentDiagnostics, EditsDropTheDiagnosticsTheyTouch) {
+    DocumentDiagnostics document;
+    std::vector<ByteRange> damaged;
+    ASSERT_TRUE(document.accept(document.snapshotTaken(), {at(4, 8, "a"), at(10, 12, "b")}, damaged));
+    damaged.clear();
+
+    document.applyEdits({{6, 6, "xy"}}, damaged);  // Inside the first
+    EXPECT_EQ(positions(document), (std::vector<std::pair<size_t, size_t>>{{12, 14}}));
+    ASSERT_EQ(damaged.size(), 1u);
+    EXPECT_EQ(damaged[0].start, 4u);
+    EXPECT_EQ(damaged[0].end, 10u);  // Where it was, grown by the insertion
+}
+
+TEST(DocumentDiagnostics, ResultsOlderThanThoseShownAreIgnored) {
+    DocumentDiagnostics document;
+    std::vector<ByteRange> damaged;
+    const uint64_t older = document.snapshotTaken();
+    document.applyEdits({{0, 0, "x"}}, damaged);
+    const uint64_t newer = document.snapshotTaken();
+
+    ASSERT_TRUE(document.accept(newer, {at(1, 2, "new")}, damaged));
+    EXPECT_FALSE(document.accept(older, {at(0, 1, "old")}, damaged));
+    ASSERT_EQ(document.diagnostics().size(), 1u);
+    EXPECT_EQ(document.diagnostics()[0].message, "new");
+}
+
+TEST(DiagnosticsService, ShutdownKillsARunningTool) {
+    namespace fs = std::filesystem;
+    const fs::path directory = fs::temp_directory_path() / ("snsupear-diag-test-" + std::to_string(::getpid()));
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+
+    // The shell's sleep keeps the output pipe open unless its whole process
+    // group is killed.
+    auto tool = std::make_shared<CommandProvider>(
+        std::vector<std::string>{"sh", "-c", "touch {dir}/started; sleep 30"}, std::vector<std::string>{},
+        std::chrono::seconds(60));
+    bool reported = false;
+    auto service = std::make_unique<DiagnosticsService>(
+        std::vector<std::shared_ptr<DiagnosticProvider>>{tool},
+        [&](uint64_t, uint64_t, std::vector<Diagnostic>) { reported = true; });
+    service->submit(1, (directory / "main.cpp").string(), 1, std::make_shared<const std::string>("int x;\n"));
+
+    const auto start = std::chrono::steady_clock::now();
+    while (!fs::exists(directory / "started") && std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(fs::exists(directory / "started"));
+
+    const auto stop = std::chrono::steady_clock::now();
+    service.reset();
+    EXPECT_LT(std::chrono::steady_clock::now() - stop, std::chrono::seconds(5));
+    EXPECT_FALSE(reported);
+    fs::remove_all(directory);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "edit_journal.h"
+
+namespace {
+
+// A fresh directory under the system temp directory, removed afterwards.
+class JournalDirectory {
+public:
+    explicit JournalDirectory(const std::string& name)
+        : path(std::filesystem::temp_directory_path()
+               / ("snsupear-journal-test-" + std::to_string(::getpid()) + "-" + name)) {
+        std::filesystem::remove_all(path);
+    }
+    ~JournalDirectory() { std::filesystem::remove_all(path); }
+
+    std::string str() const { return path.string(); }
+
+    std::filesystem::path path;
+};
+
+} // namespace
+
+TEST(EditJournal, EditsQueuedBeforeAFailedCheckpointSurvive) {
+    JournalDirectory directory("checkpoint");
+    EditJournalOptions options;
+    options.commitDelay = std::chrono::hours(1);  // Only sync() commits
+    EditJournal journal(directory.str(), "abc", true, options);
+    journal.sync();
+
+    // The edit and the checkpoint reach the writer together, and the
+    // checkpoint cannot be written.
+    std::filesystem::create_directory(directory.path / "checkpoint.tmp");
+    journal.append({{3, 3, "d"}});
+    journal.checkpoint("abcd", false);
+    journal.sync();
+    EXPECT_FALSE(journal.lastError().empty());
+
+    std::optional<JournalRecovery> recovery = EditJournal::recover(directory.str());
+    ASSERT_TRUE(recovery);
+    EXPECT_EQ(recovery->text, "abcd");
+    EXPECT_TRUE(recovery->unsaved);
+}
+
+TEST(EditJournal, RecoveryDuringCheckpointsKeepsSyncedEdits) {
+    JournalDirectory directory("race");
+    JournalDirectory copy("race-copy");
+    constexpr size_t kEdits = 2000;
+    std::atomic<size_t> synced{0};
+    std::atomic<bool> done{false};
+
+    std::thread editor([&] {
+        EditJournalOptions options;
+        options.commitDelay = std::chrono::milliseconds(1);
+        EditJournal journal(directory.str(), std::string(), true, options);
+        for (size_t length = 0; length < kEdits; ++length) {
+            journal.append({{length, length, "x"}});
+            if ((length + 1) % 97 == 0) {
+                journal.checkpoint(std::string(length + 1, 'x'), false);
+            }
+            if ((length + 1) % 10 == 0) {
+                journal.sync();
+                synced = length + 1;
+            }
+        }
+        journal.sync();
+        synced = kEdits;
+        done = true;
+    });
+
+    size_t recoveries = 0;
+    while (!done || recoveries == 0) {
+        const size_t durable = synced;
+        // The journal is copied before the checkpoint, so the copy is never
+        // older than what a crash at the moment of copying would leave.
+        std::error_code ec;
+        std::filesystem::remove_all(copy.path, ec);
+        std::filesystem::create_directories(copy.path);
+        std::filesystem::copy_file(directory.path / "journal", copy.path / "journal",
+                                   std::filesystem::copy_options::overwrite_existing, ec);
+        std::filesystem::copy_file(directory.path / "checkpoint", copy.path / "checkpoint",
+                                   std::filesystem::copy_options::overwrite_existing, ec);
+        std::optional<JournalRecovery> recovery = EditJournal::recover(copy.str());
+        if (!recovery) {
+            continue;  // Copied before the first checkpoint
+        }
+        ++recoveries;
+        ASSERT_EQ(recovery->text, std::string(recovery->text.size(), 'x'));
+        ASSERT_GE(recovery->text.size(), durable);
+    }
+    editor.join();
+
+    std::optional<JournalRecovery> recovery = EditJournal::recover(directory.str());
+    ASSERT_TRUE(recovery);
+    EXPECT_EQ(recovery->text, std::string(kEdits, 'x'));
+}
+
+TEST(EditJournal, RemoveDeletesAClosedJournal) {
+    JournalDirectory closed("remove-closed");
+    JournalDirectory open("remove-open");
+    EditJournal journal(closed.str(), "abc", false);
+    journal.append({{3, 3, "d"}});
+    journal.close(false);
+    journal.sync();
+    ASSERT_TRUE(EditJournal::recover(closed.str()));
+
+    journal.open(open.str(), "xyz", false);
+    journal.remove(closed.str());
+    journal.remove(open.str());  // Open: kept
+    journal.sync();
+    EXPECT_FALSE(EditJournal::recover(closed.str()));
+    std::optional<JournalRecovery> recovery = EditJournal::recover(open.str());
+    ASSERT_TRUE(recovery);
+    EXPECT_EQ(recovery->text, "xyz");
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "fold_index.h"
+#include "text_buffer.h"
+
+namespace {
+
+std::vector<LineShape> shapes(const std::vector<std::string>& lines) {
+    std::vector<LineShape> result;
+    for (const std::string& line : lines) {
+        result.push_back(FoldIndex::shapeOf(std::string_view(line)));
+    }
+    return result;
+}
+
+const std::vector<std::string> kSource{"int f() {", "  return 1;", "}", "int g() {", "  return 2;", "}"};
+
+} // namespace
+
+TEST(FoldIndex, EditsKeepFoldsOutsideThem) {
+    FoldIndex index;
+    index.replaceLines(0, index.lineCount(), shapes(kSource));
+    ASSERT_TRUE(index.fold(3));
+    index.replaceLines(0, 1, shapes({"// f", "int f() {"}));  // One line becomes two
+    EXPECT_TRUE(index.isFolded(4));
+    EXPECT_TRUE(index.isHidden(5));
+    EXPECT_EQ(index.visibleLineCount(), 6u);  // The closing brace stays visible
+}
+
+TEST(FoldIndex, ReplacingTheDocumentOpensAllFolds) {
+    FoldIndex index;
+    index.replaceLines(0, index.lineCount(), shapes(kSource));
+    ASSERT_TRUE(index.fold(0));
+    ASSERT_TRUE(index.fold(3));
+
+    // Same line count, so the old headers would still be in range.
+    index.replaceLines(0, index.lineCount(), shapes({"a {", "b", "}", "c {", "d", "}"}));
+    EXPECT_TRUE(index.hiddenRanges().empty());
+    EXPECT_FALSE(index.isFolded(0));
+    EXPECT_FALSE(index.isFolded(3));
+    EXPECT_EQ(index.visibleLineCount(), 6u);
+
+    ASSERT_TRUE(index.fold(3));
+    TextBuffer buffer;
+    buffer.loadText("x {\ny\n}\nz {\nw\n}");
+    index.reset(buffer);
+    EXPECT_TRUE(index.hiddenRanges().empty());
+    EXPECT_EQ(index.visibleLineCount(), 6u);
+}
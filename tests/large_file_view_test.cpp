@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include "large_file_view.h"
+
+TEST(LargeFileView, ReadsStopAtTheEndOfATruncatedFile) {
+    namespace fs = std::filesystem;
+    const fs::path path = fs::temp_directory_path() / ("snsupear-large-test-" + std::to_string(::getpid()) + ".log");
+    {
+        std::ofstream out(path);
+        for (int i = 0; i < 100000; ++i) {
+            out << "line " << i << "\n";
+        }
+    }
+    LargeFileView view;
+    ASSERT_TRUE(view.open(path.string()));
+    const auto start = std::chrono::steady_clock::now();
+    while (!view.isIndexed() && std::chrono::steady_clock::now() - start < std::chrono::seconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(view.isIndexed());
+
+    // copytruncate: the mapping outlives the bytes, which would fault.
+    fs::resize_file(path, 0);
+    EXPECT_EQ(view.readableSize(), 0u);
+    EXPECT_EQ(view.lines(50000, 20).size(), 1u);
+    EXPECT_EQ(view.lineStartAtOrBefore(view.size()), 0u);
+    EXPECT_LE(view.lineOfOffset(view.size()), view.lineCount());
+
+    {
+        std::ofstream out(path);
+        out << "after\n";
+    }
+    ASSERT_TRUE(view.open(path.string()));
+    ASSERT_EQ(view.linesFrom(0, 1).size(), 1u);
+    EXPECT_EQ(view.linesFrom(0, 1)[0], "after");
+    view.close();
+    fs::remove(path);
+}
@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+#include "line_checksum.h"
+
+TEST(LineChecksum, UpdatesMatchAFullRehash) {
+    TextBuffer buffer;
+    LineChecksum checksum;
+    checksum.reset(buffer);
+    buffer.addChangeListener([&](const DamageRegion& damage) { checksum.update(buffer, damage); });
+    std::string text;
+    for (int i = 0; i < 3000; ++i) {
+        text += "line " + std::to_string(i) + "\n";
+    }
+    buffer.loadText(text);
+
+    std::mt19937 random(7);
+    const std::string pieces[] = {"", "x", "\n", "a\nb", "\n\n\n", std::string(2000, '\n')};
+    for (int i = 0; i < 500; ++i) {
+        const size_t length = buffer.getLength();
+        const size_t start = random() % (length + 1);
+        const size_t end = std::min(length, start + random() % (i % 50 == 0 ? 40000 : 20));
+        buffer.applyEdits({{start, end, pieces[random() % 6]}});
+        LineChecksum expected;
+        expected.reset(buffer);
+        ASSERT_EQ(checksum.value(), expected.value()) << "after edit " << i;
+    }
+}
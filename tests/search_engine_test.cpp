@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "search_engine.h"
+
+namespace {
+
+// Matches std::regex finds line by line, with no prefilter in the way.
+size_t regexMatchCount(const std::string& text, const std::string& pattern) {
+    std::regex expression(pattern);
+    size_t count = 0;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string line = text.substr(start, end - start);
+        for (std::sregex_iterator it(line.begin(), line.end(), expression), last; it != last; ++it) {
+            count += it->length() > 0 ? 1 : 0;
+        }
+        start = end + 1;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST(SearchPattern, PrefilteredRegexFindsWhatTheRegexFinds) {
+    const std::string text = "cursor_12 foo\nab abc ac\nbar.text xyz xxyz\n.textual adef de\n"
+                             "xxyy xxxyy\nheo hello helllo\n";
+    for (const char* pattern : {"cursor_[0-9]+", "ab*c", "foo|bar", "(x)+yz", "\\.text\\b", "a.b", "[abc]def?",
+                                "x{2,3}yy", "hel+o", "l?o"}) {
+        SearchOptions options;
+        options.regex = true;
+        SearchPattern compiled(pattern, options);
+        std::vector<SearchMatch> whole;
+        compiled.findInText(text, whole);
+        EXPECT_EQ(whole.size(), regexMatchCount(text, pattern)) << pattern;
+    }
+}
+
+TEST(SearchPattern, MatchesKeepTheirLines) {
+    SearchOptions options;
+    options.regex = true;
+    SearchPattern compiled("ne+dle", options);
+    std::vector<SearchMatch> matches;
+    compiled.findInText("x\nneedle\n\nneeeedle y\n", matches);
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matches[0].line, 1u);
+    EXPECT_EQ(matches[1].line, 3u);
+    EXPECT_EQ(matches[1].length, 8u);
+}
+
+TEST(SearchPattern, RejectsLiteralLineBreaks) {
+    EXPECT_THROW(SearchPattern("a\nb", SearchOptions()), std::invalid_argument);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "text_buffer.h"
+
+TEST(TextBufferUndo, TypingUndoesAWordAtATime) {
+    TextBuffer buffer;
+    buffer.loadText("x");
+    size_t at = 1;
+    for (char c : std::string(" hello world")) {
+        buffer.insertText(std::string(1, c), at++);
+    }
+    ASSERT_EQ(buffer.getBuffer(), "x hello world");
+    ASSERT_TRUE(buffer.undo());
+    EXPECT_EQ(buffer.getBuffer(), "x hello ");
+    ASSERT_TRUE(buffer.undo());
+    EXPECT_EQ(buffer.getBuffer(), "x hello");
+    ASSERT_TRUE(buffer.undo());
+    EXPECT_EQ(buffer.getBuffer(), "x ");
+    ASSERT_TRUE(buffer.redo());
+    EXPECT_EQ(buffer.getBuffer(), "x hello");
+}
+
+TEST(TextBufferUndo, StepLimitDropsTheOldestSteps) {
+    TextBuffer buffer;
+    buffer.setUndoLimit(size_t(1) << 20, 8);
+    for (int i = 0; i < 100; ++i) {
+        buffer.insertText(" ", buffer.getLength());  // Whitespace never coalesces
+    }
+    int steps = 0;
+    while (buffer.undo()) {
+        ++steps;
+    }
+    EXPECT_GT(steps, 0);
+    EXPECT_LE(steps, 8);
+    EXPECT_EQ(buffer.getLength(), size_t(100 - steps));
+}
+
+TEST(TextBufferUndo, ByteLimitKeepsTheNewestStep) {
+    TextBuffer buffer;
+    buffer.setUndoLimit(4096, 1000);
+    const std::string big(10000, 'a');
+    buffer.insertText(big, 0);
+    buffer.deleteText(0, big.size());  // Its undo holds 10000 bytes
+    buffer.insertText(big, 0);
+    buffer.deleteText(0, big.size());
+    ASSERT_TRUE(buffer.undo());
+    EXPECT_EQ(buffer.getBuffer(), big);
+    ASSERT_TRUE(buffer.undo());
+    EXPECT_EQ(buffer.getBuffer(), "");
+    EXPECT_FALSE(buffer.undo());  // The first pair went over the limit
+}
+
+TEST(TextBufferUndo, ExternalEditsKeepLocalSteps) {
+    TextBuffer buffer;
+    buffer.loadText("one two");
+    buffer.insertText("!", 7);
+    buffer.insertText(" and", 3);
+    buffer.applyExternalEdits({{0, 0, ">> "}, {8, 11, "TWO"}});  // A collaborator's edits
+    ASSERT_EQ(buffer.getBuffer(), ">> one and TWO!");
+    ASSERT_TRUE(buffer.undo());
+    EXPECT_EQ(buffer.getBuffer(), ">> one TWO!");
+    ASSERT_TRUE(buffer.undo());
+    EXPECT_EQ(buffer.getBuffer(), ">> one TWO");
+    ASSERT_TRUE(buffer.redo());
+    EXPECT_EQ(buffer.getBuffer(), ">> one TWO!");
+}
+
+TEST(TextBufferUndo, ExternalEditOverlappingAStepDropsIt) {
+    TextBuffer buffer;
+    buffer.loadText("abc");
+    buffer.insertText(" ", 3);
+    buffer.insertText("def", 4);
+    buffer.applyExternalEdits({{4, 7, "xyz"}});  // Rewrites the newest step's text
+    EXPECT_EQ(buffer.getBuffer(), "abc xyz");
+    EXPECT_FALSE(buffer.undo());
+}
+
+TEST(TextBufferMemory, LargeEditScratchIsNotRetained) {
+    TextBuffer buffer;
+    buffer.loadText("abc");
+    buffer.applyExternalEdits({{1, 1, std::string(8 << 20, 'y')}});
+    buffer.applyExternalEdits({{1, (8 << 20) + 1, ""}});
+    const size_t afterPaste = buffer.memoryUsage();  // Counts the paste's scratch
+    buffer.applyExternalEdits({{1, 1, "x"}});
+    EXPECT_EQ(buffer.getBuffer(), "axbc");
+    EXPECT_LT(buffer.memoryUsage() + (6 << 20), afterPaste);
+}
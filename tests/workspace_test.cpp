@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "workspace.h"
+
+namespace {
+
+// Files of a few lines each in a fresh directory, removed afterwards.
+class FileTree {
+public:
+    FileTree(const std::string& name, size_t count)
+        : root(std::filesystem::temp_directory_path()
+               / ("snsupear-workspace-test-" + std::to_string(::getpid()) + "-" + name)) {
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root);
+        for (size_t i = 0; i < count; ++i) {
+            paths.push_back((root / ("file" + std::to_string(i) + ".txt")).string());
+            std::ofstream(paths.back()) << "line one\nline " << i << "\n";
+        }
+    }
+    ~FileTree() { std::filesystem::remove_all(root); }
+
+    std::filesystem::path root;
+    std::vector<std::string> paths;
+};
+
+} // namespace
+
+TEST(Workspace, OpenAllDuringPrefetchReportsEveryFile) {
+    FileTree tree("prefetch", 300);
+    WorkspaceOptions options;
+    options.threadCount = 1;  // An open waiting on a queued prefetch would never resume
+    options.prefetchNeighbours = 0;
+    options.recentFiles = 0;
+    // Leaked if the opens never finish, since joining the worker would hang.
+    auto* workspace = new Workspace(options);
+
+    std::mutex mutex;
+    std::condition_variable reported;
+    std::map<std::string, std::string> results;
+    size_t calls = 0;
+    workspace->prefetch(tree.paths);
+    workspace->openAll(tree.paths, [&](const std::string& path, const std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[path] = error;
+        ++calls;
+        reported.notify_all();
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(reported.wait_for(lock, std::chrono::seconds(30), [&] { return calls >= tree.paths.size(); }))
+        << "only " << calls << " of " << tree.paths.size() << " files were reported";
+    lock.unlock();
+    workspace->waitIdle();
+    EXPECT_EQ(calls, tree.paths.size());
+    for (const std::string& path : tree.paths) {
+        EXPECT_EQ(results.count(path), 1u) << path;
+        EXPECT_EQ(results[path], "") << path;
+        EXPECT_TRUE(workspace->isCached(path)) << path;
+    }
+    delete workspace;
+}
+
+TEST(Workspace, ReleaseDropsADocumentNobodyHolds) {
+    FileTree tree("release", 2);
+    WorkspaceOptions options;
+    options.prefetchNeighbours = 0;
+    options.recentFiles = 0;
+    Workspace workspace(options);
+
+    std::shared_ptr<WorkspaceDocument> document = workspace.acquire(tree.paths[0]);
+    workspace.release(tree.paths[0]);
+    EXPECT_TRUE(workspace.isCached(tree.paths[0]));  // Still shown
+
+    document.reset();
+    workspace.release(tree.paths[0]);
+    EXPECT_FALSE(workspace.isCached(tree.paths[0]));
+    EXPECT_EQ(workspace.memoryUsage(), 0u);
+}
+
+TEST(Workspace, TakeHandsTheOnlyCopyToTheCaller) {
+    FileTree tree("take", 2);
+    WorkspaceOptions options;
+    options.prefetchNeighbours = 0;
+    options.recentFiles = 0;
+    Workspace workspace(options);
+
+    EXPECT_EQ(workspace.take(tree.paths[0]), nullptr);  // Never loaded
+    workspace.prefetch({tree.paths[0]});
+    workspace.waitIdle();
+    ASSERT_TRUE(workspace.isCached(tree.paths[0]));
+
+    std::shared_ptr<WorkspaceDocument> document = workspace.take(tree.paths[0]);
+    ASSERT_NE(document, nullptr);
+    EXPECT_EQ(document.use_count(), 1);
+    EXPECT_FALSE(workspace.isCached(tree.paths[0]));
+    EXPECT_EQ(workspace.memoryUsage(), 0u);
+
+    workspace.prefetch({tree.paths[0]});  // Shown elsewhere; not loaded twice
+    workspace.waitIdle();
+    EXPECT_FALSE(workspace.isCached(tree.paths[0]));
+
+    workspace.release(tree.paths[0]);
+    workspace.prefetch({tree.paths[0]});
+    workspace.waitIdle();
+    EXPECT_TRUE(workspace.isCached(tree.paths[0]));
+}
@@ -120,6 +120,11 @@ document.addEventListener('DOMContentLoaded', () => {
     });
 
     function saveFile() {
+        // Opened from the file service (?file=): push pending deltas instead.
+        if (window.SnSync && window.SnSync.active) {
+            window.SnSync.active.flush();
+            return;
+        }
         const content = editor.getValue();
         const blob = new Blob([content], { type: 'text/plain' });
         const url = URL.createObjectURL(blob);